@@ -0,0 +1,292 @@
+/* EPANET 3
+ *
+ * Copyright (c) 2016 Open Water Analytics
+ * Licensed under the terms of the MIT License (see the LICENSE file for details).
+ *
+ */
+
+#include "checkpoint.h"
+#include "Core/network.h"
+#include "Elements/node.h"
+#include "Elements/tank.h"
+#include "Elements/qualsource.h"
+#include "Elements/link.h"
+#include "Elements/pump.h"
+
+#include <cmath>
+
+using namespace std;
+
+//-----------------------------------------------------------------------------
+
+//  Constructor
+
+Checkpoint::Checkpoint() :
+    halted(false),
+    currentTime(0),
+    rptTime(0),
+    hydStep(0),
+    adaptiveStep(0),
+    timeOfDay(0),
+    peakKwatts(0.0),
+    qualTime(0),
+    cyclicLinks(0),
+    mergeCount(0.0),
+    peakSegCount(0),
+    peakSegMemory(0)
+{
+    qualBalance.init(0.0);
+}
+
+//  Destructor
+
+Checkpoint::~Checkpoint()
+{
+    clear();
+}
+
+//-----------------------------------------------------------------------------
+
+//  Discard all saved state.
+
+void Checkpoint::clear()
+{
+    ruleActions.clear();
+    sortedLinks.clear();
+    flowDirection.clear();
+    nodeOrder.clear();
+    segCount.clear();
+    segVolume.clear();
+    segQuality.clear();
+    tankQuality.clear();
+    segSpecies.clear();
+    nodeSpecies.clear();
+    mergeCount = 0.0;
+    peakSegCount = 0;
+    peakSegMemory = 0;
+    injectionImpacts.clear();
+
+    nodeFixedGrade.clear();
+    nodeHead.clear();
+    nodeQGrad.clear();
+    nodeFullDemand.clear();
+    nodeActualDemand.clear();
+    nodeOutflow.clear();
+    nodeQuality.clear();
+
+    tankVolume.clear();
+    tankArea.clear();
+    tankPastHead.clear();
+    tankPastVolume.clear();
+    tankPastOutflow.clear();
+
+    sourceStrength.clear();
+    sourceOutflow.clear();
+    sourceQuality.clear();
+
+    linkStatus.clear();
+    linkFlow.clear();
+    linkLeakage.clear();
+    linkHLoss.clear();
+    linkHGrad.clear();
+    linkSetting.clear();
+    linkQuality.clear();
+
+    pumpSpeed.clear();
+    pumpEnergy.clear();
+}
+
+//-----------------------------------------------------------------------------
+
+//  Save the computed state of each network node and link.
+
+void Checkpoint::saveNetwork(Network* nw)
+{
+    int nodeCount = nw->count(Element::NODE);
+    int linkCount = nw->count(Element::LINK);
+
+    nodeFixedGrade.resize(nodeCount);
+    nodeHead.resize(nodeCount);
+    nodeQGrad.resize(nodeCount);
+    nodeFullDemand.resize(nodeCount);
+    nodeActualDemand.resize(nodeCount);
+    nodeOutflow.resize(nodeCount);
+    nodeQuality.resize(nodeCount);
+    tankVolume.clear();
+    tankArea.clear();
+    tankPastHead.clear();
+    tankPastVolume.clear();
+    tankPastOutflow.clear();
+    sourceStrength.clear();
+    sourceOutflow.clear();
+    sourceQuality.clear();
+
+    // ... save node state
+    for (int i = 0; i < nodeCount; i++)
+    {
+        Node* node = nw->node(i);
+        nodeFixedGrade[i] = node->fixedGrade;
+        nodeHead[i] = node->head;
+        nodeQGrad[i] = node->qGrad;
+        nodeFullDemand[i] = node->fullDemand;
+        nodeActualDemand[i] = node->actualDemand;
+        nodeOutflow[i] = node->outflow;
+        nodeQuality[i] = node->quality;
+
+        if ( node->type() == Node::TANK )
+        {
+            Tank* tank = static_cast<Tank*>(node);
+            tankVolume.push_back(tank->volume);
+            tankArea.push_back(tank->area);
+            tankPastHead.push_back(tank->pastHead);
+            tankPastVolume.push_back(tank->pastVolume);
+            tankPastOutflow.push_back(tank->pastOutflow);
+        }
+
+        if ( node->qualSource )
+        {
+            sourceStrength.push_back(node->qualSource->strength);
+            sourceOutflow.push_back(node->qualSource->outflow);
+            sourceQuality.push_back(node->qualSource->quality);
+        }
+    }
+
+    linkStatus.resize(linkCount);
+    linkFlow.resize(linkCount);
+    linkLeakage.resize(linkCount);
+    linkHLoss.resize(linkCount);
+    linkHGrad.resize(linkCount);
+    linkSetting.resize(linkCount);
+    linkQuality.resize(linkCount);
+    pumpSpeed.clear();
+    pumpEnergy.clear();
+
+    // ... save link state
+    for (int i = 0; i < linkCount; i++)
+    {
+        Link* link = nw->link(i);
+        linkStatus[i] = link->status;
+        linkFlow[i] = link->flow;
+        linkLeakage[i] = link->leakage;
+        linkHLoss[i] = link->hLoss;
+        linkHGrad[i] = link->hGrad;
+        linkSetting[i] = link->setting;
+        linkQuality[i] = link->quality;
+
+        if ( link->type() == Link::PUMP )
+        {
+            Pump* pump = static_cast<Pump*>(link);
+            pumpSpeed.push_back(pump->speed);
+            pumpEnergy.push_back(pump->pumpEnergy);
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+//  Restore the computed state of each network node and link, leaving water
+//  quality and pump energy usage untouched if hydraulicsOnly is true.
+//  (Returns false if the network's layout doesn't match the saved state.)
+
+bool Checkpoint::restoreNetwork(Network* nw, bool hydraulicsOnly)
+{
+    int nodeCount = nw->count(Element::NODE);
+    int linkCount = nw->count(Element::LINK);
+    if ( nodeCount != (int)nodeHead.size() ) return false;
+    if ( linkCount != (int)linkFlow.size() ) return false;
+
+    // ... restore node state
+    size_t iTank = 0;
+    size_t iSource = 0;
+    for (int i = 0; i < nodeCount; i++)
+    {
+        Node* node = nw->node(i);
+        node->fixedGrade = nodeFixedGrade[i];
+        node->head = nodeHead[i];
+        node->qGrad = nodeQGrad[i];
+        node->fullDemand = nodeFullDemand[i];
+        node->actualDemand = nodeActualDemand[i];
+        node->outflow = nodeOutflow[i];
+        if ( !hydraulicsOnly ) node->quality = nodeQuality[i];
+
+        if ( node->type() == Node::TANK )
+        {
+            if ( iTank >= tankVolume.size() ) return false;
+            Tank* tank = static_cast<Tank*>(node);
+            tank->volume = tankVolume[iTank];
+            tank->area = tankArea[iTank];
+            tank->pastHead = tankPastHead[iTank];
+            tank->pastVolume = tankPastVolume[iTank];
+            tank->pastOutflow = tankPastOutflow[iTank];
+            iTank++;
+        }
+
+        if ( node->qualSource && !hydraulicsOnly )
+        {
+            if ( iSource >= sourceStrength.size() ) return false;
+            node->qualSource->strength = sourceStrength[iSource];
+            node->qualSource->outflow = sourceOutflow[iSource];
+            node->qualSource->quality = sourceQuality[iSource];
+            iSource++;
+        }
+    }
+
+    // ... restore link state
+    size_t iPump = 0;
+    for (int i = 0; i < linkCount; i++)
+    {
+        Link* link = nw->link(i);
+        link->status = linkStatus[i];
+        link->flow = linkFlow[i];
+        link->leakage = linkLeakage[i];
+        link->hLoss = linkHLoss[i];
+        link->hGrad = linkHGrad[i];
+        link->setting = linkSetting[i];
+        if ( !hydraulicsOnly ) link->quality = linkQuality[i];
+
+        if ( link->type() == Link::PUMP )
+        {
+            if ( iPump >= pumpSpeed.size() ) return false;
+            Pump* pump = static_cast<Pump*>(link);
+            pump->speed = pumpSpeed[iPump];
+            if ( !hydraulicsOnly ) pump->pumpEnergy = pumpEnergy[iPump];
+            iPump++;
+        }
+    }
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+
+//  Check if the network's tank heads are within headTol (ft) of the saved
+//  ones and its link statuses and settings are the same as the saved ones.
+
+bool Checkpoint::matchesNetwork(Network* nw, double headTol)
+{
+    int nodeCount = nw->count(Element::NODE);
+    int linkCount = nw->count(Element::LINK);
+    if ( nodeCount != (int)nodeHead.size() ) return false;
+    if ( linkCount != (int)linkFlow.size() ) return false;
+
+    for (int i = 0; i < nodeCount; i++)
+    {
+        Node* node = nw->node(i);
+        if ( node->type() != Node::TANK ) continue;
+        if ( abs(node->head - nodeHead[i]) > headTol ) return false;
+    }
+
+    size_t iPump = 0;
+    for (int i = 0; i < linkCount; i++)
+    {
+        Link* link = nw->link(i);
+        if ( link->status != linkStatus[i] ) return false;
+        if ( link->setting != linkSetting[i] ) return false;
+        if ( link->type() == Link::PUMP )
+        {
+            if ( iPump >= pumpSpeed.size() ) return false;
+            if ( static_cast<Pump*>(link)->speed != pumpSpeed[iPump] ) return false;
+            iPump++;
+        }
+    }
+    return true;
+}
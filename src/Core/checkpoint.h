@@ -0,0 +1,115 @@
+/* EPANET 3
+ *
+ * Copyright (c) 2016 Open Water Analytics
+ * Licensed under the terms of the MIT License (see the LICENSE file for details).
+ *
+ */
+
+//! \file checkpoint.h
+//! \brief Describes the Checkpoint class.
+
+#ifndef CHECKPOINT_H_
+#define CHECKPOINT_H_
+
+#include "Core/qualbalance.h"
+#include "Core/injectionimpacts.h"
+#include "Models/pumpenergy.h"
+
+#include <vector>
+#include <string>
+#include <cstddef>
+
+class Network;
+
+//! \class Checkpoint
+//! \brief An in-memory snapshot of a simulation's time-varying state.
+//!
+//! A Checkpoint holds everything needed to resume an extended period
+//! simulation from a given point in time: the computed state of each node
+//! and link, the time keeping variables of the hydraulic and water quality
+//! engines, and the contents of the water quality solver's volume segments.
+//! Element state is stored by index so a checkpoint taken from one project
+//! can be restored into any other project built from the same input data.
+
+class Checkpoint
+{
+  public:
+
+    Checkpoint();
+    ~Checkpoint();
+
+    void   clear();
+    bool   isEmpty() { return nodeHead.size() == 0; }
+    void   saveNetwork(Network* nw);
+    bool   restoreNetwork(Network* nw, bool hydraulicsOnly = false);
+    bool   matchesNetwork(Network* nw, double headTol);
+
+    // Hydraulic engine state
+    bool        halted;            //!< true if simulation was halted
+    int         currentTime;       //!< current simulation time (sec)
+    int         rptTime;           //!< current reporting time (sec)
+    int         hydStep;           //!< current hydraulic time step (sec)
+    int         adaptiveStep;      //!< error-controlled time step (sec)
+    int         timeOfDay;         //!< current time of day (sec)
+    double      peakKwatts;        //!< peak energy usage (kwatts)
+    std::string timeStepReason;    //!< reason for taking next time step
+    std::vector<int> ruleActions;  //!< rule actions pending for next time step
+
+    // Water quality engine state
+    int               qualTime;        //!< current quality time (sec)
+    std::vector<int>  sortedLinks;     //!< links in topological order
+    std::vector<char> flowDirection;   //!< direction (+/-) of link flow
+    std::vector<int>  nodeOrder;       //!< nodes in topological order
+    int               cyclicLinks;     //!< number of links closing a flow cycle
+    QualBalance       qualBalance;     //!< water quality mass balance
+    InjectionImpacts  injectionImpacts; //!< impacts of injected species
+
+    // Water quality solver state
+    std::vector<int>    segCount;      //!< number of segments in each list
+    std::vector<double> segVolume;     //!< volume of each segment (ft3)
+    std::vector<double> segQuality;    //!< quality of each segment (mass/ft3)
+    std::vector<double> tankQuality;   //!< internal quality of each tank
+    std::vector<double> segSpecies;    //!< species values of each pipe segment
+    std::vector<double> nodeSpecies;   //!< species values at each node
+    double              mergeCount;    //!< number of segments merged so far
+    int                 peakSegCount;  //!< largest number of segments held
+    size_t              peakSegMemory; //!< largest memory used by segments (bytes)
+
+  private:
+
+    // Node state
+    std::vector<char>   nodeFixedGrade;
+    std::vector<double> nodeHead;
+    std::vector<double> nodeQGrad;
+    std::vector<double> nodeFullDemand;
+    std::vector<double> nodeActualDemand;
+    std::vector<double> nodeOutflow;
+    std::vector<double> nodeQuality;
+
+    // Tank state (one entry per tank, in node index order)
+    std::vector<double> tankVolume;
+    std::vector<double> tankArea;
+    std::vector<double> tankPastHead;
+    std::vector<double> tankPastVolume;
+    std::vector<double> tankPastOutflow;
+
+    // Water quality source state (one entry per source, in node index order)
+    std::vector<double> sourceStrength;
+    std::vector<double> sourceOutflow;
+    std::vector<double> sourceQuality;
+
+    // Link state
+    std::vector<int>    linkStatus;
+    std::vector<double> linkFlow;
+    std::vector<double> linkLeakage;
+    std::vector<double> linkHLoss;
+    std::vector<double> linkHGrad;
+    std::vector<double> linkSetting;
+    std::vector<double> linkQuality;
+
+    // Pump state (one entry per pump, in link index order)
+    std::vector<double>     pumpSpeed;
+    std::vector<PumpEnergy> pumpEnergy;
+};
+
+#endif
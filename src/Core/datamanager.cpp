@@ -48,13 +48,14 @@ int DataManager::getCount(int element, int* count, Network* nw)
     case EN_PATCOUNT:     *count = nw->count(Element::PATTERN); break;
     case EN_CURVECOUNT:   *count = nw->count(Element::CURVE); break;
     case EN_CONTROLCOUNT: *count = nw->count(Element::CONTROL); break;
-    case EN_RULECOUNT:    break;
+    case EN_RULECOUNT:    *count = nw->count(Element::RULE); break;
     case EN_TANKCOUNT:
         for (Node* node : nw->nodes) if ( node->type() == Node::TANK ) (*count)++;
         break;
     case EN_RESVCOUNT:
         for (Node* node : nw->nodes) if ( node->type() == Node::RESERVOIR ) (*count)++;
          break;
+    case EN_SPECIESCOUNT: *count = nw->speciesModel.count(); break;
     default: err = 203;
     }
     return err;
@@ -71,6 +72,15 @@ int DataManager::getNodeIndex(char* name, int* index, Network* nw)
 
 //-----------------------------------------------------------------------------
 
+int DataManager::getSpeciesIndex(char* name, int* index, Network* nw)
+{
+    *index = nw->speciesModel.indexOf(name);
+    if ( *index < 0 ) return 205;
+    return 0;
+}
+
+//-----------------------------------------------------------------------------
+
 int DataManager::getNodeId(int index, char* id, Network* nw)
 {
     if ( index < 0 || index >= nw->count(Element::NODE) )
@@ -19,6 +19,7 @@ struct DataManager
     static int getCount(int element, int* count, Network* nw);
 
     static int getNodeIndex(char* name, int* index, Network* nw);
+    static int getSpeciesIndex(char* name, int* index, Network* nw);
     static int getNodeId(int index, char* id, Network* nw);
     static int getNodeType(int index, int* type, Network* nw);
     static int getNodeValue(int index, int param, double* value, Network* nw);
@@ -218,6 +218,165 @@ int EN_advanceSolver(int *dt, EN_Project p)
 
 //-----------------------------------------------------------------------------
 
+int EN_saveCheckpoint(EN_Project p)
+{
+    return project(p)->saveCheckpoint();
+}
+
+//-----------------------------------------------------------------------------
+
+int EN_restoreCheckpoint(EN_Project p)
+{
+    return project(p)->restoreCheckpoint();
+}
+
+//-----------------------------------------------------------------------------
+
+int EN_forkProject(EN_Project pFork, EN_Project pSource)
+{
+    if ( pSource == nullptr || pFork == nullptr ) return 102;
+    return project(pFork)->fork(project(pSource));
+}
+
+//-----------------------------------------------------------------------------
+
+int EN_openStream(int capacity, EN_Project p)
+{
+    return project(p)->openStream(capacity);
+}
+
+//-----------------------------------------------------------------------------
+
+int EN_setBoundary(int type, int index, double value, EN_Project p)
+{
+    return project(p)->setBoundary(type, index, value);
+}
+
+//-----------------------------------------------------------------------------
+
+int EN_clearBoundaries(EN_Project p)
+{
+    return project(p)->clearBoundaries();
+}
+
+//-----------------------------------------------------------------------------
+
+int EN_solveStream(int t, EN_Project p)
+{
+    return project(p)->solveStream(t);
+}
+
+//-----------------------------------------------------------------------------
+
+int EN_runStream(const char* feedFile, EN_Project p)
+{
+    return project(p)->runStream(feedFile);
+}
+
+//-----------------------------------------------------------------------------
+
+long EN_readStream(long afterFrame, int* t, double* nodeHead,
+                   double* nodeDemand, double* linkFlow, EN_Project p)
+{
+    return project(p)->readStream(afterFrame, t, nodeHead, nodeDemand, linkFlow);
+}
+
+//-----------------------------------------------------------------------------
+
+int EN_openFlowHistory(EN_Project p)
+{
+    return project(p)->openFlowHistory();
+}
+
+//-----------------------------------------------------------------------------
+
+int EN_trackSources(int node, int t, int maxAge, int* count, EN_Project p)
+{
+    return project(p)->trackSources(node, t, maxAge, count);
+}
+
+//-----------------------------------------------------------------------------
+
+int EN_getTrackedSource(int index, int* node, double* fraction, double* meanAge,
+                        EN_Project p)
+{
+    return project(p)->getTrackedSource(index, node, fraction, meanAge);
+}
+
+//-----------------------------------------------------------------------------
+
+int EN_getTrackedArrivals(int index, int binWidth, int binCount, double* fractions,
+                          EN_Project p)
+{
+    return project(p)->getTrackedArrivals(index, binWidth, binCount, fractions);
+}
+
+//-----------------------------------------------------------------------------
+
+int EN_getTrackedPath(int index, int size, int* links, int* count, EN_Project p)
+{
+    return project(p)->getTrackedPath(index, size, links, count);
+}
+
+//-----------------------------------------------------------------------------
+
+int EN_findReachable(int node, int direction, int maxTime, int* nodeCount,
+                     int* linkCount, EN_Project p)
+{
+    return project(p)->findReachable(node, direction, maxTime, nodeCount, linkCount);
+}
+
+//-----------------------------------------------------------------------------
+
+int EN_getReachedNodes(int* nodes, EN_Project p)
+{
+    return project(p)->getReachedNodes(nodes);
+}
+
+//-----------------------------------------------------------------------------
+
+int EN_getReachedLinks(int* links, EN_Project p)
+{
+    return project(p)->getReachedLinks(links);
+}
+
+//-----------------------------------------------------------------------------
+
+int EN_getQualStatistic(int type, double* value, EN_Project p)
+{
+    return project(p)->getQualStatistic(type, value);
+}
+
+//-----------------------------------------------------------------------------
+
+int EN_getSpeciesIndex(char* name, int* index, EN_Project p)
+{
+    return DataManager::getSpeciesIndex(name, index, project(p)->getNetwork());
+}
+
+//-----------------------------------------------------------------------------
+
+int EN_getNodeSpecies(int node, int species, double* value, EN_Project p)
+{
+    return project(p)->getSpeciesValue(0, node, species, value);
+}
+
+//-----------------------------------------------------------------------------
+
+int EN_getLinkSpecies(int link, int species, double* value, EN_Project p)
+{
+    return project(p)->getSpeciesValue(1, link, species, value);
+}
+
+//-----------------------------------------------------------------------------
+
+int EN_getInjectionImpact(int species, int type, double* value, EN_Project p)
+{
+    return project(p)->getInjectionImpact(species, type, value);
+}
+
+//-----------------------------------------------------------------------------
+
 int EN_openOutputFile(const char* fname, EN_Project p)
 {
     return project(p)->openOutput(fname);
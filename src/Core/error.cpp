@@ -28,7 +28,10 @@ static const int SystemErrorCodes[] =
     110, //HYDRAULICS_SOLVER_FAILURE,
     111, //QUALITY_SOLVER_FAILURE
 
-    112  //SOLVER_NOT_INITIALIZED,
+    112, //SOLVER_NOT_INITIALIZED,
+    113, //NO_CHECKPOINT
+    114, //STREAM_NOT_OPENED
+    115  //FLOW_HISTORY_NOT_OPENED
  };
 
 static const char* SystemErrorMsgs[] =
@@ -44,7 +47,10 @@ static const char* SystemErrorMsgs[] =
     "\n\n*** SYSTEM ERROR 109: QUALITY SOLVER NOT OPENED",
     "\n\n*** SYSTEM ERROR 110: HYDRAULIC SOLVER FAILURE",
     "\n\n*** SYSTEM ERROR 111: QUALITY SOLVER FAILURE",
-    "\n\n*** SYSTEM ERROR 112: SOLVER NOT INITIALIZED"
+    "\n\n*** SYSTEM ERROR 112: SOLVER NOT INITIALIZED",
+    "\n\n*** SYSTEM ERROR 113: NO VALID SIMULATION CHECKPOINT",
+    "\n\n*** SYSTEM ERROR 114: STREAMING MODE NOT OPENED",
+    "\n\n*** SYSTEM ERROR 115: FLOW HISTORY NOT BEING RECORDED"
 };
 
 static const int InputErrorCodes[] =
@@ -57,7 +63,8 @@ static const int InputErrorCodes[] =
     205, //UNDEFINED_OBJECT
     206, //INVALID_NUMBER
     207, //INVALID_TIME
-    208  //UNSPECIFIED
+    208, //UNSPECIFIED
+    209  //SPECIES_NOT_SUPPORTED
 };
 
 static const char* InputErrorMsgs[] =
@@ -70,7 +77,8 @@ static const char* InputErrorMsgs[] =
     "\n\n*** INPUT ERROR 205: undefined object ",
     "\n\n*** INPUT ERROR 206: invalid number ",
     "\n\n*** INPUT ERROR 207: invalid time ",
-    "\n\n*** UNSPECIFIED INPUT ERROR "
+    "\n\n*** UNSPECIFIED INPUT ERROR ",
+    "\n\n*** INPUT ERROR 209: species cannot be carried by quality solver "
 };
 
 static const int NetworkErrorCodes[] =
@@ -153,7 +161,7 @@ SystemError::SystemError(int type)
 
 InputError::InputError(int type, string token)
 {
-    if (type < 0 || type >= UNSPECIFIED) type = UNSPECIFIED;
+    if (type < 0 || type >= INPUT_ERROR_LIMIT) type = UNSPECIFIED;
     code = InputErrorCodes[type];
     msg = InputErrorMsgs[type] + token;
 }
@@ -47,6 +47,9 @@ class SystemError : public ENerror
         HYDRAULICS_SOLVER_FAILURE,     //110
         QUALITY_SOLVER_FAILURE,        //111
         SOLVER_NOT_INITIALIZED,        //112
+        NO_CHECKPOINT,                 //113
+        STREAM_NOT_OPENED,             //114
+        FLOW_HISTORY_NOT_OPENED,       //115
         SYSTEM_ERROR_LIMIT
     };
     SystemError(int type);
@@ -68,6 +71,7 @@ class InputError : public ENerror
         INVALID_NUMBER,                //206
         INVALID_TIME,                  //207
         UNSPECIFIED,                   //208
+        SPECIES_NOT_SUPPORTED,         //209
         INPUT_ERROR_LIMIT
     };
     InputError(int type, std::string token);
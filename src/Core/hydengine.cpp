@@ -16,12 +16,14 @@
 #include "hydengine.h"
 #include "network.h"
 #include "error.h"
+#include "checkpoint.h"
 #include "Solvers/hydsolver.h"
 #include "Solvers/matrixsolver.h"
 #include "Elements/link.h"
 #include "Elements/tank.h"
 #include "Elements/pattern.h"
 #include "Elements/control.h"
+#include "Elements/rule.h"
 #include "Utilities/utilities.h"
 
 #include <iostream>
@@ -29,6 +31,8 @@
 #include <iomanip>
 #include <string>
 #include <vector>
+#include <limits>
+#include <cmath>
 using namespace std;
 
 //static const string s_Balancing  = " Balancing the network:";
@@ -48,6 +52,9 @@ static const string s_ReSolve2    =
     "\n    Re-solving network with these reductions made.";
 static const string s_Reductions2 =
     " nodes require further demand reductions to 0.";
+static const string s_ByBoundary  = " by boundary condition";
+
+static const int MIN_ADAPTIVE_STEP = 60;  // smallest error-controlled step (sec)
 
 //-----------------------------------------------------------------------------
 
@@ -60,12 +67,23 @@ HydEngine::HydEngine() :
     matrixSolver(nullptr),
     saveToFile(false),
     halted(false),
+    stopped(false),
     startTime(0),
     rptTime(0),
     hydStep(0),
+    adaptiveStep(0),
     currentTime(0),
     timeOfDay(0),
-    peakKwatts(0.0)
+    peakKwatts(0.0),
+    eventsScheduled(false),
+    patternsChanged(false),
+    tankBase(0),
+    controlBase(0),
+    inputPeriod(0),
+    cyclePeriod(0),
+    cycleStart(0),
+    cycleReplay(false),
+    cyclePos(0)
 {
 }
 
@@ -115,6 +133,10 @@ void HydEngine::open(Network* nw)
     {
         throw SystemError(SystemError::HYDRAULIC_SOLVER_NOT_OPENED);
     }
+
+    // ... compile the network's rule-based controls
+
+    ruleEngine.open(network);
     engineState = HydEngine::OPENED;
 }
 
@@ -147,11 +169,23 @@ void HydEngine::init(bool initFlows)
     halted = 0;
     currentTime = 0;
     hydStep = 0;
+
+    // ... an adaptive step starts small and grows as inflow trends emerge
+    adaptiveStep = min(MIN_ADAPTIVE_STEP, (int)network->option(Options::HYD_STEP));
     startTime = network->option(Options::START_TIME);
     rptTime = network->option(Options::REPORT_START);
     peakKwatts = 0.0;
     engineState = HydEngine::INITIALIZED;
     timeStepReason = "";
+
+    Control::indexPressureControls(network);
+    eventsScheduled = false;
+    ruleEngine.init();
+
+    inputPeriod = findInputPeriod();
+    cyclePeriod = findCyclePeriod();
+    resetCycle();
+    stopped = false;
 }
 
 //-----------------------------------------------------------------------------
@@ -169,6 +203,15 @@ int  HydEngine::solve(int* t)
 
     *t = currentTime;
     timeOfDay = (currentTime + startTime) % 86400;
+
+    // ... re-use the solution found at this point of a repeating cycle
+
+    if ( cycleReplay )
+    {
+        cycleStates[cyclePos].restoreNetwork(network, true);
+        return HydSolver::SUCCESSFUL;
+    }
+
     updateCurrentConditions();
 
     //if ( network->option(Options::REPORT_TRIALS) )  network->msgLog << endl;
@@ -181,6 +224,7 @@ int  HydEngine::solve(int* t)
     }
     reportDiagnostics(statusCode, trials);
     if ( halted ) throw SystemError(SystemError::HYDRAULICS_SOLVER_FAILURE);
+    if ( cyclePeriod > 0 ) updateCycle();
     return statusCode;
 }
 
@@ -198,12 +242,27 @@ void HydEngine::advance(int* tstep)
 
     // ... if time remains, find time (hydStep) until next hydraulic event
 
+    int lastStep = hydStep;
     hydStep = 0;
     int timeLeft = network->option(Options::TOTAL_DURATION) - currentTime;
-    if ( halted ) timeLeft = 0;
+    if ( halted || stopped ) timeLeft = 0;
     if ( timeLeft > 0  )
     {
-        hydStep = getTimeStep();
+        if ( cycleReplay )
+        {
+            hydStep = cycleSteps[cyclePos];
+            timeStepReason = cycleReasons[cyclePos];
+            cyclePos = (cyclePos + 1) % cycleStates.size();
+        }
+        else
+        {
+            hydStep = getTimeStep(lastStep);
+            if ( cycleStates.size() > 0 )
+            {
+                cycleSteps.back() = hydStep;
+                cycleReasons.back() = timeStepReason;
+            }
+        }
         if ( hydStep > timeLeft ) hydStep = timeLeft;
     }
     *tstep = hydStep;
@@ -221,9 +280,9 @@ void HydEngine::advance(int* tstep)
         rptTime += network->option(Options::REPORT_STEP);
     }
 
-    // ... advance time patterns
+    // ... advance time patterns and reschedule any expired events
 
-    updatePatterns();
+    updateEvents();
 }
 
 //-----------------------------------------------------------------------------
@@ -237,6 +296,8 @@ void HydEngine::close()
     matrixSolver = nullptr;
     delete hydSolver;
     hydSolver = nullptr;
+    ruleEngine.close();
+    boundaries.clear();
     engineState = HydEngine::CLOSED;
 
     //... Other objects created in HydEngine::open() belong to the
@@ -245,6 +306,171 @@ void HydEngine::close()
 
 //-----------------------------------------------------------------------------
 
+//  Saves the engine's time keeping state and the network's hydraulic state.
+
+void HydEngine::saveState(Checkpoint& cp)
+{
+    if ( engineState != HydEngine::INITIALIZED )
+        throw SystemError(SystemError::SOLVER_NOT_INITIALIZED);
+
+    cp.saveNetwork(network);
+    cp.halted = halted;
+    cp.currentTime = currentTime;
+    cp.rptTime = rptTime;
+    cp.hydStep = hydStep;
+    cp.adaptiveStep = adaptiveStep;
+    cp.timeOfDay = timeOfDay;
+    cp.peakKwatts = peakKwatts;
+    cp.timeStepReason = timeStepReason;
+    ruleEngine.getPendingActions(cp.ruleActions);
+}
+
+//-----------------------------------------------------------------------------
+
+//  Restores the engine's time keeping state and the network's hydraulic state.
+
+void HydEngine::restoreState(Checkpoint& cp)
+{
+    if ( engineState != HydEngine::INITIALIZED )
+        throw SystemError(SystemError::SOLVER_NOT_INITIALIZED);
+    if ( !cp.restoreNetwork(network) )
+        throw SystemError(SystemError::NO_CHECKPOINT);
+
+    halted = cp.halted;
+    currentTime = cp.currentTime;
+    rptTime = cp.rptTime;
+    hydStep = cp.hydStep;
+    adaptiveStep = cp.adaptiveStep;
+    timeOfDay = cp.timeOfDay;
+    peakKwatts = cp.peakKwatts;
+    timeStepReason = cp.timeStepReason;
+
+    movePatterns(currentTime);
+    eventsScheduled = false;
+    ruleEngine.setPendingActions(cp.ruleActions);
+    resetCycle();
+    stopped = false;
+}
+
+//-----------------------------------------------------------------------------
+
+//  Moves the simulation clock directly to time t without updating tank levels
+//  (used to re-solve hydraulics at arbitrary times from the current state).
+
+void HydEngine::setTime(int t)
+{
+    if ( engineState != HydEngine::INITIALIZED )
+        throw SystemError(SystemError::SOLVER_NOT_INITIALIZED);
+    if ( t == currentTime ) return;
+    currentTime = t;
+    hydStep = 0;
+    movePatterns(currentTime);
+    eventsScheduled = false;
+    resetCycle();
+}
+
+//-----------------------------------------------------------------------------
+
+//  Moves the simulation clock ahead by dt seconds, a whole number of input
+//  periods, once the network's state has become periodic (so the state
+//  found now is also the one that would be found dt seconds later).
+
+void HydEngine::skipTime(int dt)
+{
+    if ( engineState != HydEngine::INITIALIZED )
+        throw SystemError(SystemError::SOLVER_NOT_INITIALIZED);
+    if ( dt <= 0 ) return;
+    currentTime += dt;
+    int rptStep = network->option(Options::REPORT_STEP);
+    while ( rptTime < currentTime ) rptTime += rptStep;
+    movePatterns(currentTime);
+    eventsScheduled = false;
+    resetCycle();
+}
+
+//-----------------------------------------------------------------------------
+
+//  Moves each time pattern to the period containing time t.
+
+void HydEngine::movePatterns(int t)
+{
+    int patternStep = network->option(Options::PATTERN_STEP);
+    int patternStart = network->option(Options::PATTERN_START);
+    for (Pattern* pattern : network->patterns)
+    {
+        pattern->init(patternStep, patternStart);
+        pattern->advance(t);
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+//  Sets a value that overrides a tank's level, a node's demand or a link's
+//  status or setting each time hydraulics are solved (value is in internal
+//  units and replaces any previous override of the same kind on the object).
+
+void HydEngine::setBoundary(int type, int index, double value)
+{
+    for (Boundary& b : boundaries)
+    {
+        if ( b.type == type && b.index == index )
+        {
+            b.value = value;
+            return;
+        }
+    }
+    boundaries.push_back({type, index, value});
+}
+
+//-----------------------------------------------------------------------------
+
+//  Imposes the current boundary condition overrides on the network.
+
+void HydEngine::applyBoundaries()
+{
+    for (Boundary& b : boundaries)
+    {
+        switch (b.type)
+        {
+        case TANK_LEVEL:
+        {
+            Tank* tank = static_cast<Tank*>(network->node(b.index));
+            tank->head = tank->elev + b.value;
+            tank->volume = tank->findVolume(tank->head);
+            break;
+        }
+
+        case NODE_DEMAND:
+            network->node(b.index)->fullDemand = b.value;
+            break;
+
+        case LINK_STATUS:
+        case LINK_SETTING:
+        {
+            Link* link = network->link(b.index);
+            string reason = link->typeStr() + " " + link->name;
+            if ( b.type == LINK_STATUS )
+            {
+                int status = (int)b.value;
+                reason += (status == Link::LINK_CLOSED ?
+                          " status changed to closed" : " status changed to open");
+                link->changeStatus(status, true, reason + s_ByBoundary,
+                                   network->msgLog);
+            }
+            else
+            {
+                reason += " setting changed to " + Utilities::to_string(b.value);
+                link->changeSetting(b.value, true, reason + s_ByBoundary,
+                                    network->msgLog);
+            }
+            break;
+        }
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+
 //  Initializes the matrix equation solver.
 
 void HydEngine::initMatrixSolver()
@@ -312,12 +538,20 @@ void HydEngine::updateCurrentConditions()
         link->applyControlPattern(network->msgLog);
     }
 
+    // ... apply link changes called for by rule-based controls
+
+    ruleEngine.applyActions();
+
     // ... apply simple conditional controls
 
     for (Control* control : network->controls)
     {
         control->apply(network, currentTime, timeOfDay);
     }
+
+    // ... impose any externally supplied boundary conditions
+
+    if ( boundaries.size() > 0 ) applyBoundaries();
 }
 
 //-----------------------------------------------------------------------------
@@ -444,8 +678,12 @@ void HydEngine::reportDiagnostics(int statusCode, int trials)
 
 //  Determines the next time step to advance hydraulics.
 
-int HydEngine::getTimeStep()
+int HydEngine::getTimeStep(int lastStep)
 {
+    // ... see if the last step ended at a change in operating conditions
+
+    bool afterEvent = patternsChanged || timeStepReason.size() > 0;
+
     // ... normal time step is user-supplied hydraulic time step
 
     string reason ;
@@ -463,96 +701,226 @@ int HydEngine::getTimeStep()
         timeStepReason = "";
     }
 
-    // ... adjust for time until next time pattern change
+    // ... adjust for the earliest pattern change, tank closure or
+    //     control activation
 
-    tstep = timeToPatternChange(tstep);
+    tstep = timeToNextEvent(tstep);
 
-    // ... adjust for shortest time to fill or drain a tank
+    // ... adjust for the error in integrating tank levels over the step
 
-    tstep = timeToCloseTank(tstep);
+    if ( network->option(Options::TANK_TOLERANCE) > 0.0 )
+    {
+        tstep = limitTankError(tstep, lastStep, afterEvent);
+    }
 
-    // ... adjust for shortest time to activate a simple control
+    // ... adjust for the first rule-based control that changes a link
 
-    tstep = timeToActivateControl(tstep);
+    if ( ruleEngine.hasRules() )
+    {
+        t = ruleEngine.timeStep(currentTime, tstep, startTime);
+        if ( t < tstep )
+        {
+            tstep = t;
+            timeStepReason = "  (rule activated)";
+        }
+    }
     return tstep;
 }
 
 //-----------------------------------------------------------------------------
 
-//  Finds shortest time until next change for all time patterns.
+//  Finds the time until the earliest pending event that occurs before tstep.
 
-int HydEngine::timeToPatternChange(int tstep)
+int HydEngine::timeToNextEvent(int tstep)
 {
-    Pattern* changedPattern = nullptr;
-    for (Pattern* pattern : network->patterns)
+    if ( !eventsScheduled ) scheduleEvents();
+
+    // ... reschedule the forecasts of tanks whose outflow has changed
+    for (size_t i = 0; i < tanks.size(); i++)
+    {
+        if ( tanks[i]->outflow != tankOutflow[i] ) scheduleTank(i);
+    }
+
+    // ... examine events in time order, setting aside controls that
+    //     would not change the state of their link
+    vector<int> skipped;
+    int eventId = -1;
+    while ( !eventQueue.empty() )
     {
-        int t = pattern->nextTime(currentTime) - currentTime;
-        if ( t > 0 && t < tstep )
+        int id = eventQueue.topId();
+        int t = eventQueue.topTime() - currentTime;
+        if ( t >= tstep ) break;
+        if ( id >= controlBase &&
+             !network->control(id - controlBase)->canActivate(network) )
         {
-            tstep = t;
-            changedPattern = pattern;
+            skipped.push_back(id);
+            eventQueue.pop();
+            continue;
         }
+        tstep = t;
+        eventId = id;
+        break;
+    }
+    for (int id : skipped) eventQueue.schedule(id, eventQueue.timeOf(id));
+
+    // ... identify the reason for the time step
+    if ( eventId >= controlBase )
+    {
+        timeStepReason = "  (control activated)";
+    }
+    else if ( eventId >= tankBase )
+    {
+        timeStepReason = "  (Tank " + tanks[eventId - tankBase]->name + " closed)";
     }
-    if ( changedPattern )
+    else if ( eventId >= 0 )
     {
-        timeStepReason = "  (change in Pattern " + changedPattern->name + ")";
+        timeStepReason = "  (change in Pattern " + network->pattern(eventId)->name + ")";
     }
     return tstep;
 }
 
 //-----------------------------------------------------------------------------
 
-//  Finds the shortest time to completely fill or empty all tanks.
+//  Places the next occurrence of each time pattern change, tank closure and
+//  simple control activation in the event queue.
 
-int HydEngine::timeToCloseTank(int tstep)
+void HydEngine::scheduleEvents()
 {
-    Tank* closedTank = nullptr;
+    int patternCount = network->count(Element::PATTERN);
+    int controlCount = network->count(Element::CONTROL);
+
+    // ... collect the network's tanks
+    tanks.clear();
     for (Node* node : network->nodes)
     {
-        // ... check if node is a tank
+        if ( node->type() == Node::TANK ) tanks.push_back(static_cast<Tank*>(node));
+    }
+    int tankCount = tanks.size();
+    tankOutflow.assign(tankCount, 0.0);
 
-        if ( node->type() == Node::TANK )
-        {
-            // ... find the time to fill (or empty) the tank
+    // ... index each tank's level controls
+    vector<int> tankOf(network->count(Element::NODE), -1);
+    for (int i = 0; i < tankCount; i++) tankOf[tanks[i]->index] = i;
+    tankControlBeg.assign(tankCount + 1, 0);
+    for (Control* control : network->controls)
+    {
+        if ( control->getType() == Control::TANK_LEVEL )
+            tankControlBeg[tankOf[control->getNode()->index] + 1]++;
+    }
+    for (int i = 0; i < tankCount; i++) tankControlBeg[i+1] += tankControlBeg[i];
+    tankControls.resize(tankControlBeg[tankCount]);
+    vector<int> next(tankControlBeg.begin(), tankControlBeg.end() - 1);
+    for (int i = 0; i < controlCount; i++)
+    {
+        Control* control = network->control(i);
+        if ( control->getType() == Control::TANK_LEVEL )
+            tankControls[next[tankOf[control->getNode()->index]]++] = i;
+    }
 
-            Tank* tank = static_cast<Tank*>(node);
-            int t = tank->timeToVolume(tank->minVolume);
-            if ( t <= 0 ) t = tank->timeToVolume(tank->maxVolume);
+    // ... event ids are patterns, then tanks, then controls so that
+    //     simultaneous events are reported in that order
+    tankBase = patternCount;
+    controlBase = tankBase + tankCount;
+    eventQueue.init(controlBase + controlCount);
 
-            // ... compare this time with current time step
+    for (int i = 0; i < patternCount; i++) schedulePattern(i);
+    for (int i = 0; i < tankCount; i++) scheduleTank(i);
+    for (int i = 0; i < controlCount; i++)
+    {
+        int type = network->control(i)->getType();
+        if ( type == Control::ELAPSED_TIME || type == Control::TIME_OF_DAY )
+            scheduleControl(i);
+    }
+    eventsScheduled = true;
+}
 
-            if ( t > 0 && t < tstep )
-            {
-                tstep = t;
-                closedTank = tank;
-            }
-        }
+//-----------------------------------------------------------------------------
+
+//  Schedules the next occurrence of an event given its id.
+
+void HydEngine::scheduleEvent(int id)
+{
+    if ( id >= controlBase ) scheduleControl(id - controlBase);
+    else if ( id >= tankBase ) scheduleTank(id - tankBase);
+    else schedulePattern(id);
+}
+
+//-----------------------------------------------------------------------------
+
+//  Schedules the next change in time pattern i.
+
+void HydEngine::schedulePattern(int i)
+{
+    Pattern* pattern = network->pattern(i);
+    int t = pattern->nextTime(currentTime);
+    if ( t <= currentTime )
+    {
+        pattern->advance(currentTime);
+        t = pattern->nextTime(currentTime);
     }
-    if ( closedTank )
+    if ( t > currentTime && t < numeric_limits<int>::max() )
+        eventQueue.schedule(i, t);
+    else eventQueue.cancel(i);
+}
+
+//-----------------------------------------------------------------------------
+
+//  Schedules the time when tank i fills or empties along with the
+//  activation times of the level controls attached to it.
+
+void HydEngine::scheduleTank(int i)
+{
+    Tank* tank = tanks[i];
+    tankOutflow[i] = tank->outflow;
+
+    int t = tank->timeToVolume(tank->minVolume);
+    if ( t <= 0 ) t = tank->timeToVolume(tank->maxVolume);
+    if ( t > 0 ) eventQueue.schedule(tankBase + i, currentTime + t);
+    else eventQueue.cancel(tankBase + i);
+
+    for (int j = tankControlBeg[i]; j < tankControlBeg[i+1]; j++)
     {
-        timeStepReason = "  (Tank " + closedTank->name + " closed)";
+        scheduleControl(tankControls[j]);
     }
-    return tstep;
 }
 
 //-----------------------------------------------------------------------------
 
-//  Finds the shortest time to activate a simple control.
+//  Schedules the next time that control i's trigger condition is met.
 
-int HydEngine::timeToActivateControl(int tstep)
+void HydEngine::scheduleControl(int i)
 {
-    bool activated = false;
-    for (Control* control : network->controls)
+    Control* control = network->control(i);
+    int tod = (currentTime + startTime) % 86400;
+    int t = control->timeToTrigger(currentTime, tod);
+
+    // ... a time of day control that triggers now next triggers a day later
+    if ( t == 0 && control->getType() == Control::TIME_OF_DAY ) t = 86400;
+
+    if ( t > 0 ) eventQueue.schedule(controlBase + i, currentTime + t);
+    else eventQueue.cancel(controlBase + i);
+}
+
+//-----------------------------------------------------------------------------
+
+//  Advances the time patterns whose period has ended and reschedules all
+//  other events that have expired.
+
+void HydEngine::updateEvents()
+{
+    patternsChanged = false;
+    if ( !eventsScheduled ) return;
+    while ( !eventQueue.empty() && eventQueue.topTime() <= currentTime )
     {
-        int t = control->timeToActivate(network, currentTime, timeOfDay);
-        if ( t > 0 && t < tstep )
+        int id = eventQueue.topId();
+        eventQueue.pop();
+        if ( id < tankBase )
         {
-            tstep = t;
-            activated = true;
+            network->pattern(id)->advance(currentTime);
+            patternsChanged = true;
         }
+        scheduleEvent(id);
     }
-    if ( activated ) timeStepReason = "  (control activated)";
-    return tstep;
 }
 
 //-----------------------------------------------------------------------------
@@ -603,12 +971,180 @@ void HydEngine::updateTanks()
 
 //-----------------------------------------------------------------------------
 
-//  Advances all time patterns.
+//  Shortens a time step so that the error in integrating tank levels over
+//  it stays within the TANK_TOLERANCE option.
+//
+//  Tank volumes are advanced with the net inflow found at the start of each
+//  step, whose local error grows with the rate of change of that inflow:
+//  err = 0.5 * |dq/dt| * dt^2 / area. The rate of change is estimated from
+//  the inflows at the start and end of the last step (lastStep sec long)
+//  unless that step ended at a pattern change, control action or other
+//  discrete event, whose jump in inflow says nothing about truncation error.
+
+int HydEngine::limitTankError(int tstep, int lastStep, bool afterEvent)
+{
+    int maxStep = network->option(Options::HYD_STEP);
+    int minStep = min(MIN_ADAPTIVE_STEP, maxStep);
+    double tol = network->option(Options::TANK_TOLERANCE) /
+                 network->ucf(Units::LENGTH);
+
+    // ... find the largest step meeting the tolerance in every tank
+
+    if ( lastStep > 0 && !afterEvent )
+    {
+        double step = maxStep;
+        for (Tank* tank : tanks)
+        {
+            if ( tank->area <= 0.0 ) continue;
+            double dqdt = abs(tank->outflow - tank->pastOutflow) / lastStep;
+            if ( dqdt == 0.0 ) continue;
+            step = min(step, 0.9 * sqrt(2.0 * tol * tank->area / dqdt));
+        }
+
+        // ... don't let the step grow too quickly
+        step = min(step, 2.0 * adaptiveStep);
+        adaptiveStep = max(minStep, (int)step);
+    }
+    if ( adaptiveStep >= tstep ) return tstep;
 
-void HydEngine::updatePatterns()
+    // ... when a tank limit or level control would be reached within two
+    //     steps, take an intermediate step halfway to it so that its
+    //     timing is forecast from more current flows
+
+    int step = adaptiveStep;
+    if ( !eventQueue.empty() && eventQueue.topId() >= tankBase )
+    {
+        int t = eventQueue.topTime() - currentTime;
+        if ( t > step && t < 2 * step ) step = max(minStep, t / 2);
+    }
+    timeStepReason = "";
+    return step;
+}
+
+//-----------------------------------------------------------------------------
+
+//  Finds the period (sec) over which all time-dependent inputs repeat, or 0
+//  if hydraulics can't be assumed to become periodic.
+
+int HydEngine::findInputPeriod()
 {
+    const long long maxPeriod = 7 * 86400;
+
+    // ... elapsed time controls and rules never repeat
+
+    for (Control* control : network->controls)
+    {
+        if ( control->getType() == Control::ELAPSED_TIME ) return 0;
+    }
+    for (Rule* rule : network->rules)
+    {
+        for (RulePremise& premise : rule->premises)
+        {
+            if ( premise.variable == RulePremise::TIME ) return 0;
+        }
+    }
+
+    // ... the period must span whole days and whole cycles of each pattern
+
+    long long period = 86400;
     for (Pattern* pattern : network->patterns)
     {
-        pattern->advance(currentTime);
+        if ( pattern->type != Pattern::FIXED_PATTERN ) return 0;
+        long long p = (long long)pattern->timeInterval() * pattern->size();
+        if ( p <= 0 ) return 0;
+        long long a = period, b = p;
+        while ( b > 0 )
+        {
+            long long r = a % b;
+            a = b;
+            b = r;
+        }
+        period = period / a * p;
+        if ( period > maxPeriod ) return 0;
+    }
+    return (int)period;
+}
+
+//-----------------------------------------------------------------------------
+
+//  Finds the period (sec) of the hydraulic cycle to record and re-use, or 0
+//  if there's none.
+
+int HydEngine::findCyclePeriod()
+{
+    if ( network->option(Options::CYCLE_TOLERANCE) <= 0.0 ) return 0;
+    int period = inputPeriod;
+    if ( period == 0 ) return 0;
+
+    // ... time steps and reporting times must line up from cycle to cycle,
+    //     and there must be time left to re-use a recorded cycle
+
+    if ( period % network->option(Options::HYD_STEP) != 0 ) return 0;
+    if ( period % network->option(Options::REPORT_STEP) != 0 ) return 0;
+    if ( 2 * period >= network->option(Options::TOTAL_DURATION) ) return 0;
+    return period;
+}
+
+//-----------------------------------------------------------------------------
+
+//  Discards any recorded hydraulic cycle.
+
+void HydEngine::resetCycle()
+{
+    cycleReplay = false;
+    cyclePos = 0;
+    cycleStart = 0;
+    cycleStates.clear();
+    cycleSteps.clear();
+    cycleReasons.clear();
+}
+
+//-----------------------------------------------------------------------------
+
+//  Records the solution just found as part of the current hydraulic cycle,
+//  switching to replaying the recorded cycle if the solution repeats the one
+//  found one period earlier.
+
+void HydEngine::updateCycle()
+{
+    // ... externally imposed conditions aren't periodic
+    if ( boundaries.size() > 0 )
+    {
+        if ( cycleStates.size() > 0 ) resetCycle();
+        return;
+    }
+
+    // ... at the end of a recorded cycle see if conditions have repeated
+    if ( cycleStates.size() > 0 && currentTime == cycleStart + cyclePeriod )
+    {
+        double headTol = network->option(Options::CYCLE_TOLERANCE) /
+                         network->ucf(Units::LENGTH);
+        if ( cycleStates[0].matchesNetwork(network, headTol) )
+        {
+            cycleReplay = true;
+            cyclePos = 0;
+            if ( network->option(Options::REPORT_STATUS) )
+            {
+                network->msgLog << "\n    Hydraulics repeat every " <<
+                    Utilities::getTime(cyclePeriod) <<
+                    " hrs; re-using solutions from hour " <<
+                    Utilities::getTime(cycleStart);
+            }
+            return;
+        }
+        resetCycle();
+    }
+
+    // ... start recording a new cycle at a period boundary once reporting
+    //     has begun (so that reporting times repeat too)
+    if ( cycleStates.size() == 0 )
+    {
+        if ( currentTime % cyclePeriod != 0 ) return;
+        if ( currentTime < network->option(Options::REPORT_START) ) return;
+        cycleStart = currentTime;
     }
+    cycleStates.push_back(Checkpoint());
+    cycleStates.back().saveNetwork(network);
+    cycleSteps.push_back(0);
+    cycleReasons.push_back("");
 }
@@ -11,9 +11,16 @@
 #ifndef HYDENGINE_H_
 #define HYDENGINE_H_
 
+#include "Core/ruleengine.h"
+#include "Core/checkpoint.h"
+#include "Utilities/eventqueue.h"
+
 #include <string>
+#include <vector>
 
 class Network;
+class Tank;
+class Checkpoint;
 class HydSolver;
 class MatrixSolver;
 
@@ -28,6 +35,10 @@ class HydEngine
 {
   public:
 
+    // Boundary conditions that override the network's own
+
+    enum BoundaryType {TANK_LEVEL, NODE_DEMAND, LINK_STATUS, LINK_SETTING};
+
     // Constructor/Destructor
 
     HydEngine();
@@ -40,8 +51,16 @@ class HydEngine
     int    solve(int* t);
     void   advance(int* tstep);
     void   close();
+    void   saveState(Checkpoint& cp);
+    void   restoreState(Checkpoint& cp);
+    void   setTime(int t);
+    void   skipTime(int dt);
+    void   stop() { stopped = true; }
+    void   setBoundary(int type, int index, double value);
+    void   clearBoundaries() { boundaries.clear(); }
 
     int    getElapsedTime() { return currentTime; }
+    int    getInputPeriod() { return boundaries.empty() ? inputPeriod : 0; }
     double getPeakKwatts()  { return peakKwatts;  }
 
   private:
@@ -56,32 +75,80 @@ class HydEngine
     Network*       network;            //!< network being analyzed
     HydSolver*     hydSolver;          //!< steady state hydraulic solver
     MatrixSolver*  matrixSolver;       //!< sparse matrix solver
+    RuleEngine     ruleEngine;         //!< rule-based control evaluator
 //    HydFile*       hydFile;            //!< hydraulics file accessor
 
     // Engine properties
 
     bool           saveToFile;         //!< true if results saved to file
     bool           halted;             //!< true if simulation has been halted
+    bool           stopped;            //!< true if simulation was ended early
     int            startTime;          //!< starting time of day (sec)
     int            rptTime;            //!< current reporting time (sec)
     int            hydStep;            //!< hydraulic time step (sec)
+    int            adaptiveStep;       //!< time step meeting tank error limit (sec)
     int            currentTime;        //!< current simulation time (sec)
     int            timeOfDay;          //!< current time of day (sec)
     double         peakKwatts;         //!< peak energy usage (kwatts)
     std::string    timeStepReason;     //!< reason for taking next time step
 
+    // Event scheduling
+
+    EventQueue          eventQueue;      //!< pending pattern, tank & control events
+    bool                eventsScheduled; //!< true if eventQueue is current
+    bool                patternsChanged; //!< true if a pattern advanced at current time
+    int                 tankBase;        //!< event id of first tank
+    int                 controlBase;     //!< event id of first control
+    std::vector<Tank*>  tanks;           //!< network's storage tanks
+    std::vector<double> tankOutflow;     //!< tank outflow used for its forecasts
+    std::vector<int>    tankControlBeg;  //!< start of each tank's level controls
+    std::vector<int>    tankControls;    //!< level control indexes grouped by tank
+
+    // Boundary condition overrides
+
+    struct Boundary
+    {
+        int    type;                   //!< type of boundary (see BoundaryType)
+        int    index;                  //!< index of node or link overridden
+        double value;                  //!< value imposed (internal units)
+    };
+    std::vector<Boundary> boundaries;  //!< overrides applied at each solution
+
+    // Reuse of periodic hydraulics
+
+    int                      inputPeriod;  //!< period of time-dependent inputs (sec)
+    int                      cyclePeriod;  //!< period of repeating conditions (sec)
+    int                      cycleStart;   //!< start time of recorded cycle (sec)
+    bool                     cycleReplay;  //!< true if replaying recorded cycle
+    size_t                   cyclePos;     //!< current step within recorded cycle
+    std::vector<Checkpoint>  cycleStates;  //!< network state at each step of cycle
+    std::vector<int>         cycleSteps;   //!< time step taken from each state
+    std::vector<std::string> cycleReasons; //!< reason for each time step
+
     // Simulation sub-tasks
 
     void           initMatrixSolver();
 
-    int            getTimeStep();
-    int            timeToPatternChange(int tstep);
-    int            timeToActivateControl(int tstep);
-    int            timeToCloseTank(int tstep);
+    int            getTimeStep(int lastStep);
+    int            limitTankError(int tstep, int lastStep, bool afterEvent);
+    int            timeToNextEvent(int tstep);
+
+    void           scheduleEvents();
+    void           scheduleEvent(int id);
+    void           schedulePattern(int i);
+    void           scheduleTank(int i);
+    void           scheduleControl(int i);
+    void           updateEvents();
+    void           movePatterns(int t);
+    void           applyBoundaries();
+
+    int            findInputPeriod();
+    int            findCyclePeriod();
+    void           resetCycle();
+    void           updateCycle();
 
     void           updateCurrentConditions();
     void           updateTanks();
-    void           updatePatterns();
     void           updateEnergyUsage();
 
     bool           isPressureDeficient();
@@ -0,0 +1,147 @@
+/* EPANET 3
+ *
+ * Copyright (c) 2016 Open Water Analytics
+ * Licensed under the terms of the MIT License (see the LICENSE file for details).
+ *
+ */
+
+ /////////////////////////////////////////////////////
+ //  Implementation of the InjectionImpacts class.  //
+ /////////////////////////////////////////////////////
+
+#include "injectionimpacts.h"
+#include "Core/network.h"
+#include "Core/constants.h"
+#include "Elements/node.h"
+
+#include <iomanip>
+#include <algorithm>
+using namespace std;
+
+//-----------------------------------------------------------------------------
+
+//  Constructor
+
+InjectionImpacts::InjectionImpacts() :
+    limit(0.0),
+    words(0)
+{}
+
+//  Destructor
+
+InjectionImpacts::~InjectionImpacts()
+{}
+
+//-----------------------------------------------------------------------------
+
+void InjectionImpacts::clear()
+{
+    words = 0;
+    impacts.clear();
+    exposed.clear();
+}
+
+//-----------------------------------------------------------------------------
+
+//  Zeros the impacts of each of a network's injections.
+
+void InjectionImpacts::init(Network* nw)
+{
+    int n = nw->speciesModel.injectionCount();
+    Impact zero = {0.0, 0, -1, 0.0};
+    impacts.assign(n, zero);
+    limit = nw->option(Options::EXPOSURE_LIMIT);
+    words = (nw->count(Element::NODE) + 63) / 64;
+    exposed.assign((size_t)n * words, 0);
+}
+
+//-----------------------------------------------------------------------------
+
+//  Adds the impacts of the species values x (nodeCount x speciesCount),
+//  found at time t, that hold over a time step of tstep seconds.
+
+void InjectionImpacts::update(Network* nw, const double* x, int t, int tstep)
+{
+    if ( impacts.empty() || x == 0 ) return;
+    SpeciesModel& species = nw->speciesModel;
+    int m = species.count();
+    int n = (int)impacts.size();
+    vector<int> lane(n), source(n), start(n);
+    for (int j = 0; j < n; j++)
+    {
+        double value, rate;
+        int duration;
+        lane[j] = species.injectionSpecies(j);
+        source[j] = species.injectionNode(j);
+        species.getInjection(j, value, rate, start[j], duration);
+    }
+
+    int nodeCount = nw->count(Element::NODE);
+    for (int i = 0; i < nodeCount; i++)
+    {
+        Node* node = nw->node(i);
+        if ( node->type() != Node::JUNCTION ) continue;
+        const double* xi = x + (size_t)i * m;
+        double v = max(node->outflow, 0.0) * tstep * LperFT3;
+        uint64_t bit = (uint64_t)1 << (i % 64);
+        for (int j = 0; j < n; j++)
+        {
+            double c = xi[lane[j]];
+            if ( c <= 0.0 ) continue;
+            Impact& impact = impacts[j];
+            impact.mass += c * v;
+            impact.peakValue = max(impact.peakValue, c);
+
+            // ... count a junction the first time its value exceeds the limit
+            if ( c <= limit || i == source[j] ) continue;
+            uint64_t& word = exposed[(size_t)j * words + i / 64];
+            if ( word & bit ) continue;
+            word |= bit;
+            impact.nodesExposed++;
+            if ( impact.firstExposure < 0 ) impact.firstExposure = max(t - start[j], 0);
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+//  Returns an impact (see ImpactType) of the j-th injection.
+
+double InjectionImpacts::getImpact(int j, int type)
+{
+    Impact& impact = impacts[j];
+    switch (type)
+    {
+    case MASS_CONSUMED:  return impact.mass;
+    case NODES_EXPOSED:  return impact.nodesExposed;
+    case FIRST_EXPOSURE: return impact.firstExposure;
+    case PEAK_VALUE:     return impact.peakValue;
+    }
+    return 0.0;
+}
+
+//-----------------------------------------------------------------------------
+
+void InjectionImpacts::writeImpacts(Network* nw, ostream& msgLog)
+{
+    SpeciesModel& species = nw->speciesModel;
+    msgLog << "\n  Injection Impacts"
+           << "\n  -----------------"
+           << "\n  Node                  Mass Consumed   Nodes Exposed"
+              "   First Exposure (hrs)   Peak Value";
+    msgLog << fixed;
+    for (size_t j = 0; j < impacts.size(); j++)
+    {
+        Impact& impact = impacts[j];
+        msgLog << "\n  " << left << setw(20)
+               << nw->node(species.injectionNode(j))->name << right
+               << setw(15) << setprecision(2) << impact.mass / 1.e6
+               << setw(16) << impact.nodesExposed;
+        if ( impact.firstExposure < 0 ) msgLog << setw(23) << "-";
+        else msgLog << setw(23) << impact.firstExposure / 3600.0;
+        msgLog << setw(13) << setprecision(4) << impact.peakValue;
+    }
+    msgLog << "\n";
+    msgLog.unsetf(ios::fixed);
+    msgLog << setprecision(6);
+}
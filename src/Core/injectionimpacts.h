@@ -0,0 +1,66 @@
+/* EPANET 3
+ *
+ * Copyright (c) 2016 Open Water Analytics
+ * Licensed under the terms of the MIT License (see the LICENSE file for details).
+ *
+ */
+
+//! \file injectionimpacts.h
+//! \brief Describes the InjectionImpacts class.
+
+#ifndef INJECTIONIMPACTS_H_
+#define INJECTIONIMPACTS_H_
+
+#include <vector>
+#include <ostream>
+#include <cstdint>
+
+class Network;
+
+//! \class InjectionImpacts
+//! \brief Tallies the impact of each injection in a contamination ensemble.
+//!
+//! After each water quality step the values of every injection species are
+//! checked at each junction. An injection's impacts are the mass of it
+//! consumed by junction outflows, the number of junctions (other than the
+//! injection node) where its value ever exceeded the EXPOSURE_LIMIT option,
+//! the time from the start of the injection until the first of these was
+//! exposed and the largest value it reached at any junction.
+
+class InjectionImpacts
+{
+  public:
+
+    enum ImpactType {
+        MASS_CONSUMED,       //!< mass consumed by junction outflows
+        NODES_EXPOSED,       //!< junctions exposed above the limit
+        FIRST_EXPOSURE,      //!< time to the first exposure (sec, -1 if none)
+        PEAK_VALUE           //!< largest value seen at a junction
+    };
+
+    InjectionImpacts();
+    ~InjectionImpacts();
+
+    void   clear();
+    void   init(Network* nw);
+    void   update(Network* nw, const double* x, int t, int tstep);
+    double getImpact(int j, int type);
+    void   writeImpacts(Network* nw, std::ostream& msgLog);
+
+  private:
+
+    struct Impact
+    {
+        double mass;                      //!< mass consumed (value * liters)
+        int    nodesExposed;              //!< junctions exposed
+        int    firstExposure;             //!< time to first exposure (sec)
+        double peakValue;                 //!< largest junction value
+    };
+
+    double                limit;          //!< exposure limit (user units)
+    int                   words;          //!< bitset words per injection
+    std::vector<Impact>   impacts;        //!< impacts of each injection
+    std::vector<uint64_t> exposed;        //!< junctions exposed by each injection
+};
+
+#endif // INJECTIONIMPACTS_H_
@@ -16,6 +16,7 @@
 #include "Elements/pattern.h"
 #include "Elements/curve.h"
 #include "Elements/control.h"
+#include "Elements/rule.h"
 #include "Models/headlossmodel.h"
 #include "Models/demandmodel.h"
 #include "Models/leakagemodel.h"
@@ -75,6 +76,13 @@ void Network::clear()
     curves.clear();
     for (Control* control : controls) control->~Control();
     controls.clear();
+    pressureControls.clear();
+    for (Rule* rule : rules) rule->~Rule();
+    rules.clear();
+    ruleTable.clear();
+    speciesModel.clear();
+    injectionImpacts.clear();
+    graph.clear();
 
     // ... reclaim all memory allocated by the memory pool
 
@@ -99,12 +107,35 @@ int Network::count(Element::ElementType eType)
     case Element::PATTERN: return patterns.size();
     case Element::CURVE:   return curves.size();
     case Element::CONTROL: return controls.size();
+    case Element::RULE:    return rules.size();
     }
     return 0;
 }
 
 //-----------------------------------------------------------------------------
 
+//  Makes room for n more elements of a given type without regrowing the
+//  element list or rehashing its table of ID names.
+
+void Network::reserve(Element::ElementType eType, int n)
+{
+    switch(eType)
+    {
+    case Element::NODE:
+        nodes.reserve(nodes.size() + n);
+        nodeTable.reserve(nodeTable.size() + n);
+        break;
+    case Element::LINK:
+        links.reserve(links.size() + n);
+        linkTable.reserve(linkTable.size() + n);
+        break;
+    default:
+        break;
+    }
+}
+
+//-----------------------------------------------------------------------------
+
 int Network::indexOf(Element::ElementType eType, const string& name)
 {
     unordered_map<string,Element*> *table;
@@ -125,6 +156,9 @@ int Network::indexOf(Element::ElementType eType, const string& name)
     case Element::CONTROL:
         table = &controlTable;
         break;
+    case Element::RULE:
+        table = &ruleTable;
+        break;
     default:
         return -1;
     }
@@ -198,6 +232,18 @@ Control* Network::control(const int index)
 
 //-----------------------------------------------------------------------------
 
+Rule*  Network::rule(const string& name)
+{
+    return static_cast<Rule*>(ruleTable.find(name)->second);
+}
+
+Rule* Network::rule(const int index)
+{
+    return rules[index];
+}
+
+//-----------------------------------------------------------------------------
+
 void Network::writeTitle(ostream& out)
 {
     if ( title.size() > 0 )
@@ -215,6 +261,7 @@ void Network::convertUnits()
     for (Node* node : nodes) node->convertUnits(this);
     for (Link* link : links) link->convertUnits(this);
     for (Control* control : controls) control->convertUnits(this);
+    for (Rule* rule : rules) rule->convertUnits(this);
 }
 
 //-----------------------------------------------------------------------------
@@ -266,6 +313,14 @@ bool Network::addElement(Element::ElementType element, int type, string name)
             controlTable[control->name] = control;
             controls.push_back(control);
         }
+
+        else if ( element == Element::RULE )
+        {
+            Rule* rule = new(memPool->alloc(sizeof(Rule))) Rule(name);
+            rule->index = rules.size();
+            ruleTable[rule->name] = rule;
+            rules.push_back(rule);
+        }
         return true;
     }
     catch (...)
@@ -14,6 +14,8 @@
 #include "Core/options.h"
 #include "Core/units.h"
 #include "Core/qualbalance.h"
+#include "Core/injectionimpacts.h"
+#include "Models/speciesmodel.h"
 #include "Elements/element.h"
 #include "Utilities/graph.h"
 
@@ -26,6 +28,7 @@ class Link;
 class Pattern;
 class Curve;
 class Control;
+class Rule;
 class HeadLossModel;
 class DemandModel;
 class LeakageModel;
@@ -53,6 +56,7 @@ class Network
 
     // Finds element counts by type and index by id name
     int           count(Element::ElementType eType);
+    void          reserve(Element::ElementType eType, int n);
     int           indexOf(Element::ElementType eType, const std::string& name);
 
     // Gets an analysis option by type
@@ -67,6 +71,7 @@ class Network
     Pattern*      pattern(const std::string& name);
     Curve*        curve(const std::string& name);
     Control*      control(const std::string& name);
+    Rule*         rule(const std::string& name);
 
     // Gets a network element by index
     Node*         node(const int index);
@@ -74,6 +79,7 @@ class Network
     Pattern*      pattern(const int index);
     Curve*        curve(const int index);
     Control*      control(const int index);
+    Rule*         rule(const int index);
 
     // Creates analysis models
     bool          createHeadLossModel();
@@ -100,9 +106,13 @@ class Network
     std::vector<Curve*>      curves;        //!< collection of data curve objects
     std::vector<Pattern*>    patterns;      //!< collection of time pattern objects
     std::vector<Control*>    controls;      //!< collection of control rules
+    std::vector<Control*>    pressureControls; //!< pressure controls grouped by trigger node
+    std::vector<Rule*>       rules;         //!< collection of rule-based controls
     Units                    units;         //!< unit conversion factors
     Options                  options;       //!< analysis options
     QualBalance              qualBalance;   //!< water quality mass balance
+    InjectionImpacts         injectionImpacts; //!< impacts of injected species
+    SpeciesModel             speciesModel;  //!< extra water quality species
     std::ostringstream       msgLog;        //!< status message log.
 
     // Computational sub-models
@@ -119,6 +129,7 @@ class Network
     std::unordered_map<std::string, Element*>      curveTable;    //!< hash table for curve ID names.
     std::unordered_map<std::string, Element*>      patternTable;  //!< hash table for pattern ID names.
     std::unordered_map<std::string, Element*>      controlTable;  //!< hash table for control ID names.
+    std::unordered_map<std::string, Element*>      ruleTable;     //!< hash table for rule ID names.
     MemPool *      memPool;       //!< memory pool for network objects
 };
 
@@ -52,6 +52,9 @@ static const char* leakageModelWords[] =
 // Quality model keywords
 static const char* qualModelWords[] = {"NONE", "AGE", "TRACE", "CHEMICAL", 0};
 
+// Water quality solver method names
+static const char* qualSolverWords[] = {"LTD", "EFV", "EDM", "STEADY", 0};
+
 // Quality units keywords
 static const char* qualUnitsWords[] = {"", "HRS", "PCNT", "MG/L", "UG/L", 0};
 
@@ -83,6 +86,7 @@ void Options::setDefaults()
     stringOptions[MATRIX_SOLVER]           = "SPARSPAK";
     stringOptions[DEMAND_PATTERN_NAME]     = "";
     stringOptions[QUAL_MODEL]              = "NONE";
+    stringOptions[QUAL_SOLVER]             = "LTD";
     stringOptions[QUAL_NAME]               = "Chemical";
     stringOptions[QUAL_UNITS_NAME]         = "MG/L";
     stringOptions[TRACE_NODE_NAME]         = "";
@@ -98,6 +102,10 @@ void Options::setDefaults()
     indexOptions[QUAL_TYPE]                = NOQUAL;
     indexOptions[QUAL_UNITS]               = MGL;
     indexOptions[TRACE_NODE]               = -1;
+    indexOptions[THREADS]                  = 1;
+    indexOptions[SEGMENT_LIMIT]            = 0;
+    indexOptions[TOTAL_SEGMENT_LIMIT]      = 0;
+    indexOptions[PIPE_CELLS]               = 16;
 
     indexOptions[REPORT_SUMMARY]           = true;
     indexOptions[REPORT_ENERGY]            = false;
@@ -117,6 +125,8 @@ void Options::setDefaults()
     valueOptions[FLOW_TOLERANCE]           = 0.0;
     valueOptions[FLOW_CHANGE_LIMIT]        = 0.0;
     valueOptions[TIME_WEIGHT]              = 0.0;
+    valueOptions[CYCLE_TOLERANCE]          = 0.0;
+    valueOptions[TANK_TOLERANCE]           = 0.0;
 
     valueOptions[ENERGY_PRICE]             = 0.0;
     valueOptions[PEAKING_CHARGE]           = 0.0;
@@ -125,6 +135,9 @@ void Options::setDefaults()
     valueOptions[KIN_VISCOSITY]            = VISCOSITY;
     valueOptions[MOLEC_DIFFUSIVITY]        = DIFFUSIVITY;
     valueOptions[QUAL_TOLERANCE]           = 0.01;
+    valueOptions[COURANT_NUMBER]           = 0.0;
+    valueOptions[EXPOSURE_LIMIT]           = 0.0;
+    valueOptions[EQUILIBRIUM_TOLERANCE]    = 0.0;
     valueOptions[BULK_ORDER]               = 1.0;
     valueOptions[WALL_ORDER]               = 1.0;
     valueOptions[TANK_ORDER]               = 1.0;
@@ -215,6 +228,12 @@ int Options::setOption(StringOption option, const string& value)
         stringOptions[TRACE_NODE_NAME] = value;
         break;
 
+    case QUAL_SOLVER:
+        i = Utilities::findFullMatch(value, qualSolverWords);
+        if (i < 0) return InputError::INVALID_KEYWORD;
+        stringOptions[QUAL_SOLVER] = qualSolverWords[i];
+        break;
+
     default: break;
     }
     return 0;
@@ -251,6 +270,25 @@ int Options::setOption(IndexOption option, const string& value, Network* network
         indexOptions[MAX_TRIALS] = i;
         break;
 
+    case THREADS:
+        if ( !Utilities::parseNumber(value, i) || i < 0 )
+            return InputError::INVALID_NUMBER;
+        indexOptions[THREADS] = i;
+        break;
+
+    case SEGMENT_LIMIT:
+    case TOTAL_SEGMENT_LIMIT:
+        if ( !Utilities::parseNumber(value, i) || i < 0 )
+            return InputError::INVALID_NUMBER;
+        indexOptions[option] = i;
+        break;
+
+    case PIPE_CELLS:
+        if ( !Utilities::parseNumber(value, i) || i < 1 )
+            return InputError::INVALID_NUMBER;
+        indexOptions[PIPE_CELLS] = i;
+        break;
+
     case IF_UNBALANCED:
         i = Utilities::findFullMatch(ucValue, ifUnbalancedWords);
         if ( i < 0 ) return InputError::INVALID_KEYWORD;
@@ -319,7 +357,12 @@ void Options::adjustOptions()
     }
 
     // ... no water quality analysis for steady state run
-    if ( timeOptions[TOTAL_DURATION] == 0 ) indexOptions[QUAL_TYPE] = NOQUAL;
+    //     (unless it's to find the steady state quality)
+    if ( timeOptions[TOTAL_DURATION] == 0 &&
+         stringOptions[QUAL_SOLVER] != "STEADY" )
+    {
+        indexOptions[QUAL_TYPE] = NOQUAL;
+    }
 
     // ... quality timestep cannot be greater than hydraulic timestep
     timeOptions[QUAL_STEP] = min(timeOptions[QUAL_STEP], timeOptions[HYD_STEP]);
@@ -364,6 +407,16 @@ string Options::hydOptionsToStr()
     }
     s << setw(w) << "TIME_WEIGHT";
     s << valueOptions[TIME_WEIGHT] << "\n";
+    if ( valueOptions[CYCLE_TOLERANCE] > 0.0 )
+    {
+        s << setw(w) << "CYCLE_TOLERANCE";
+        s << valueOptions[CYCLE_TOLERANCE] << "\n";
+    }
+    if ( valueOptions[TANK_TOLERANCE] > 0.0 )
+    {
+        s << setw(w) << "TANK_TOLERANCE";
+        s << valueOptions[TANK_TOLERANCE] << "\n";
+    }
     s << setw(w) << "STEP_SIZING";
     s << stringOptions[STEP_SIZING] << "\n";
     s << setw(w) << "IF_UNBALANCED";
@@ -427,10 +480,51 @@ string Options::qualOptionsToStr()
         s << stringOptions[TRACE_NODE_NAME] << "\n";
     }
 
+    if ( stringOptions[QUAL_SOLVER] != "LTD" )
+    {
+        s << setw(w) << "QUALITY_SOLVER";
+        s << stringOptions[QUAL_SOLVER] << "\n";
+    }
+    if ( stringOptions[QUAL_SOLVER] == "EFV" )
+    {
+        s << setw(w) << "PIPE_CELLS";
+        s << indexOptions[PIPE_CELLS] << "\n";
+    }
+
     s << setw(w) << "SPECIFIC_DIFFUSIVITY";
     s << valueOptions[MOLEC_DIFFUSIVITY] / DIFFUSIVITY << "\n";
     s << setw(w) << "QUALITY_TOLERANCE";
     s << valueOptions[QUAL_TOLERANCE] << "\n";
+    if ( valueOptions[COURANT_NUMBER] > 0.0 )
+    {
+        s << setw(w) << "COURANT_NUMBER";
+        s << valueOptions[COURANT_NUMBER] << "\n";
+    }
+    if ( valueOptions[EXPOSURE_LIMIT] > 0.0 )
+    {
+        s << setw(w) << "EXPOSURE_LIMIT";
+        s << valueOptions[EXPOSURE_LIMIT] << "\n";
+    }
+    if ( valueOptions[EQUILIBRIUM_TOLERANCE] > 0.0 )
+    {
+        s << setw(w) << "EQUILIBRIUM_TOLERANCE";
+        s << valueOptions[EQUILIBRIUM_TOLERANCE] << "\n";
+    }
+    if ( indexOptions[THREADS] != 1 )
+    {
+        s << setw(w) << "THREADS";
+        s << indexOptions[THREADS] << "\n";
+    }
+    if ( indexOptions[SEGMENT_LIMIT] > 0 )
+    {
+        s << setw(w) << "MAXIMUM_SEGMENTS";
+        s << indexOptions[SEGMENT_LIMIT] << "\n";
+    }
+    if ( indexOptions[TOTAL_SEGMENT_LIMIT] > 0 )
+    {
+        s << setw(w) << "TOTAL_SEGMENTS";
+        s << indexOptions[TOTAL_SEGMENT_LIMIT] << "\n";
+    }
     return s.str();
 }
 
@@ -55,6 +55,7 @@ class Options
         QUAL_NAME,             //!< Name of water quality constituent
         QUAL_UNITS_NAME,       //!< Name of water quality units
         TRACE_NODE_NAME,       //!< Name of node for source tracing
+        QUAL_SOLVER,           //!< Name of water quality solver method
 
         MAX_STRING_OPTIONS
     };
@@ -74,6 +75,10 @@ class Options
         QUAL_TYPE,             //!< Type of water quality analysis
         QUAL_UNITS,            //!< Units of the quality constituent
         TRACE_NODE,            //!< Node index for source tracing
+        THREADS,               //!< Number of threads for parallel computations
+        SEGMENT_LIMIT,         //!< Maximum number of quality segments per link
+        TOTAL_SEGMENT_LIMIT,   //!< Maximum number of quality segments overall
+        PIPE_CELLS,            //!< Number of volume cells per pipe (EFV solver)
 
         REPORT_SUMMARY,        //!< report input/output summary
         REPORT_ENERGY,         //!< report energy usage
@@ -106,10 +111,15 @@ class Options
         FLOW_TOLERANCE,        //!< Convergence tolerance for flow balance
         FLOW_CHANGE_LIMIT,     //!< Max. flow change for convergence
         TIME_WEIGHT,           //!< Time weighting for variable head tanks
+        CYCLE_TOLERANCE,       //!< Tank head tolerance for reusing daily hydraulics
+        TANK_TOLERANCE,        //!< Tank level error limit for adaptive time steps
 
         // Water quality options
         MOLEC_DIFFUSIVITY,     //!< Chemical's molecular diffusivity (ft2/sec)
         QUAL_TOLERANCE,        //!< Tolerance for water quality comparisons
+        COURANT_NUMBER,        //!< Ratio of quality step to shortest pipe travel time
+        EXPOSURE_LIMIT,        //!< Injection species value that exposes a node
+        EQUILIBRIUM_TOLERANCE, //!< Quality change over an input cycle that ends a run
         BULK_ORDER,            //!< Order of all bulk flow reactions in pipes
         WALL_ORDER,            //!< Order of all pipe wall reactions
         TANK_ORDER,            //!< Order of all bulk water reactions in tanks
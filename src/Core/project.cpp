@@ -15,12 +15,19 @@
 #include "Input/inputreader.h"
 #include "Output/projectwriter.h"
 #include "Output/reportwriter.h"
+#include "Solvers/qualsolver.h"
 #include "Utilities/utilities.h"
 
 #include <cstring>
+#include <algorithm>
 #include <fstream>
 using namespace std;
 
+//  Largest change in tank levels (ft) over a cycle of periodic equilibrium
+//  when no CYCLE_TOLERANCE is given
+
+static const double EQUIL_HEAD_TOL = 0.01;
+
 //-----------------------------------------------------------------------------
 
 namespace Epanet
@@ -37,7 +44,8 @@ namespace Epanet
         qualEngineOpened(false),
         outputFileOpened(false),
         solverInitialized(false),
-        runQuality(false)
+        runQuality(false),
+        flowPathsIndexed(false)
     {
         Utilities::getTmpFileName(tmpFileName);
     }
@@ -124,16 +132,21 @@ namespace Epanet
 
     void Project::clear()
     {
+        streamDriver.close();
+        sourceTracker.close();
         hydEngine.close();
         hydEngineOpened = false;
 
+        qualPipeline.close();
         qualEngine.close();
         qualEngineOpened = false;
 
         network.clear();
         networkEmpty = true;
+        flowPathsIndexed = false;
 
         solverInitialized = false;
+        checkpoint.clear();
         inpFileName = "";
     }
 
@@ -159,15 +172,23 @@ namespace Epanet
             }
             hydEngine.init(initFlows);
 
-            // ... open and initialize the water quality engine
+            // ... open and initialize the water quality engine (on a fresh
+            //     copy of the network each time if it's pipelined)
             if ( runQuality == true )
             {
-                if ( !qualEngineOpened )
+                if ( !qualEngineOpened || qualPipeline.isOpen() )
                 {
-                    qualEngine.open(&network);
+                    qualPipeline.close();
+                    if ( canPipelineQuality() )
+                    {
+                        qualPipeline.open(&network);
+                        qualEngine.open(qualPipeline.qualNetwork());
+                    }
+                    else qualEngine.open(&network);
                     qualEngineOpened = true;
                 }
                 qualEngine.init();
+                qualPipeline.copyResults();
             }
 
             // ... mark solvers as being initialized
@@ -194,9 +215,14 @@ namespace Epanet
         {
             if ( !solverInitialized ) throw SystemError(SystemError::SOLVER_NOT_INITIALIZED);
             hydEngine.solve(t);
-            if ( outputFileOpened  && *t % network.option(Options::REPORT_STEP) == 0 )
+            if ( sourceTracker.isOpen() ) sourceTracker.record(*t);
+            updateFlowPaths();
+            qualPipeline.finish();
+            if ( runQuality ) qualEngine.solveSteadyState();
+            if ( outputFileOpened  && *t % network.option(Options::REPORT_STEP) == 0 &&
+                 *t >= network.option(Options::REPORT_START) )
             {
-                outputFile.writeNetworkResults();
+                outputFile.writeNetworkResults(&qualEngine);
             }
             return 0;
         }
@@ -217,13 +243,198 @@ namespace Epanet
         try
         {
             // ... advance to time when new hydraulics need to be computed
+            qualPipeline.finish();
             hydEngine.advance(dt);
 
             // ... if at end of simulation (dt == 0) then finalize results
             if ( *dt == 0 ) finalizeSolver();
 
-            // ... otherwise update water quality over the time step
-            else if ( runQuality ) qualEngine.solve(*dt);
+            // ... otherwise update water quality over the time step,
+            //     leaving it to run alongside the next hydraulic solution
+            //     if it's pipelined
+            else if ( qualPipeline.isOpen() )
+            {
+                qualPipeline.solve(&qualEngine, hydEngine.getElapsedTime(), *dt);
+            }
+            else if ( runQuality )
+            {
+                qualEngine.solve(*dt);
+                checkEquilibrium();
+            }
+            return 0;
+        }
+        catch (ENerror const& e)
+        {
+            writeMsg(e.msg);
+            return e.code;
+        }
+    }
+
+//-----------------------------------------------------------------------------
+
+    //  Check if water quality has settled into a cycle that repeats with the
+    //  network's inputs. Once it has, skip ahead by whole cycles to the start
+    //  of reporting or, if reporting has already begun, end the simulation.
+    //
+    //  Tank levels must repeat too, to within the CYCLE_TOLERANCE option or
+    //  EQUIL_HEAD_TOL if that isn't set.
+
+    void Project::checkEquilibrium()
+    {
+        double tol = network.option(Options::EQUILIBRIUM_TOLERANCE);
+        int period = hydEngine.getInputPeriod();
+        int t = hydEngine.getElapsedTime();
+        if ( tol <= 0.0 || period <= 0 || t % period != 0 ) return;
+        if ( qualEngine.getStatistic(QualSolver::EQUILIBRIUM_TIME) >= 0.0 ) return;
+        double headTol = network.option(Options::CYCLE_TOLERANCE) /
+                         network.ucf(Units::LENGTH);
+        if ( headTol <= 0.0 ) headTol = EQUIL_HEAD_TOL;
+        if ( !qualEngine.reachedEquilibrium(period, tol, headTol) ) return;
+
+        int skip = network.option(Options::REPORT_START) - t;
+        skip = max(0, skip / period * period);
+        network.msgLog << "\n    Water quality at hour " << Utilities::getTime(t)
+            << " is within " << qualEngine.getStatistic(QualSolver::CYCLE_CHANGE)
+            << " of its values one cycle earlier; ";
+        if ( skip > 0 )
+        {
+            hydEngine.skipTime(skip);
+            qualEngine.skipTime(skip);
+            network.msgLog << "skipping ahead to hour " << Utilities::getTime(t + skip);
+        }
+        else
+        {
+            hydEngine.stop();
+            network.msgLog << "ending simulation";
+        }
+    }
+
+//-----------------------------------------------------------------------------
+
+    //  Check if water quality can be solved on its own thread while the next
+    //  period's hydraulics are solved. This needs more than one thread and
+    //  a quality solver that steps through time, and isn't done when a run
+    //  might end early on reaching periodic equilibrium (which depends on
+    //  the quality found before the next hydraulic step is taken).
+
+    bool Project::canPipelineQuality()
+    {
+        return network.option(Options::THREADS) > 1 &&
+               network.option(Options::QUAL_SOLVER) != "STEADY" &&
+               network.option(Options::EQUILIBRIUM_TOLERANCE) <= 0.0;
+    }
+
+//-----------------------------------------------------------------------------
+
+    //  Save the current state of an in-progress simulation in memory.
+
+    int Project::saveCheckpoint()
+    {
+        try
+        {
+            if ( !solverInitialized ) throw SystemError(SystemError::SOLVER_NOT_INITIALIZED);
+            saveState(checkpoint);
+            return 0;
+        }
+        catch (ENerror const& e)
+        {
+            writeMsg(e.msg);
+            return e.code;
+        }
+    }
+
+//-----------------------------------------------------------------------------
+
+    //  Return a simulation to the state saved by the last call to
+    //  saveCheckpoint().
+
+    int Project::restoreCheckpoint()
+    {
+        try
+        {
+            if ( !solverInitialized ) throw SystemError(SystemError::SOLVER_NOT_INITIALIZED);
+            if ( checkpoint.isEmpty() ) throw SystemError(SystemError::NO_CHECKPOINT);
+            restoreState(checkpoint);
+            return 0;
+        }
+        catch (ENerror const& e)
+        {
+            writeMsg(e.msg);
+            return e.code;
+        }
+    }
+
+//-----------------------------------------------------------------------------
+
+    //  Replace this project with a copy of another project whose simulation
+    //  continues from the source project's current point in time.
+
+    int Project::fork(Project* source)
+    {
+        int err = 0;
+        string tmpFile;
+        if ( !Utilities::getTmpFileName(tmpFile) ) return 208;
+        try
+        {
+            if ( !source->solverInitialized )
+                throw SystemError(SystemError::SOLVER_NOT_INITIALIZED);
+
+            // ... copy the source's network data via a temporary input file
+            err = source->save(tmpFile.c_str());
+            if ( err == 0 ) err = load(tmpFile.c_str());
+            if ( err == 0 ) err = initSolver(false);
+
+            // ... copy the source's current simulation state
+            if ( err == 0 )
+            {
+                Checkpoint cp;
+                source->saveState(cp);
+                restoreState(cp);
+            }
+        }
+        catch (ENerror const& e)
+        {
+            writeMsg(e.msg);
+            err = e.code;
+        }
+        remove(tmpFile.c_str());
+        if ( err > 0 ) clear();
+        return err;
+    }
+
+//-----------------------------------------------------------------------------
+
+    //  Put the hydraulic solver into streaming mode, keeping the last
+    //  capacity solutions it computes available to other threads.
+
+    int Project::openStream(int capacity)
+    {
+        try
+        {
+            if ( !solverInitialized ) throw SystemError(SystemError::SOLVER_NOT_INITIALIZED);
+            if ( capacity <= 0 ) throw InputError(InputError::INVALID_NUMBER,
+                                                  Utilities::to_string(capacity));
+            streamDriver.open(&network, &hydEngine, capacity);
+            return 0;
+        }
+        catch (ENerror const& e)
+        {
+            writeMsg(e.msg);
+            return e.code;
+        }
+    }
+
+//-----------------------------------------------------------------------------
+
+    //  Override a tank level, junction demand, or link status or setting
+    //  (see HydEngine::BoundaryType) with a measured value in user units.
+
+    int Project::setBoundary(int type, int index, double value)
+    {
+        try
+        {
+            if ( !streamDriver.isOpen() ) throw SystemError(SystemError::STREAM_NOT_OPENED);
+            streamDriver.setBoundary(type, index, value);
             return 0;
         }
         catch (ENerror const& e)
@@ -233,6 +444,360 @@ namespace Epanet
         }
     }
 
+//-----------------------------------------------------------------------------
+
+    //  Remove all boundary condition overrides.
+
+    int Project::clearBoundaries()
+    {
+        hydEngine.clearBoundaries();
+        return 0;
+    }
+
+//-----------------------------------------------------------------------------
+
+    //  Re-solve hydraulics at time t with the current boundary conditions.
+
+    int Project::solveStream(int t)
+    {
+        try
+        {
+            if ( !streamDriver.isOpen() ) throw SystemError(SystemError::STREAM_NOT_OPENED);
+            streamDriver.solve(t);
+            updateFlowPaths();
+            return 0;
+        }
+        catch (ENerror const& e)
+        {
+            writeMsg(e.msg);
+            return e.code;
+        }
+    }
+
+//-----------------------------------------------------------------------------
+
+    //  Re-solve hydraulics for each batch of measurements read from a file,
+    //  named pipe or other character device.
+
+    int Project::runStream(const char* fname)
+    {
+        try
+        {
+            if ( !streamDriver.isOpen() ) throw SystemError(SystemError::STREAM_NOT_OPENED);
+            ifstream feed(fname);
+            if ( !feed.is_open() ) throw FileError(FileError::CANNOT_OPEN_INPUT_FILE);
+            streamDriver.run(feed);
+            updateFlowPaths();
+            return 0;
+        }
+        catch (ENerror const& e)
+        {
+            writeMsg(e.msg);
+            return e.code;
+        }
+    }
+
+//-----------------------------------------------------------------------------
+
+    //  Retrieve the earliest streamed solution published after frame
+    //  afterFrame (can be called from any thread without blocking the
+    //  solver). Returns the solution's frame number or 0 if none is newer.
+
+    long Project::readStream(long afterFrame, int* t, double* nodeHead,
+                             double* nodeDemand, double* linkFlow)
+    {
+        return streamDriver.readResults(afterFrame, t, nodeHead, nodeDemand,
+                                        linkFlow);
+    }
+
+//-----------------------------------------------------------------------------
+
+    //  Start recording the link flows of each hydraulic solution so that
+    //  the water at a node can be traced back to its sources.
+
+    int Project::openFlowHistory()
+    {
+        try
+        {
+            if ( networkEmpty ) throw SystemError(SystemError::NO_NETWORK_DATA);
+            sourceTracker.open(&network);
+            return 0;
+        }
+        catch (ENerror const& e)
+        {
+            writeMsg(e.msg);
+            return e.code;
+        }
+    }
+
+//-----------------------------------------------------------------------------
+
+    //  Trace the water at a node at time t (sec) back through the recorded
+    //  flow history for up to maxAge seconds (or the whole history if
+    //  maxAge <= 0), returning the number of sources it came from.
+
+    int Project::trackSources(int node, int t, int maxAge, int* count)
+    {
+        try
+        {
+            *count = 0;
+            if ( !sourceTracker.isOpen() )
+                throw SystemError(SystemError::FLOW_HISTORY_NOT_OPENED);
+            if ( node < 0 || node >= network.count(Element::NODE) )
+                throw InputError(InputError::UNDEFINED_OBJECT, Utilities::to_string(node));
+            *count = sourceTracker.track(node, t, maxAge);
+            return 0;
+        }
+        catch (ENerror const& e)
+        {
+            writeMsg(e.msg);
+            return e.code;
+        }
+    }
+
+//-----------------------------------------------------------------------------
+
+    //  Retrieve the node (-1 if water is older than the period traced),
+    //  fraction of water supplied and mean travel time (sec) of the i-th
+    //  source found by the last call to trackSources().
+
+    int Project::getTrackedSource(int i, int* node, double* fraction, double* meanAge)
+    {
+        try
+        {
+            if ( i < 0 || i >= sourceTracker.sourceCount() )
+                throw InputError(InputError::UNDEFINED_OBJECT, Utilities::to_string(i));
+            sourceTracker.getSource(i, node, fraction, meanAge);
+            return 0;
+        }
+        catch (ENerror const& e)
+        {
+            writeMsg(e.msg);
+            return e.code;
+        }
+    }
+
+//-----------------------------------------------------------------------------
+
+    //  Retrieve the fraction of water from the i-th traced source that
+    //  arrived within each of binCount travel time intervals of binWidth
+    //  seconds.
+
+    int Project::getTrackedArrivals(int i, int binWidth, int binCount, double* fractions)
+    {
+        try
+        {
+            if ( i < 0 || i >= sourceTracker.sourceCount() )
+                throw InputError(InputError::UNDEFINED_OBJECT, Utilities::to_string(i));
+            if ( binWidth <= 0 ) throw InputError(InputError::INVALID_NUMBER,
+                                                  Utilities::to_string(binWidth));
+            if ( binCount <= 0 ) throw InputError(InputError::INVALID_NUMBER,
+                                                  Utilities::to_string(binCount));
+            sourceTracker.getArrivals(i, binWidth, binCount, fractions);
+            return 0;
+        }
+        catch (ENerror const& e)
+        {
+            writeMsg(e.msg);
+            return e.code;
+        }
+    }
+
+//-----------------------------------------------------------------------------
+
+    //  Retrieve up to size links, ordered from source to target, along which
+    //  the most water from the i-th traced source arrived. count returns the
+    //  full length of the path.
+
+    int Project::getTrackedPath(int i, int size, int* links, int* count)
+    {
+        try
+        {
+            *count = 0;
+            if ( i < 0 || i >= sourceTracker.sourceCount() )
+                throw InputError(InputError::UNDEFINED_OBJECT, Utilities::to_string(i));
+            *count = sourceTracker.getPath(i, size, links);
+            return 0;
+        }
+        catch (ENerror const& e)
+        {
+            writeMsg(e.msg);
+            return e.code;
+        }
+    }
+
+//-----------------------------------------------------------------------------
+
+    //  Find the nodes and links downstream (direction 0) or upstream
+    //  (direction 1) of a node under the current flows, limited to those
+    //  within maxTime seconds of travel if maxTime > 0.
+
+    int Project::findReachable(int node, int direction, int maxTime,
+                               int* nodeCount, int* linkCount)
+    {
+        try
+        {
+            *nodeCount = 0;
+            *linkCount = 0;
+            reached.nodes.clear();
+            reached.links.clear();
+            if ( !solverInitialized ) throw SystemError(SystemError::SOLVER_NOT_INITIALIZED);
+            if ( node < 0 || node >= network.count(Element::NODE) )
+                throw InputError(InputError::UNDEFINED_OBJECT, Utilities::to_string(node));
+            if ( direction < 0 || direction > 1 )
+                throw InputError(InputError::INVALID_KEYWORD, Utilities::to_string(direction));
+            if ( !flowPathsIndexed )
+            {
+                flowPathsIndexed = true;
+                updateFlowPaths();
+            }
+            reached = network.graph.findReachable(node, direction == 0, maxTime);
+            *nodeCount = (int)reached.nodes.size();
+            *linkCount = (int)reached.links.size();
+            return 0;
+        }
+        catch (ENerror const& e)
+        {
+            writeMsg(e.msg);
+            return e.code;
+        }
+    }
+
+//-----------------------------------------------------------------------------
+
+    //  Rebuild the network's flow-directed adjacency lists for new flows
+    //  once reachability queries have been made.
+
+    void Project::updateFlowPaths()
+    {
+        if ( flowPathsIndexed ) network.graph.updateFlows(&network);
+    }
+
+//-----------------------------------------------------------------------------
+
+    //  Copy the indexes of the nodes found by the last call to
+    //  findReachable() into nodes.
+
+    int Project::getReachedNodes(int* nodes)
+    {
+        for (size_t i = 0; i < reached.nodes.size(); i++) nodes[i] = reached.nodes[i];
+        return 0;
+    }
+
+//-----------------------------------------------------------------------------
+
+    //  Copy the indexes of the links found by the last call to
+    //  findReachable() into links.
+
+    int Project::getReachedLinks(int* links)
+    {
+        for (size_t i = 0; i < reached.links.size(); i++) links[i] = reached.links[i];
+        return 0;
+    }
+
+//-----------------------------------------------------------------------------
+
+    //  Retrieve a statistic on the water quality solver's segments.
+
+    int Project::getQualStatistic(int type, double* value)
+    {
+        try
+        {
+            *value = 0.0;
+            if ( type < 0 || type >= QualSolver::STATISTIC_COUNT )
+                throw InputError(InputError::INVALID_KEYWORD, Utilities::to_string(type));
+            qualPipeline.finish();
+            *value = qualEngine.getStatistic(type);
+            return 0;
+        }
+        catch (ENerror const& e)
+        {
+            writeMsg(e.msg);
+            return e.code;
+        }
+    }
+
+//-----------------------------------------------------------------------------
+
+    //  Retrieve the current value of an extra water quality species at a
+    //  node (objType 0) or in a link (objType 1).
+
+    int Project::getSpeciesValue(int objType, int index, int species, double* value)
+    {
+        try
+        {
+            *value = 0.0;
+            if ( objType < 0 || objType > 1 )
+                throw InputError(InputError::INVALID_KEYWORD, Utilities::to_string(objType));
+            int count = network.count(objType == 0 ? Element::NODE : Element::LINK);
+            if ( index < 0 || index >= count ||
+                 species < 0 || species >= network.speciesModel.count() )
+                throw InputError(InputError::UNDEFINED_OBJECT, Utilities::to_string(index));
+            qualPipeline.finish();
+            *value = qualEngine.getSpecies(objType, index, species);
+            return 0;
+        }
+        catch (ENerror const& e)
+        {
+            writeMsg(e.msg);
+            return e.code;
+        }
+    }
+
+//-----------------------------------------------------------------------------
+
+    //  Retrieve an impact (see InjectionImpacts::ImpactType) of the injection
+    //  carried by a species, as tallied so far.
+
+    int Project::getInjectionImpact(int species, int type, double* value)
+    {
+        try
+        {
+            *value = 0.0;
+            SpeciesModel& model = network.speciesModel;
+            if ( species < 0 || species >= model.count() ||
+                 model.injectionOf(species) < 0 )
+                throw InputError(InputError::UNDEFINED_OBJECT, Utilities::to_string(species));
+            if ( type < InjectionImpacts::MASS_CONSUMED || type > InjectionImpacts::PEAK_VALUE )
+                throw InputError(InputError::INVALID_KEYWORD, Utilities::to_string(type));
+            if ( !solverInitialized || !runQuality ) return 0;
+            qualPipeline.finish();
+            *value = network.injectionImpacts.getImpact(model.injectionOf(species), type);
+            return 0;
+        }
+        catch (ENerror const& e)
+        {
+            writeMsg(e.msg);
+            return e.code;
+        }
+    }
+
+//-----------------------------------------------------------------------------
+
+    //  Copy the state of the network and its simulation engines to cp.
+
+    void Project::saveState(Checkpoint& cp)
+    {
+        qualPipeline.finish();
+        cp.clear();
+        hydEngine.saveState(cp);
+        if ( runQuality ) qualEngine.saveState(cp);
+    }
+
+//-----------------------------------------------------------------------------
+
+    //  Copy the state of the network and its simulation engines from cp.
+
+    void Project::restoreState(Checkpoint& cp)
+    {
+        qualPipeline.finish();
+        hydEngine.restoreState(cp);
+        if ( qualPipeline.isOpen() ) cp.restoreNetwork(qualPipeline.qualNetwork());
+        if ( runQuality ) qualEngine.restoreState(cp);
+        sourceTracker.truncate(hydEngine.getElapsedTime());
+        updateFlowPaths();
+    }
+
 //-----------------------------------------------------------------------------
 
     //  Open a binary file that saves computed results.
@@ -271,7 +836,7 @@ namespace Epanet
         if ( !outputFileOpened ) return 0;
         try
         {
-            outputFile.writeNetworkResults();
+            outputFile.writeNetworkResults(&qualEngine);
             return 0;
     	}
         catch (ENerror const& e)
@@ -302,6 +867,12 @@ namespace Epanet
         {
             network.qualBalance.writeBalance(network.msgLog);
         }
+
+        // Write the impacts of any injected species to message log
+        if ( runQuality && network.speciesModel.injectionCount() > 0 )
+        {
+            network.injectionImpacts.writeImpacts(&network, network.msgLog);
+        }
      }
 
 //-----------------------------------------------------------------------------
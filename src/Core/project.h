@@ -24,6 +24,10 @@
 #include "Core/network.h"
 #include "Core/hydengine.h"
 #include "Core/qualengine.h"
+#include "Core/qualpipeline.h"
+#include "Core/checkpoint.h"
+#include "Core/streamdriver.h"
+#include "Core/sourcetracker.h"
 #include "Output/outputfile.h"
 
 #include <string>
@@ -55,6 +59,33 @@ namespace Epanet
         int   runSolver(int* t);
         int   advanceSolver(int* dt);
 
+        int   saveCheckpoint();
+        int   restoreCheckpoint();
+        int   fork(Project* source);
+
+        int   openStream(int capacity);
+        int   setBoundary(int type, int index, double value);
+        int   clearBoundaries();
+        int   solveStream(int t);
+        int   runStream(const char* fname);
+        long  readStream(long afterFrame, int* t, double* nodeHead,
+                         double* nodeDemand, double* linkFlow);
+
+        int   openFlowHistory();
+        int   trackSources(int node, int t, int maxAge, int* count);
+        int   getTrackedSource(int i, int* node, double* fraction, double* meanAge);
+        int   getTrackedArrivals(int i, int binWidth, int binCount, double* fractions);
+        int   getTrackedPath(int i, int size, int* links, int* count);
+
+        int   findReachable(int node, int direction, int maxTime,
+                            int* nodeCount, int* linkCount);
+        int   getReachedNodes(int* nodes);
+        int   getReachedLinks(int* links);
+
+        int   getQualStatistic(int type, double* value);
+        int   getSpeciesValue(int objType, int index, int species, double* value);
+        int   getInjectionImpact(int species, int type, double* value);
+
         int   openOutput(const char* fname);
         int   saveOutput();
 
@@ -66,14 +97,19 @@ namespace Epanet
         void  writeMsg(const std::string& msg);
         void  writeMsgLog(std::ostream& out);
         void  writeMsgLog();
-        Network* getNetwork() { return &network; }
+        Network* getNetwork() { qualPipeline.wait(); return &network; }
 
       private:
 
         Network        network;        //!< pipe network to be analyzed.
         HydEngine      hydEngine;      //!< hydraulic simulation engine.
         QualEngine     qualEngine;     //!< water quality simulation engine.
+        QualPipeline   qualPipeline;   //!< overlaps water quality with hydraulics.
         OutputFile     outputFile;     //!< binary output file for saved results.
+        Checkpoint     checkpoint;     //!< saved state of an in-progress simulation.
+        StreamDriver   streamDriver;   //!< re-solves hydraulics from live measurements.
+        SourceTracker  sourceTracker;  //!< traces water back to its sources.
+        Graph::Reach   reached;        //!< result of the last reachability query.
         std::string    inpFileName;    //!< name of project's input file.
         std::string    outFileName;    //!< name of project's binary output file.
         std::string    tmpFileName;    //!< name of project's temporary binary output file.
@@ -87,9 +123,15 @@ namespace Epanet
         bool           outputFileOpened;
         bool           solverInitialized;
         bool           runQuality;
+        bool           flowPathsIndexed;
 
         void           finalizeSolver();
+        void           saveState(Checkpoint& cp);
+        void           restoreState(Checkpoint& cp);
         void           closeReport();
+        void           updateFlowPaths();
+        void           checkEquilibrium();
+        bool           canPipelineQuality();
     };
 }
 #endif
@@ -9,12 +9,10 @@
  //  Implementation of the QualEngine class.  //
  ///////////////////////////////////////////////
 
- // TO DO:
- // - implement a topological sort in function sortLinks()
-
 #include "qualengine.h"
 #include "network.h"
 #include "error.h"
+#include "checkpoint.h"
 #include "Models/qualmodel.h"
 #include "Solvers/qualsolver.h"
 #include "Elements/qualsource.h"
@@ -23,6 +21,7 @@
 #include "Utilities/utilities.h"
 
 #include <cmath>
+#include <climits>
 #include <algorithm>
 using namespace std;
 
@@ -37,7 +36,12 @@ QualEngine::QualEngine() :
     nodeCount(0),
     linkCount(0),
     qualTime(0),
-    qualStep(0)
+    qualStep(0),
+    courantNumber(0.0),
+    cyclicLinks(0),
+    cycleTime(-1),
+    cycleChange(-1.0),
+    equilibriumTime(-1)
 {
 }
 
@@ -82,15 +86,31 @@ void QualEngine::open(Network* nw)
 
     // ... create a water quality solver
 
-    qualSolver = QualSolver::factory("LTD", network);
+    qualSolver = QualSolver::factory(
+        network->option(Options::QUAL_SOLVER), network);
     if (!qualSolver) throw SystemError(SystemError::QUALITY_SOLVER_NOT_OPENED);
 
+    // ... extra species can't be left out without the user knowing
+
+    if ( network->speciesModel.count() > 0 && !qualSolver->carriesSpecies() )
+    {
+        delete qualSolver;
+        qualSolver = nullptr;
+        throw InputError(InputError::SPECIES_NOT_SUPPORTED,
+                         network->option(Options::QUAL_SOLVER));
+    }
+
     // ... create sorted link & flow direction arrays
 
     try
     {
-	    sortedLinks.resize(linkCount, 0);
+        sortedLinks.resize(linkCount, 0);
         flowDirection.resize(linkCount, 0);
+        nodeOrder.resize(nodeCount, 0);
+        nodePosition.resize(nodeCount, 0);
+        groupStart.resize(nodeCount + 1, 0);
+        marked.resize(nodeCount, 0);
+        createAdjacencyLists();
         engineState = QualEngine::OPENED;
     }
     catch (...)
@@ -124,9 +144,15 @@ void QualEngine::init()
 
     qualSolver->init();
     network->qualModel->init(network);
+    network->injectionImpacts.init(network);
     qualStep = network->option(Options::QUAL_STEP);
     if ( qualStep <= 0 ) qualStep = 300;
+    courantNumber = network->option(Options::COURANT_NUMBER);
     qualTime = 0;
+    cycleTime = -1;
+    cycleChange = -1.0;
+    equilibriumTime = -1;
+    cycleValues.clear();
     engineState = QualEngine::INITIALIZED;
 }
 
@@ -140,11 +166,27 @@ void QualEngine::solve(int tstep)
 
     if ( engineState != QualEngine::INITIALIZED ) return;
     if ( tstep == 0 ) return;
+    SpeciesModel& species = network->speciesModel;
+
+    // ... a steady state solution holds over the whole time step
+
+    if ( qualSolver->isSteadyState() )
+    {
+        network->injectionImpacts.update(network,
+            qualSolver->getSpeciesValues(), qualTime, tstep);
+        qualTime += tstep;
+        return;
+    }
 
-   // ... topologically sort the links if flow direction has changed
+    // ... topologically sort the links if flow direction has changed
+    //     (re-ordering just the nodes between the ends of each reversed
+    //     link unless a flow cycle calls for a complete sort)
 
     if ( qualTime == 0 ) sortLinks();
-    else if ( flowDirectionsChanged() ) sortLinks();
+    else if ( flowDirectionsChanged() )
+    {
+        if ( cyclicLinks > 0 || !updateSortedLinks() ) sortLinks();
+    }
 
     // ... determine external source quality
 
@@ -153,18 +195,53 @@ void QualEngine::solve(int tstep)
     // ... propagate water quality through network over a sequence
     //     of water quality time steps
 
+    int t = qualTime;
     qualTime += tstep;
 
+    // ... an event driven solver can cover the whole time step at once
+    //     unless there are reactions to apply at each quality step
+
+    int maxStep = qualStep;
+    if ( qualSolver->isEventDriven() && !network->qualModel->isReactive() )
+    {
+        maxStep = tstep;
+    }
+
+    // ... otherwise the quality step can grow with the shortest pipe
+    //     travel time for the time step's flows
+
+    else if ( courantNumber > 0.0 ) maxStep = findCourantStep(tstep);
+
     while ( tstep > 0 )
     {
-        int qstep = min(qualStep, tstep);
-        qualSolver->solve(&sortedLinks[0], qstep);
+        int qstep = min(maxStep, tstep);
+        species.setInjectionTime(t);
+        qualSolver->solve(&sortedLinks[0], cyclicLinks, qstep);
+        t += qstep;
         tstep -= qstep;
+        network->injectionImpacts.update(network,
+            qualSolver->getSpeciesValues(), t, qstep);
     }
 }
 
 //-----------------------------------------------------------------------------
 
+//  Find the steady state water quality for the current flows when the
+//  quality solver works that way (there's no time step to solve over).
+
+void QualEngine::solveSteadyState()
+{
+    if ( engineState != QualEngine::INITIALIZED ) return;
+    if ( !qualSolver->isSteadyState() ) return;
+
+    sortLinks();
+    setSourceQuality();
+    network->speciesModel.setInjectionTime(qualTime);
+    qualSolver->solve(&sortedLinks[0], cyclicLinks, 0);
+}
+
+//-----------------------------------------------------------------------------
+
 //  Close the quality solver.
 
 void QualEngine::close()
@@ -173,25 +250,154 @@ void QualEngine::close()
     qualSolver = nullptr;
     sortedLinks.clear();
     flowDirection.clear();
+    nodeOrder.clear();
+    nodePosition.clear();
+    groupStart.clear();
+    adjStart.clear();
+    adjLinks.clear();
+    marked.clear();
     engineState = QualEngine::CLOSED;
 }
 
 //-----------------------------------------------------------------------------
 
-//  Check if the flow direction of any link has changed.
+//  Save the engine's state and the contents of its quality solver.
+
+void QualEngine::saveState(Checkpoint& cp)
+{
+    if ( engineState != QualEngine::INITIALIZED ) return;
+    cp.qualTime = qualTime;
+    cp.sortedLinks = sortedLinks;
+    cp.flowDirection = flowDirection;
+    cp.nodeOrder = nodeOrder;
+    cp.cyclicLinks = cyclicLinks;
+    cp.qualBalance = network->qualBalance;
+    cp.injectionImpacts = network->injectionImpacts;
+    qualSolver->saveState(cp);
+}
+
+//-----------------------------------------------------------------------------
+
+//  Restore the engine's state and the contents of its quality solver.
+
+void QualEngine::restoreState(Checkpoint& cp)
+{
+    if ( engineState != QualEngine::INITIALIZED ) return;
+    if ( (int)cp.flowDirection.size() != linkCount ||
+         (int)cp.nodeOrder.size() != nodeCount )
+        throw SystemError(SystemError::NO_CHECKPOINT);
+
+    qualTime = cp.qualTime;
+    sortedLinks = cp.sortedLinks;
+    flowDirection = cp.flowDirection;
+    nodeOrder = cp.nodeOrder;
+    cyclicLinks = cp.cyclicLinks;
+    for (int p = 0; p < nodeCount; p++) nodePosition[nodeOrder[p]] = p;
+    groupStart[0] = cyclicLinks;
+    groupLinks(0, nodeCount - 1);
+    network->qualBalance = cp.qualBalance;
+    network->injectionImpacts = cp.injectionImpacts;
+    qualSolver->restoreState(cp);
+    cycleTime = -1;
+    cycleChange = -1.0;
+    equilibriumTime = -1;
+}
+
+//-----------------------------------------------------------------------------
+
+//  Return one of the quality solver's statistics (see QualSolver::Statistic).
+
+double QualEngine::getStatistic(int type)
+{
+    if ( type == QualSolver::EQUILIBRIUM_TIME ) return equilibriumTime;
+    if ( type == QualSolver::CYCLE_CHANGE ) return cycleChange;
+    if ( !qualSolver ) return 0.0;
+    return qualSolver->getStatistic(type);
+}
+
+//-----------------------------------------------------------------------------
+
+//  Compare the quality at each node, and any species values there, with
+//  those saved one period (sec) earlier and save the current values in
+//  their place. Returns true if none has changed by more than tol (in user
+//  units) and no tank level by more than headTol (ft), i.e., if quality now
+//  repeats with the period.
+
+bool QualEngine::reachedEquilibrium(int period, double tol, double headTol)
+{
+    if ( engineState != QualEngine::INITIALIZED ) return false;
+
+    // ... injections started and stopped at set times aren't periodic
+    if ( network->speciesModel.injectionCount() > 0 ) return false;
+
+    int m = network->speciesModel.count();
+    const double* x = qualSolver->getSpeciesValues();
+    size_t n = (size_t)nodeCount * (m + 2);
+    bool comparing = cycleTime == qualTime - period && cycleValues.size() == n;
+    if ( !comparing ) cycleValues.resize(n);
+
+    // ... tank levels must repeat for quality to go on repeating
+    double ccf = network->ucf(Units::CONCEN);
+    double change = 0.0;
+    double headChange = 0.0;
+    for (int i = 0; i < nodeCount; i++)
+    {
+        Node* node = network->node(i);
+        double* v = &cycleValues[(size_t)i * (m + 2)];
+        if ( comparing && node->type() == Node::TANK )
+        {
+            headChange = max(headChange, abs(node->head - v[0]));
+        }
+        v[0] = node->head;
+        v++;
+
+        double c = node->quality * ccf;
+        if ( comparing ) change = max(change, abs(c - v[0]));
+        v[0] = c;
+        for (int s = 0; s < m && x; s++)
+        {
+            c = x[(size_t)i * m + s];
+            if ( comparing ) change = max(change, abs(c - v[s+1]));
+            v[s+1] = c;
+        }
+    }
+    cycleTime = qualTime;
+    if ( !comparing ) return false;
+    cycleChange = change;
+    if ( change > tol || headChange > headTol ) return false;
+    equilibriumTime = qualTime;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+
+//  Return the value of an extra species at a node (objType 0) or in a
+//  link (objType 1), in user units.
+
+double QualEngine::getSpecies(int objType, int index, int species)
+{
+    if ( !qualSolver ) return 0.0;
+    if ( objType == 0 ) return qualSolver->getNodeSpecies(index, species);
+    return qualSolver->getLinkSpecies(index, species);
+}
+
+//-----------------------------------------------------------------------------
+
+//  Check if the flow direction of any link has changed, saving the
+//  reversed links in changedLinks.
 
 bool QualEngine::flowDirectionsChanged()
 {
-    bool result = false;
+    changedLinks.clear();
     for (int i = 0; i < linkCount; i++)
     {
         if ( network->link(i)->flow * flowDirection[i] < 0 )
         {
             qualSolver->reverseFlow(i);
-            result = true;
+            changedLinks.push_back(i);
         }
     }
-    return result;
+    return changedLinks.size() > 0;
 }
 
 //-----------------------------------------------------------------------------
@@ -229,23 +435,312 @@ void QualEngine::setSourceQuality()
 //-----------------------------------------------------------------------------
 
 //  Topologically sort the network's links based on current flow directions.
+//
+//  Nodes are ordered so that each one follows every node that sends flow
+//  into it, and sortedLinks then lists the links leaving each node in that
+//  order. Where pumps drive flow around a closed loop no such order exists;
+//  the loop is broken at the node with the fewest unsorted flowing inflows
+//  and the links entering it from later in the order are listed ahead of
+//  all others as cyclic links.
 
 void QualEngine::sortLinks()
 {
-    // ... default sorted order
-
     setFlowDirections();
-    for (int j = 0; j < linkCount; j++) sortedLinks[j] = j;
+
+    // ... count the links that flow into each node
+
+    vector<int> inDegree(nodeCount, 0);
+    for (int k = 0; k < linkCount; k++) inDegree[downstreamNode(k)]++;
+
+    // ... start from the nodes that have no inflow
+
+    nodeStack.clear();
+    for (int n = nodeCount - 1; n >= 0; n--)
+    {
+        marked[n] = 0;
+        if ( inDegree[n] == 0 ) nodeStack.push_back(n);
+    }
+
+    int count = 0;
+    while ( count < nodeCount )
+    {
+        // ... the remaining nodes all lie on or below a flow cycle
+
+        if ( nodeStack.empty() )
+        {
+            int best = -1;
+            int bestFlowing = INT_MAX;
+            for (int n = 0; n < nodeCount; n++)
+            {
+                if ( marked[n] ) continue;
+                int flowing = 0;
+                for (int i = adjStart[n]; i < adjStart[n+1]; i++)
+                {
+                    int k = adjLinks[i];
+                    if ( downstreamNode(k) == n &&
+                         !marked[upstreamNode(k)] &&
+                         network->link(k)->flow != 0.0 ) flowing++;
+                }
+                if ( flowing < bestFlowing ||
+                   ( flowing == bestFlowing && inDegree[n] < inDegree[best] ) )
+                {
+                    best = n;
+                    bestFlowing = flowing;
+                }
+            }
+            inDegree[best] = 0;
+            nodeStack.push_back(best);
+        }
+
+        // ... place the next node and release the nodes it flows into
+
+        int n = nodeStack.back();
+        nodeStack.pop_back();
+        marked[n] = 1;
+        nodePosition[n] = count;
+        nodeOrder[count++] = n;
+        for (int i = adjStart[n]; i < adjStart[n+1]; i++)
+        {
+            int k = adjLinks[i];
+            if ( upstreamNode(k) != n ) continue;
+            int m = downstreamNode(k);
+            if ( !marked[m] && --inDegree[m] == 0 ) nodeStack.push_back(m);
+        }
+    }
+    for (int n = 0; n < nodeCount; n++) marked[n] = 0;
+
+    // ... cyclic links come first, followed by each node's outflow links
+
+    cyclicLinks = 0;
+    for (int k = 0; k < linkCount; k++)
+    {
+        if ( nodePosition[upstreamNode(k)] > nodePosition[downstreamNode(k)] )
+        {
+            sortedLinks[cyclicLinks++] = k;
+        }
+    }
+    groupStart[0] = cyclicLinks;
+    groupLinks(0, nodeCount - 1);
+}
+
+//-----------------------------------------------------------------------------
+
+//  Update the sorted links for the reversals listed in changedLinks when
+//  the current order has no flow cycles. Returns false if a reversal
+//  creates a cycle, in which case a complete sort is needed.
+
+bool QualEngine::updateSortedLinks()
+{
+    int first = nodeCount;
+    int last = -1;
+    for (int k : changedLinks)
+    {
+        flowDirection[k] = -flowDirection[k];
+        int x = upstreamNode(k);
+        int y = downstreamNode(k);
+        int px = nodePosition[x];
+        int py = nodePosition[y];
+        first = min(first, min(px, py));
+        last = max(last, max(px, py));
+        if ( px > py && !reorderNodes(x, y) ) return false;
+    }
+
+    // ... only the links leaving nodes between positions first and last
+    //     can have changed places
+
+    groupLinks(first, last);
+    return true;
 }
 
 //-----------------------------------------------------------------------------
 
-//  Set the flow direction indicator in each network link.
+//  Restore a topological order after link flow from node x to node y has
+//  reversed to place x after y, moving only the nodes positioned between
+//  them (the method of Pearce and Kelly). Returns false if the new flow
+//  direction creates a cycle.
+
+bool QualEngine::reorderNodes(int x, int y)
+{
+    int lower = nodePosition[y];
+    int upper = nodePosition[x];
+
+    // ... find the nodes between y and x that are reached from y
+
+    forwardNodes.clear();
+    nodeStack.assign(1, y);
+    marked[y] = 1;
+    bool cycle = false;
+    while ( !nodeStack.empty() && !cycle )
+    {
+        int n = nodeStack.back();
+        nodeStack.pop_back();
+        forwardNodes.push_back(n);
+        for (int i = adjStart[n]; i < adjStart[n+1]; i++)
+        {
+            int k = adjLinks[i];
+            if ( upstreamNode(k) != n ) continue;
+            int m = downstreamNode(k);
+            if ( m == x ) cycle = true;
+            if ( marked[m] || nodePosition[m] > upper ) continue;
+            marked[m] = 1;
+            nodeStack.push_back(m);
+        }
+    }
+    if ( cycle )
+    {
+        for (int n : forwardNodes) marked[n] = 0;
+        for (int n : nodeStack) marked[n] = 0;
+        return false;
+    }
+
+    // ... find the nodes between y and x that reach x
+
+    backwardNodes.clear();
+    nodeStack.assign(1, x);
+    marked[x] = 1;
+    while ( !nodeStack.empty() )
+    {
+        int n = nodeStack.back();
+        nodeStack.pop_back();
+        backwardNodes.push_back(n);
+        for (int i = adjStart[n]; i < adjStart[n+1]; i++)
+        {
+            int k = adjLinks[i];
+            if ( downstreamNode(k) != n ) continue;
+            int m = upstreamNode(k);
+            if ( marked[m] || nodePosition[m] < lower ) continue;
+            marked[m] = 1;
+            nodeStack.push_back(m);
+        }
+    }
+
+    // ... re-use the positions of both sets of nodes, placing those
+    //     that reach x ahead of those reached from y
+
+    auto byPosition = [this](int a, int b)
+                      { return nodePosition[a] < nodePosition[b]; };
+    sort(forwardNodes.begin(), forwardNodes.end(), byPosition);
+    sort(backwardNodes.begin(), backwardNodes.end(), byPosition);
+
+    nodeStack.clear();
+    for (int n : backwardNodes) nodeStack.push_back(nodePosition[n]);
+    for (int n : forwardNodes) nodeStack.push_back(nodePosition[n]);
+    sort(nodeStack.begin(), nodeStack.end());
+
+    size_t i = 0;
+    for (int n : backwardNodes) nodeOrder[nodeStack[i++]] = n;
+    for (int n : forwardNodes) nodeOrder[nodeStack[i++]] = n;
+    for (int p : nodeStack)
+    {
+        nodePosition[nodeOrder[p]] = p;
+        marked[nodeOrder[p]] = 0;
+    }
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+
+//  List the non-cyclic links leaving the nodes at positions first through
+//  last of the topological order in sortedLinks, starting at the location
+//  given by groupStart[first].
+
+void QualEngine::groupLinks(int first, int last)
+{
+    int j = groupStart[first];
+    for (int p = first; p <= last; p++)
+    {
+        groupStart[p] = j;
+        int n = nodeOrder[p];
+        for (int i = adjStart[n]; i < adjStart[n+1]; i++)
+        {
+            int k = adjLinks[i];
+            if ( upstreamNode(k) != n ) continue;
+            if ( nodePosition[downstreamNode(k)] < p ) continue;
+            sortedLinks[j++] = k;
+        }
+    }
+    groupStart[last+1] = j;
+}
+
+//-----------------------------------------------------------------------------
+
+//  Set the flow direction indicator in each network link. A link without
+//  flow keeps its previous direction so that it agrees with the order of
+//  the quality solver's segments.
 
 void QualEngine::setFlowDirections()
 {
     for (int i = 0; i < linkCount; i++)
     {
-    	flowDirection[i] = Utilities::sign(network->link(i)->flow);
+        double q = network->link(i)->flow;
+        if ( q != 0.0 || flowDirection[i] == 0 )
+        {
+            flowDirection[i] = Utilities::sign(q);
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+//  Find the links incident on each node.
+
+void QualEngine::createAdjacencyLists()
+{
+    adjStart.assign(nodeCount + 1, 0);
+    for (Link* link : network->links)
+    {
+        adjStart[link->fromNode->index + 1]++;
+        if ( link->toNode != link->fromNode ) adjStart[link->toNode->index + 1]++;
+    }
+    for (int n = 0; n < nodeCount; n++) adjStart[n+1] += adjStart[n];
+
+    adjLinks.resize(adjStart[nodeCount]);
+    vector<int> next(adjStart.begin(), adjStart.end() - 1);
+    for (int k = 0; k < linkCount; k++)
+    {
+        Link* link = network->link(k);
+        adjLinks[next[link->fromNode->index]++] = k;
+        if ( link->toNode != link->fromNode ) adjLinks[next[link->toNode->index]++] = k;
     }
 }
+
+//-----------------------------------------------------------------------------
+
+//  Find the largest quality step, between the fixed quality step and the
+//  hydraulic time step tstep, that's no more than the Courant number times
+//  the shortest travel time through any flowing pipe. Flows are constant
+//  over a hydraulic time step, so this is found once per step.
+
+int QualEngine::findCourantStep(int tstep)
+{
+    double minTime = tstep / courantNumber;
+    for (Link* link : network->links)
+    {
+        if ( link->type() != Link::PIPE || link->flow == 0.0 ) continue;
+        minTime = min(minTime, link->getVolume() / abs(link->flow));
+    }
+    int step = (int)(courantNumber * minTime);
+    return max(qualStep, min(step, tstep));
+}
+
+//-----------------------------------------------------------------------------
+
+//  Find the index of the node a link's flow leaves from.
+
+int QualEngine::upstreamNode(int k)
+{
+    Link* link = network->link(k);
+    if ( flowDirection[k] < 0 ) return link->toNode->index;
+    return link->fromNode->index;
+}
+
+//-----------------------------------------------------------------------------
+
+//  Find the index of the node a link's flow enters.
+
+int QualEngine::downstreamNode(int k)
+{
+    Link* link = network->link(k);
+    if ( flowDirection[k] < 0 ) return link->fromNode->index;
+    return link->toNode->index;
+}
@@ -15,6 +15,7 @@
 
 class Network;
 class QualSolver;
+class Checkpoint;
 //class JuncMixer;
 //class TankMixer;
 
@@ -39,7 +40,14 @@ class QualEngine
     void   open(Network* nw);
     void   init();
     void   solve(int tstep);
+    void   solveSteadyState();
     void   close();
+    void   saveState(Checkpoint& cp);
+    void   restoreState(Checkpoint& cp);
+    double getStatistic(int type);
+    bool   reachedEquilibrium(int period, double tol, double headTol);
+    void   skipTime(int dt) { qualTime += dt; }
+    double getSpecies(int objType, int index, int species);
 
 private:
 
@@ -59,15 +67,41 @@ private:
     int         linkCount;          //!< number of network links
     int         qualTime;           //!< current simulation time (sec)
     int         qualStep;           //!< hydraulic time step (sec)
+    double      courantNumber;      //!< quality step / shortest travel time (0 if fixed)
+    int         cyclicLinks;        //!< number of links that close a flow cycle
     std::vector<int>  sortedLinks;      //!< topologically sorted links
     std::vector<char> flowDirection;    //!< direction (+/-) of link flow
+    std::vector<int>  nodeOrder;        //!< nodes in topological order
+    std::vector<int>  nodePosition;     //!< position of each node in nodeOrder
+    std::vector<int>  groupStart;       //!< start of each node's outflow links
+    std::vector<int>  adjStart;         //!< start of each node's links in adjLinks
+    std::vector<int>  adjLinks;         //!< links incident on each node
+    std::vector<int>  changedLinks;     //!< links whose flow has reversed
+    std::vector<int>  nodeStack;        //!< work space for sorting
+    std::vector<int>  forwardNodes;     //!< work space for sorting
+    std::vector<int>  backwardNodes;    //!< work space for sorting
+    std::vector<char> marked;           //!< work space for sorting
+
+    // Periodic equilibrium detection
+
+    int         cycleTime;          //!< time cycleValues were saved (sec)
+    double      cycleChange;        //!< largest change over the last cycle
+    int         equilibriumTime;    //!< time quality became periodic (sec)
+    std::vector<double> cycleValues;    //!< node quality & species one cycle ago
 
     // Simulation sub-tasks
 
     bool        flowDirectionsChanged();
     void        setFlowDirections();
+    void        createAdjacencyLists();
     void        sortLinks();
+    bool        updateSortedLinks();
+    bool        reorderNodes(int x, int y);
+    void        groupLinks(int first, int last);
+    int         upstreamNode(int k);
+    int         downstreamNode(int k);
     void        setSourceQuality();
+    int         findCourantStep(int tstep);
 };
 
 #endif
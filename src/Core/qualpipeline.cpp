@@ -0,0 +1,260 @@
+/* EPANET 3
+ *
+ * Copyright (c) 2016 Open Water Analytics
+ * Licensed under the terms of the MIT License (see the LICENSE file for details).
+ *
+ */
+
+ //////////////////////////////////////////////////
+ //  Implementation of the QualPipeline class.  //
+ //////////////////////////////////////////////////
+
+#include "qualpipeline.h"
+#include "Core/qualengine.h"
+#include "Core/error.h"
+#include "Elements/node.h"
+#include "Elements/link.h"
+#include "Elements/tank.h"
+#include "Elements/pipe.h"
+#include "Elements/pattern.h"
+#include "Elements/qualsource.h"
+#include "Input/inputreader.h"
+#include "Output/projectwriter.h"
+#include "Utilities/utilities.h"
+
+#include <cstdio>
+using namespace std;
+
+//-----------------------------------------------------------------------------
+
+//  Constructor
+
+QualPipeline::QualPipeline() :
+    network(0),
+    resultsReady(false)
+{}
+
+//  Destructor
+
+QualPipeline::~QualPipeline()
+{
+    close();
+}
+
+//-----------------------------------------------------------------------------
+
+//  Makes a copy of a network, via a temporary input file, for the water
+//  quality engine to work on.
+
+void QualPipeline::open(Network* nw)
+{
+    close();
+    string tmpFile;
+    if ( !Utilities::getTmpFileName(tmpFile) )
+    {
+        throw SystemError(SystemError::QUALITY_SOLVER_NOT_OPENED);
+    }
+    try
+    {
+        ProjectWriter projectWriter;
+        projectWriter.writeFile(tmpFile.c_str(), nw);
+        InputReader inputReader;
+        inputReader.readFile(tmpFile.c_str(), &copy);
+        copy.convertUnits();
+        copy.options.adjustOptions();
+    }
+    catch (...)
+    {
+        remove(tmpFile.c_str());
+        copy.clear();
+        throw;
+    }
+    remove(tmpFile.c_str());
+    network = nw;
+    copyInputs();
+    copyHydraulics(0);
+}
+
+//-----------------------------------------------------------------------------
+
+//  Waits for any quality step still in progress and discards the copy of
+//  the network.
+
+void QualPipeline::close()
+{
+    if ( worker.joinable() ) worker.join();
+    error = nullptr;
+    resultsReady = false;
+    if ( network ) copy.clear();
+    network = 0;
+}
+
+//-----------------------------------------------------------------------------
+
+//  Starts solving water quality over a time step of tstep seconds on the
+//  worker thread, using the network's hydraulics at time t.
+
+void QualPipeline::solve(QualEngine* engine, int t, int tstep)
+{
+    finish();
+    copyHydraulics(t);
+    resultsReady = true;
+    worker = thread([this, engine, tstep]()
+    {
+        try
+        {
+            engine->solve(tstep);
+        }
+        catch (...)
+        {
+            error = current_exception();
+        }
+    });
+}
+
+//-----------------------------------------------------------------------------
+
+//  Waits for the current quality step to end and copies its results back
+//  into the network. Any error it raised is kept for finish() to throw.
+
+void QualPipeline::wait()
+{
+    if ( worker.joinable() ) worker.join();
+    if ( resultsReady ) copyResults();
+}
+
+//-----------------------------------------------------------------------------
+
+//  Waits for the current quality step to end, throwing any error it raised.
+
+void QualPipeline::finish()
+{
+    wait();
+    if ( error )
+    {
+        exception_ptr e = error;
+        error = nullptr;
+        rethrow_exception(e);
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+//  Copies the water quality found on the copy of the network back into
+//  the network.
+
+void QualPipeline::copyResults()
+{
+    resultsReady = false;
+    if ( !network ) return;
+    int nodeCount = network->count(Element::NODE);
+    for (int i = 0; i < nodeCount; i++)
+    {
+        Node* node = network->node(i);
+        Node* qualNode = copy.node(i);
+        node->quality = qualNode->quality;
+        if ( node->qualSource && qualNode->qualSource )
+        {
+            node->qualSource->strength = qualNode->qualSource->strength;
+            node->qualSource->outflow = qualNode->qualSource->outflow;
+            node->qualSource->quality = qualNode->qualSource->quality;
+        }
+    }
+
+    int linkCount = network->count(Element::LINK);
+    for (int i = 0; i < linkCount; i++)
+    {
+        network->link(i)->quality = copy.link(i)->quality;
+    }
+    network->qualBalance = copy.qualBalance;
+    network->injectionImpacts = copy.injectionImpacts;
+}
+
+//-----------------------------------------------------------------------------
+
+//  Copies the network's options, species and the element properties that
+//  water quality depends on into the copy of the network, since numbers
+//  are rounded off (and tank volumes found) when the input file is written.
+
+void QualPipeline::copyInputs()
+{
+    copy.options = network->options;
+    copy.speciesModel = network->speciesModel;
+
+    int nodeCount = network->count(Element::NODE);
+    for (int i = 0; i < nodeCount; i++)
+    {
+        Node* node = network->node(i);
+        Node* qualNode = copy.node(i);
+        qualNode->elev = node->elev;
+        qualNode->initQual = node->initQual;
+        if ( node->qualSource && qualNode->qualSource )
+        {
+            qualNode->qualSource->base = node->qualSource->base;
+        }
+        if ( node->type() == Node::TANK )
+        {
+            Tank* tank = static_cast<Tank*>(node);
+            Tank* qualTank = static_cast<Tank*>(qualNode);
+            qualTank->initHead = tank->initHead;
+            qualTank->minHead = tank->minHead;
+            qualTank->maxHead = tank->maxHead;
+            qualTank->diameter = tank->diameter;
+            qualTank->minVolume = tank->minVolume;
+            qualTank->maxVolume = tank->maxVolume;
+            qualTank->bulkCoeff = tank->bulkCoeff;
+            qualTank->mixingModel.fracMixed = tank->mixingModel.fracMixed;
+        }
+    }
+
+    int linkCount = network->count(Element::LINK);
+    for (int i = 0; i < linkCount; i++)
+    {
+        Link* link = network->link(i);
+        Link* qualLink = copy.link(i);
+        qualLink->diameter = link->diameter;
+        if ( link->type() == Link::PIPE )
+        {
+            Pipe* pipe = static_cast<Pipe*>(link);
+            Pipe* qualPipe = static_cast<Pipe*>(qualLink);
+            qualPipe->length = pipe->length;
+            qualPipe->roughness = pipe->roughness;
+            qualPipe->bulkCoeff = pipe->bulkCoeff;
+            qualPipe->wallCoeff = pipe->wallCoeff;
+        }
+    }
+
+    int patternCount = network->count(Element::PATTERN);
+    for (int i = 0; i < patternCount; i++)
+    {
+        Pattern* pattern = network->pattern(i);
+        Pattern* qualPattern = copy.pattern(i);
+        for (int j = 0; j < pattern->size(); j++)
+        {
+            qualPattern->setFactor(j, pattern->factor(j));
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+//  Copies the network's hydraulic state into the copy of the network and
+//  moves the copy's time patterns to time t (as HydEngine::movePatterns
+//  does when a simulation is restored to that time).
+
+void QualPipeline::copyHydraulics(int t)
+{
+    hydState.saveNetwork(network);
+    if ( !hydState.restoreNetwork(&copy, true) )
+    {
+        throw SystemError(SystemError::QUALITY_SOLVER_FAILURE);
+    }
+
+    int patternStep = copy.option(Options::PATTERN_STEP);
+    int patternStart = copy.option(Options::PATTERN_START);
+    for (Pattern* pattern : copy.patterns)
+    {
+        pattern->init(patternStep, patternStart);
+        pattern->advance(t);
+    }
+}
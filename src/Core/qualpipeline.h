@@ -0,0 +1,76 @@
+/* EPANET 3
+ *
+ * Copyright (c) 2016 Open Water Analytics
+ * Licensed under the terms of the MIT License (see the LICENSE file for details).
+ *
+ */
+
+//! \file qualpipeline.h
+//! \brief Describes the QualPipeline class.
+
+#ifndef QUALPIPELINE_H_
+#define QUALPIPELINE_H_
+
+#include "Core/network.h"
+#include "Core/checkpoint.h"
+
+#include <thread>
+#include <exception>
+
+class QualEngine;
+
+//! \class QualPipeline
+//! \brief Solves water quality on its own thread, overlapping hydraulics.
+//!
+//! In an extended period simulation the water quality over one hydraulic
+//! period only needs that period's flows, so it can be found while the
+//! hydraulics of the next period are being solved. To do so the quality
+//! engine is opened on a copy of the network rather than on the network
+//! itself. The two copies act as a double buffer: before a period's
+//! quality is solved the hydraulic state of the network (heads, demands,
+//! flows, link status and tank volumes) and the position of its time
+//! patterns are copied into the quality network, after which the
+//! hydraulic engine is free to overwrite the originals while the quality
+//! engine works on the copy. Once the quality step ends, node and link
+//! quality, source state, the mass balance and any injection impacts are
+//! copied back into the network.
+//!
+//! The copy is made by writing the network to a temporary input file and
+//! reading it back, after which the options and element properties that
+//! water quality depends on are copied over exactly. Because the quality
+//! engine then sees the same state it would have seen without the
+//! pipeline, results are identical to a serial run. Changes made to the
+//! network's input data after the pipeline is opened are not seen by the
+//! quality engine until it is opened again.
+
+class QualPipeline
+{
+  public:
+
+    QualPipeline();
+    ~QualPipeline();
+
+    void     open(Network* nw);
+    void     close();
+    bool     isOpen() { return network != 0; }
+    Network* qualNetwork() { return &copy; }
+
+    void     solve(QualEngine* engine, int t, int tstep);
+    void     wait();
+    void     finish();
+    void     copyResults();
+
+  private:
+
+    Network*           network;       //!< network whose hydraulics are solved
+    Network            copy;          //!< copy of the network used for quality
+    Checkpoint         hydState;      //!< hydraulic state passed to the copy
+    std::thread        worker;        //!< thread solving the current step
+    std::exception_ptr error;         //!< error thrown by the current step
+    bool               resultsReady;  //!< true if results are yet to be copied
+
+    void     copyInputs();
+    void     copyHydraulics(int t);
+};
+
+#endif
@@ -0,0 +1,575 @@
+/* EPANET 3
+ *
+ * Copyright (c) 2016 Open Water Analytics
+ * Licensed under the terms of the MIT License (see the LICENSE file for details).
+ *
+ */
+
+#include "ruleengine.h"
+#include "Core/network.h"
+#include "Elements/rule.h"
+#include "Elements/node.h"
+#include "Elements/tank.h"
+#include "Elements/link.h"
+#include "Elements/pump.h"
+#include "Utilities/utilities.h"
+
+#include <cmath>
+#include <map>
+#include <algorithm>
+using namespace std;
+
+static const double MISSING = -1.0e10;   // value of an undefined input
+static const double TINY    = 1.0e-6;    // smallest tank flow rate (cfs)
+static const int    SECperDAY = 86400;
+
+static const string s_ByRule         = " by rule ";
+static const string s_StatusChanged  = " status changed to ";
+static const string s_SettingChanged = " setting changed to ";
+static const string statusTxt[]      = {"closed", "open", "active"};
+
+//-----------------------------------------------------------------------------
+
+//  Constructor
+
+RuleEngine::RuleEngine() :
+    network(0),
+    ruleCount(0),
+    ruleStep(0),
+    tankInputCount(0)
+{}
+
+//  Destructor
+
+RuleEngine::~RuleEngine()
+{}
+
+//-----------------------------------------------------------------------------
+
+//  Compile the network's rules into premise, action and input arrays.
+
+void RuleEngine::open(Network* nw)
+{
+    close();
+    network = nw;
+    ruleCount = nw->count(Element::RULE);
+    ruleStep = nw->option(Options::RULE_STEP);
+    if ( ruleCount == 0 ) return;
+
+    // ... find the input type read by each premise of each rule
+
+    vector<int> premiseType;
+    vector<int> premiseIndex;
+    for (int r = 0; r < ruleCount; r++)
+    {
+        Rule* rule = nw->rule(r);
+        for (RulePremise& p : rule->premises)
+        {
+            int type = -1;
+            int index = -1;
+            bool isTank = false;
+            if ( p.object == RulePremise::NODE )
+            {
+                Node* node = static_cast<Node*>(p.element);
+                index = nw->indexOf(Element::NODE, node->name);
+                isTank = ( node->type() == Node::TANK );
+            }
+            else if ( p.object == RulePremise::LINK )
+            {
+                Link* link = static_cast<Link*>(p.element);
+                index = nw->indexOf(Element::LINK, link->name);
+            }
+
+            switch (p.variable)
+            {
+            case RulePremise::DEMAND:
+                if ( p.object == RulePremise::SYSTEM ) type = SYSTEM_DEMAND;
+                else type = NODE_DEMAND;
+                break;
+            case RulePremise::HEAD:
+            case RulePremise::GRADE:
+            case RulePremise::LEVEL:
+            case RulePremise::PRESSURE:
+                type = isTank ? TANK_HEAD : NODE_HEAD;
+                break;
+            case RulePremise::FILLTIME:  type = TANK_FILLTIME;  break;
+            case RulePremise::DRAINTIME: type = TANK_DRAINTIME; break;
+            case RulePremise::FLOW:      type = LINK_FLOW;      break;
+            case RulePremise::STATUS:    type = LINK_STATUS;    break;
+            case RulePremise::SETTING:   type = LINK_SETTING;   break;
+            case RulePremise::TIME:      type = ELAPSED_TIME;   break;
+            case RulePremise::CLOCKTIME: type = CLOCK_TIME;     break;
+            }
+            if ( type == TANK_FILLTIME || type == TANK_DRAINTIME )
+            {
+                if ( !isTank ) index = -1;
+            }
+            premiseType.push_back(type);
+            premiseIndex.push_back(index);
+        }
+    }
+
+    // ... assign input ids so that inputs read from tanks come first
+
+    map<pair<int,int>, int> inputIds;
+    for (int pass = 0; pass < 2; pass++)
+    {
+        for (size_t i = 0; i < premiseType.size(); i++)
+        {
+            int type = premiseType[i];
+            bool tankInput = ( type == TANK_HEAD || type == TANK_FILLTIME ||
+                               type == TANK_DRAINTIME ) && premiseIndex[i] >= 0;
+            if ( tankInput != (pass == 0) ) continue;
+            pair<int,int> key(type, premiseIndex[i]);
+            if ( inputIds.count(key) == 0 )
+            {
+                inputIds[key] = addInput(type, premiseIndex[i]);
+            }
+        }
+        if ( pass == 0 ) tankInputCount = inputs.size();
+    }
+
+    // ... compile premises and actions
+
+    vector< vector<int> > rulesOfInput(inputs.size());
+    size_t k = 0;
+    for (int r = 0; r < ruleCount; r++)
+    {
+        Rule* rule = nw->rule(r);
+        bool hasTimePremise = false;
+        premiseBeg.push_back(premises.size());
+        for (RulePremise& p : rule->premises)
+        {
+            Premise premise;
+            premise.logic = p.logic;
+            premise.relation = p.relation;
+            premise.input = inputIds[make_pair(premiseType[k], premiseIndex[k])];
+            premise.value = p.value;
+            premise.tolerance = p.tolerance;
+            premises.push_back(premise);
+            k++;
+
+            if ( Rule::isTimePremise(p) ) hasTimePremise = true;
+            else
+            {
+                vector<int>& v = rulesOfInput[premise.input];
+                if ( v.empty() || v.back() != r ) v.push_back(r);
+            }
+        }
+        if ( hasTimePremise ) timeRules.push_back(r);
+
+        thenBeg.push_back(actions.size());
+        for (RuleAction& a : rule->thenActions)
+        {
+            actions.push_back({r, nw->indexOf(Element::LINK, a.link->name),
+                               a.status, a.setting});
+        }
+        elseBeg.push_back(actions.size());
+        for (RuleAction& a : rule->elseActions)
+        {
+            actions.push_back({r, nw->indexOf(Element::LINK, a.link->name),
+                               a.status, a.setting});
+        }
+        priority.push_back(rule->priority);
+    }
+    premiseBeg.push_back(premises.size());
+    thenBeg.push_back(actions.size());
+
+    // ... build the index from inputs to the rules that read them
+
+    for (vector<int>& v : rulesOfInput)
+    {
+        inputRuleBeg.push_back(inputRules.size());
+        inputRules.insert(inputRules.end(), v.begin(), v.end());
+    }
+    inputRuleBeg.push_back(inputRules.size());
+
+    ruleValue.assign(ruleCount, 0);
+    ruleDirty.assign(ruleCount, 0);
+    linkAction.assign(nw->count(Element::LINK), -1);
+}
+
+//-----------------------------------------------------------------------------
+
+//  Discard the compiled rules.
+
+void RuleEngine::close()
+{
+    ruleCount = 0;
+    tankInputCount = 0;
+    inputs.clear();
+    premises.clear();
+    actions.clear();
+    premiseBeg.clear();
+    thenBeg.clear();
+    elseBeg.clear();
+    priority.clear();
+    inputRuleBeg.clear();
+    inputRules.clear();
+    timeRules.clear();
+    ruleValue.clear();
+    ruleDirty.clear();
+    dirtyRules.clear();
+    linkAction.clear();
+    actedLinks.clear();
+    pendingActions.clear();
+}
+
+//-----------------------------------------------------------------------------
+
+//  Prepare the rules for a new simulation.
+
+void RuleEngine::init()
+{
+    for (Input& input : inputs) input.value = MISSING;
+    pendingActions.clear();
+    dirtyRules.clear();
+    for (int r = 0; r < ruleCount; r++)
+    {
+        ruleValue[r] = 0;
+        ruleDirty[r] = 1;
+        dirtyRules.push_back(r);
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+//  Find how much of a hydraulic time step can be taken before a rule changes
+//  the status or setting of a link.
+
+int RuleEngine::timeStep(int t, int tstep, int tStart)
+{
+    pendingActions.clear();
+    if ( ruleCount == 0 || tstep <= 0 ) return tstep;
+
+    // ... rules are checked at multiples of the rule time step
+
+    int dt = ruleStep > 0 ? ruleStep : tstep;
+    int dt1 = dt - (t % dt);
+    dt = min(dt, tstep);
+    dt1 = min(dt1, tstep);
+    if ( dt1 == 0 ) dt1 = dt;
+
+    // ... only tank inputs change after the first check since the
+    //     rest of the hydraulic solution is held fixed over the step
+
+    int elapsed = 0;
+    bool allInputs = true;
+    do
+    {
+        elapsed += dt1;
+        if ( checkRules(t, dt1, tStart, allInputs, elapsed) ) break;
+        allInputs = false;
+        dt = min(dt, tstep - elapsed);
+        dt1 = dt;
+    } while ( dt > 0 );
+    return elapsed;
+}
+
+//-----------------------------------------------------------------------------
+
+//  Apply the link changes called for by the last rule check.
+
+int RuleEngine::applyActions()
+{
+    int count = 0;
+    for (int i : pendingActions)
+    {
+        Action& a = actions[i];
+        Link* link = network->link(a.link);
+        string reason = link->typeStr() + " " + link->name;
+        string byRule = s_ByRule + network->rule(a.rule)->name;
+        bool changed;
+        if ( a.status >= 0 )
+        {
+            reason += s_StatusChanged + statusTxt[a.status] + byRule;
+            changed = link->changeStatus(a.status, true, reason, network->msgLog);
+        }
+        else
+        {
+            reason += s_SettingChanged + Utilities::to_string(a.setting) + byRule;
+            changed = link->changeSetting(a.setting, true, reason, network->msgLog);
+        }
+        if ( changed ) count++;
+    }
+    pendingActions.clear();
+    return count;
+}
+
+//-----------------------------------------------------------------------------
+
+//  Get or set the actions waiting to be applied at the next time step.
+
+void RuleEngine::getPendingActions(vector<int>& actionList)
+{
+    actionList = pendingActions;
+}
+
+void RuleEngine::setPendingActions(const vector<int>& actionList)
+{
+    pendingActions.clear();
+    for (int i : actionList)
+    {
+        if ( i >= 0 && i < (int)actions.size() ) pendingActions.push_back(i);
+    }
+
+    // ... cached rule values can't be trusted for the restored state
+    for (Input& input : inputs) input.value = MISSING;
+    dirtyRules.clear();
+    for (int r = 0; r < ruleCount; r++)
+    {
+        ruleDirty[r] = 1;
+        dirtyRules.push_back(r);
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+int RuleEngine::addInput(int type, int index)
+{
+    inputs.push_back({type, index, MISSING});
+    return inputs.size() - 1;
+}
+
+//-----------------------------------------------------------------------------
+
+//  Find the current value of an input, projecting tank levels forward
+//  by dt seconds.
+
+double RuleEngine::findInputValue(const Input& input, double dt)
+{
+    if ( input.index < 0 && input.type != SYSTEM_DEMAND ) return MISSING;
+    switch (input.type)
+    {
+    case NODE_HEAD:
+        return network->node(input.index)->head;
+
+    case NODE_DEMAND:
+        return network->node(input.index)->actualDemand;
+
+    case TANK_HEAD:
+    case TANK_FILLTIME:
+    case TANK_DRAINTIME:
+    {
+        Tank* tank = static_cast<Tank*>(network->node(input.index));
+        double v = tank->volume + tank->outflow * dt;
+        v = max(tank->minVolume, min(tank->maxVolume, v));
+        if ( input.type == TANK_HEAD ) return tank->findHead(v);
+        if ( input.type == TANK_FILLTIME )
+        {
+            if ( tank->outflow <= TINY ) return MISSING;
+            return (tank->maxVolume - v) / tank->outflow;
+        }
+        if ( tank->outflow >= -TINY ) return MISSING;
+        return (v - tank->minVolume) / -tank->outflow;
+    }
+
+    case LINK_FLOW:
+        return abs(network->link(input.index)->flow);
+
+    case LINK_STATUS:
+    {
+        int status = network->link(input.index)->status;
+        if ( status == Link::TEMP_CLOSED ) status = Link::LINK_CLOSED;
+        return status;
+    }
+
+    case LINK_SETTING:
+        return network->link(input.index)->getSetting(network);
+
+    case SYSTEM_DEMAND:
+    {
+        double demand = 0.0;
+        for (Node* node : network->nodes)
+        {
+            if ( node->type() == Node::JUNCTION ) demand += node->actualDemand;
+        }
+        return demand;
+    }
+    }
+    return MISSING;
+}
+
+//-----------------------------------------------------------------------------
+
+//  Refresh input values, marking the rules that read a changed input.
+
+void RuleEngine::updateInputs(bool allInputs, double dt)
+{
+    int n = allInputs ? inputs.size() : tankInputCount;
+    for (int i = 0; i < n; i++)
+    {
+        Input& input = inputs[i];
+        if ( input.type == ELAPSED_TIME || input.type == CLOCK_TIME ) continue;
+        double value = findInputValue(input, dt);
+        if ( value != input.value )
+        {
+            input.value = value;
+            markDirty(i);
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+void RuleEngine::markDirty(int input)
+{
+    for (int i = inputRuleBeg[input]; i < inputRuleBeg[input+1]; i++)
+    {
+        int r = inputRules[i];
+        if ( !ruleDirty[r] )
+        {
+            ruleDirty[r] = 1;
+            dirtyRules.push_back(r);
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+//  Evaluate a rule's premises over the check interval [t1, t2].
+
+bool RuleEngine::evalRule(int r, int t1, int t2, int tod1, int tod2)
+{
+    bool result = true;
+    for (int i = premiseBeg[r]; i < premiseBeg[r+1]; i++)
+    {
+        const Premise& p = premises[i];
+        if ( p.logic == RulePremise::OR )
+        {
+            if ( !result ) result = evalPremise(p, t1, t2, tod1, tod2);
+        }
+        else
+        {
+            if ( !result ) return false;
+            result = evalPremise(p, t1, t2, tod1, tod2);
+        }
+    }
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+
+bool RuleEngine::evalPremise(const Premise& p, int t1, int t2, int tod1, int tod2)
+{
+    const Input& input = inputs[p.input];
+
+    // ... a time premise tests for an equality anywhere in the interval
+
+    if ( input.type == ELAPSED_TIME || input.type == CLOCK_TIME )
+    {
+        if ( input.type == CLOCK_TIME )
+        {
+            t1 = tod1;
+            t2 = tod2;
+        }
+        int x = (int)p.value;
+        switch (p.relation)
+        {
+        case RulePremise::LT: return t2 < x;
+        case RulePremise::LE: return t2 <= x;
+        case RulePremise::GT: return t2 > x;
+        case RulePremise::GE: return t2 >= x;
+        default:
+        {
+            bool inInterval;
+            if ( t2 < t1 ) inInterval = ( x >= t1 || x <= t2 );
+            else           inInterval = ( x >= t1 && x <= t2 );
+            if ( p.relation == RulePremise::EQ ) return inInterval;
+            return !inInterval;
+        }
+        }
+    }
+
+    double x = input.value;
+    if ( x == MISSING ) return false;
+    switch (p.relation)
+    {
+    case RulePremise::EQ: return abs(x - p.value) <= p.tolerance;
+    case RulePremise::NE: return abs(x - p.value) >= p.tolerance;
+    case RulePremise::LT: return x <= p.value + p.tolerance;
+    case RulePremise::LE: return x <= p.value - p.tolerance;
+    case RulePremise::GT: return x >= p.value - p.tolerance;
+    case RulePremise::GE: return x >= p.value + p.tolerance;
+    }
+    return false;
+}
+
+//-----------------------------------------------------------------------------
+
+//  Check the rules at elapsed seconds into the current time step, where dt
+//  is the time since the previous check. Returns true if some rule calls for
+//  a change to a link.
+
+bool RuleEngine::checkRules(int t, int dt, int tStart, bool allInputs,
+                            int elapsed)
+{
+    int t2 = t + elapsed;
+    int t1 = t2 - dt + 1;
+    int tod1 = (t1 + tStart) % SECperDAY;
+    int tod2 = (t2 + tStart) % SECperDAY;
+
+    // ... re-evaluate only those rules whose inputs have changed
+
+    updateInputs(allInputs, elapsed);
+    for (int r : timeRules)
+    {
+        if ( !ruleDirty[r] )
+        {
+            ruleDirty[r] = 1;
+            dirtyRules.push_back(r);
+        }
+    }
+    for (int r : dirtyRules)
+    {
+        ruleValue[r] = evalRule(r, t1, t2, tod1, tod2);
+        ruleDirty[r] = 0;
+    }
+    dirtyRules.clear();
+
+    // ... choose the highest priority action on each link
+
+    for (int r = 0; r < ruleCount; r++)
+    {
+        int first = ruleValue[r] ? thenBeg[r] : elseBeg[r];
+        int last  = ruleValue[r] ? elseBeg[r] : thenBeg[r+1];
+        for (int i = first; i < last; i++)
+        {
+            int j = actions[i].link;
+            if ( linkAction[j] < 0 )
+            {
+                linkAction[j] = i;
+                actedLinks.push_back(j);
+            }
+            else if ( priority[r] > priority[actions[linkAction[j]].rule] )
+            {
+                linkAction[j] = i;
+            }
+        }
+    }
+
+    // ... keep those actions that would actually change their link
+
+    for (int j : actedLinks)
+    {
+        if ( canChangeLink(actions[linkAction[j]]) )
+        {
+            pendingActions.push_back(linkAction[j]);
+        }
+        linkAction[j] = -1;
+    }
+    actedLinks.clear();
+    return !pendingActions.empty();
+}
+
+//-----------------------------------------------------------------------------
+
+bool RuleEngine::canChangeLink(const Action& a)
+{
+    Link* link = network->link(a.link);
+    if ( a.status >= 0 )
+    {
+        return link->changeStatus(a.status, false, "", network->msgLog);
+    }
+    return link->changeSetting(a.setting, false, "", network->msgLog);
+}
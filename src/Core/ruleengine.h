@@ -0,0 +1,113 @@
+/* EPANET 3
+ *
+ * Copyright (c) 2016 Open Water Analytics
+ * Licensed under the terms of the MIT License (see the LICENSE file for details).
+ *
+ */
+
+//! \file ruleengine.h
+//! \brief Describes the RuleEngine class.
+
+#ifndef RULEENGINE_H_
+#define RULEENGINE_H_
+
+#include <vector>
+
+class Network;
+
+//! \class RuleEngine
+//! \brief Evaluates a network's rule-based controls.
+//!
+//! When opened, the RuleEngine compiles the network's rules into flat arrays
+//! of premises and actions. Each distinct node or link quantity read by a
+//! premise becomes an input, and an index from inputs to the rules that read
+//! them lets a rule be re-evaluated only when one of its inputs has changed
+//! (rules that test elapsed or clock time are evaluated at every check).
+//!
+//! Over each hydraulic time step the rules are checked at intervals of the
+//! RULE_STEP option using tank levels projected forward from the current
+//! hydraulic solution. If any rule calls for a change to a link's status or
+//! setting, the time step is cut short at that point and the change is held
+//! until the start of the next step. Conflicting actions on the same link
+//! are resolved in favor of the rule with the highest priority.
+
+class RuleEngine
+{
+  public:
+
+    RuleEngine();
+    ~RuleEngine();
+
+    void   open(Network* nw);
+    void   init();
+    void   close();
+    bool   hasRules() { return ruleCount > 0; }
+    int    timeStep(int t, int tstep, int tStart);
+    int    applyActions();
+
+    void   getPendingActions(std::vector<int>& actionList);
+    void   setPendingActions(const std::vector<int>& actionList);
+
+  private:
+
+    enum InputType {NODE_HEAD, NODE_DEMAND, TANK_HEAD, TANK_FILLTIME,
+                    TANK_DRAINTIME, LINK_FLOW, LINK_STATUS, LINK_SETTING,
+                    SYSTEM_DEMAND, ELAPSED_TIME, CLOCK_TIME};
+
+    struct Input                 //!< a quantity read by one or more premises
+    {
+        int    type;             //!< type of input (see InputType)
+        int    index;            //!< index of node or link read from
+        double value;            //!< value when rules were last evaluated
+    };
+
+    struct Premise               //!< a compiled rule premise
+    {
+        int    logic;            //!< IF, AND or OR
+        int    relation;         //!< relational operator
+        int    input;            //!< index of input tested
+        double value;            //!< value tested against
+        double tolerance;        //!< tolerance for equality tests
+    };
+
+    struct Action                //!< a compiled rule action
+    {
+        int    rule;             //!< index of rule taking the action
+        int    link;             //!< index of link acted on
+        int    status;           //!< new link status (-1 for a setting)
+        double setting;          //!< new link setting
+    };
+
+    Network*             network;
+    int                  ruleCount;      //!< number of rules
+    int                  ruleStep;       //!< time between rule checks (sec)
+    int                  tankInputCount; //!< number of inputs read from tanks
+
+    std::vector<Input>   inputs;         //!< tank inputs followed by others
+    std::vector<Premise> premises;       //!< premises of all rules
+    std::vector<Action>  actions;        //!< actions of all rules
+    std::vector<int>     premiseBeg;     //!< start of each rule's premises
+    std::vector<int>     thenBeg;        //!< start of each rule's THEN actions
+    std::vector<int>     elseBeg;        //!< start of each rule's ELSE actions
+    std::vector<double>  priority;       //!< priority of each rule
+    std::vector<int>     inputRuleBeg;   //!< start of each input's rule list
+    std::vector<int>     inputRules;     //!< rules that read each input
+    std::vector<int>     timeRules;      //!< rules that test the time
+    std::vector<char>    ruleValue;      //!< last truth value of each rule
+    std::vector<char>    ruleDirty;      //!< true if rule needs evaluation
+    std::vector<int>     dirtyRules;     //!< rules needing evaluation
+    std::vector<int>     linkAction;     //!< action chosen for each link
+    std::vector<int>     actedLinks;     //!< links with a chosen action
+    std::vector<int>     pendingActions; //!< actions to apply next time step
+
+    int    addInput(int type, int index);
+    double findInputValue(const Input& input, double dt);
+    void   updateInputs(bool allInputs, double dt);
+    void   markDirty(int input);
+    bool   evalRule(int r, int t1, int t2, int tod1, int tod2);
+    bool   evalPremise(const Premise& p, int t1, int t2, int tod1, int tod2);
+    bool   checkRules(int t, int dt, int tStart, bool allInputs, int elapsed);
+    bool   canChangeLink(const Action& a);
+};
+
+#endif
@@ -0,0 +1,413 @@
+/* EPANET 3
+ *
+ * Copyright (c) 2016 Open Water Analytics
+ * Licensed under the terms of the MIT License (see the LICENSE file for details).
+ *
+ */
+
+ ///////////////////////////////////////////////////
+ //  Implementation of the SourceTracker class.  //
+ ///////////////////////////////////////////////////
+
+#include "sourcetracker.h"
+#include "Core/network.h"
+#include "Core/constants.h"
+#include "Elements/node.h"
+#include "Elements/link.h"
+
+#include <algorithm>
+using namespace std;
+
+//  Smallest fraction of the target's water split among a node's inflows
+
+static const double MIN_SPLIT = 1.0e-3;
+
+//  Largest external inflow, relative to a junction's outflow, treated as
+//  flow balance error
+
+static const double BALANCE_TOL = 1.0e-4;
+
+//  Most steps a single query may take
+
+static const size_t MAX_STEPS = 1000000;
+
+//-----------------------------------------------------------------------------
+
+//  Constructor
+
+SourceTracker::SourceTracker() :
+    network(0),
+    nodeCount(0),
+    linkCount(0),
+    targetTime(0.0)
+{}
+
+//  Destructor
+
+SourceTracker::~SourceTracker()
+{}
+
+//-----------------------------------------------------------------------------
+
+//  Prepares to record the flow history of a network.
+
+void SourceTracker::open(Network* nw)
+{
+    network = nw;
+    nodeCount = nw->count(Element::NODE);
+    linkCount = nw->count(Element::LINK);
+
+    isJunction.resize(nodeCount);
+    for (int i = 0; i < nodeCount; i++)
+    {
+        isJunction[i] = nw->node(i)->type() == Node::JUNCTION;
+    }
+    startNode.resize(linkCount);
+    endNode.resize(linkCount);
+    volume.resize(linkCount);
+    for (int k = 0; k < linkCount; k++)
+    {
+        Link* link = nw->link(k);
+        startNode[k] = link->fromNode->index;
+        endNode[k] = link->toNode->index;
+        volume[k] = link->getVolume();
+    }
+
+    // ... list the links attached to each node
+    adjStart.assign(nodeCount + 1, 0);
+    for (int k = 0; k < linkCount; k++)
+    {
+        adjStart[startNode[k] + 1]++;
+        adjStart[endNode[k] + 1]++;
+    }
+    for (int i = 0; i < nodeCount; i++) adjStart[i+1] += adjStart[i];
+    adjLinks.resize(adjStart[nodeCount]);
+    vector<int> next(adjStart.begin(), adjStart.end() - 1);
+    for (int k = 0; k < linkCount; k++)
+    {
+        adjLinks[next[startNode[k]]++] = k;
+        adjLinks[next[endNode[k]]++] = k;
+    }
+
+    times.clear();
+    flows.clear();
+    sources.clear();
+}
+
+//-----------------------------------------------------------------------------
+
+void SourceTracker::close()
+{
+    network = 0;
+    times.clear();
+    flows.clear();
+    steps.clear();
+    parcels.clear();
+    sources.clear();
+}
+
+//-----------------------------------------------------------------------------
+
+//  Records the link flows found by a hydraulic solution at time t.
+
+void SourceTracker::record(int t)
+{
+    // ... the simulation may have been restarted or restored
+    truncate(t);
+
+    // ... a solution at the time of the last record replaces it
+    size_t n = times.size();
+    if ( n > 0 && times[n-1] == t )
+    {
+        times.pop_back();
+        flows.resize(flows.size() - linkCount);
+        n--;
+    }
+
+    // ... flows that haven't changed extend the last record
+    if ( n > 0 )
+    {
+        const float* last = &flows[(n-1) * linkCount];
+        int k = 0;
+        while ( k < linkCount && last[k] == (float)network->link(k)->flow ) k++;
+        if ( k == linkCount ) return;
+    }
+
+    times.push_back(t);
+    for (int k = 0; k < linkCount; k++)
+    {
+        flows.push_back((float)network->link(k)->flow);
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+//  Discards the flow records that begin after time t.
+
+void SourceTracker::truncate(int t)
+{
+    size_t n = times.size();
+    while ( n > 0 && times[n-1] > t ) n--;
+    times.resize(n);
+    flows.resize(n * linkCount);
+}
+
+//-----------------------------------------------------------------------------
+
+//  Traces the water at a node at time t (sec) back to its sources, going
+//  back no more than maxAge seconds (or to the start of the recorded
+//  history if maxAge <= 0). Returns the number of sources found.
+
+int SourceTracker::track(int node, int t, int maxAge)
+{
+    steps.clear();
+    parcels.clear();
+    sources.clear();
+    sourceOf.assign(nodeCount + 1, -1);
+    if ( times.empty() || t < times[0] ) return 0;
+
+    targetTime = t;
+    double tMin = times[0];
+    if ( maxAge > 0 ) tMin = max(tMin, (double)t - maxAge);
+
+    // ... release a parcel holding all of the node's water
+    Step first = {-1, -1};
+    steps.push_back(first);
+    Parcel p = {node, 0, (double)t, 1.0};
+    if ( network->node(node)->type() == Node::RESERVOIR ) addSource(node, 0, 1.0, 0.0);
+    else split(p, tMin);
+
+    // ... follow each parcel upstream until it reaches a source
+    while ( parcels.size() > 0 )
+    {
+        p = parcels.back();
+        parcels.pop_back();
+        if ( !isJunction[p.node] )
+        {
+            addSource(p.node, p.step, p.fraction, t - p.time);
+        }
+        else split(p, tMin);
+    }
+
+    // ... order the sources by the fraction of water they supply
+    sort(sources.begin(), sources.end(),
+         [](const Source& a, const Source& b) { return a.fraction > b.fraction; });
+    return (int)sources.size();
+}
+
+//-----------------------------------------------------------------------------
+
+//  Retrieves the node, fraction of the target's water and mean travel time
+//  (sec) of the i-th source found by the last query.
+
+void SourceTracker::getSource(int i, int* node, double* fraction, double* meanAge)
+{
+    Source& s = sources[i];
+    *node = s.node;
+    *fraction = s.fraction;
+    *meanAge = s.fraction > 0.0 ? s.ageSum / s.fraction : 0.0;
+}
+
+//-----------------------------------------------------------------------------
+
+//  Distributes the water from the i-th source over binCount travel time
+//  intervals of binWidth seconds each. Water older than the last interval
+//  is added to it.
+
+void SourceTracker::getArrivals(int i, int binWidth, int binCount, double* fractions)
+{
+    Source& s = sources[i];
+    for (int b = 0; b < binCount; b++) fractions[b] = 0.0;
+    for (size_t j = 0; j < s.ages.size(); j++)
+    {
+        int b = (int)(s.ages[j] / binWidth);
+        fractions[min(b, binCount - 1)] += s.weights[j];
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+//  Copies up to size links followed by the largest parcel from the i-th
+//  source, in order from the source to the target, into links. Returns
+//  the full number of links on the path.
+
+int SourceTracker::getPath(int i, int size, int* links)
+{
+    int count = 0;
+    for (int j = sources[i].bestStep; steps[j].parent >= 0; j = steps[j].parent)
+    {
+        if ( count < size ) links[count] = steps[j].link;
+        count++;
+    }
+    return count;
+}
+
+//-----------------------------------------------------------------------------
+
+//  Finds the flow record in effect just before time t.
+
+int SourceTracker::findRecord(double t)
+{
+    int r = (int)(lower_bound(times.begin(), times.end(), t) - times.begin()) - 1;
+    return max(r, 0);
+}
+
+//-----------------------------------------------------------------------------
+
+//  Moves a parcel at time t backwards through link k from the node it
+//  flows into until it leaves the link, updating t. Returns false if the
+//  parcel is still in the link at time tMin.
+
+bool SourceTracker::traverse(int k, int node, double& t, double tMin, int& exitNode)
+{
+    int n1 = startNode[k];
+    int n2 = endNode[k];
+
+    // ... pumps and valves are crossed instantly
+    double v = volume[k];
+    if ( v == 0.0 )
+    {
+        exitNode = (node == n2) ? n1 : n2;
+        return true;
+    }
+
+    // ... s is the volume between the parcel and the link's start node
+    double s = (node == n2) ? v : 0.0;
+    int r = findRecord(t);
+    while ( t > tMin )
+    {
+        double tStart = max((double)times[r], tMin);
+        double q = flows[r * linkCount + k];
+        double dt = t - tStart;
+
+        // ... going back in time, positive flow moves the parcel towards
+        //     the start node and negative flow towards the end node
+        if ( q > ZERO_FLOW )
+        {
+            if ( s <= q * dt )
+            {
+                t -= s / q;
+                exitNode = n1;
+                return true;
+            }
+            s -= q * dt;
+        }
+        else if ( q < -ZERO_FLOW )
+        {
+            if ( v - s <= -q * dt )
+            {
+                t -= (v - s) / -q;
+                exitNode = n2;
+                return true;
+            }
+            s -= q * dt;
+        }
+        t = tStart;
+        if ( r > 0 ) r--;
+    }
+    return false;
+}
+
+//-----------------------------------------------------------------------------
+
+//  Splits the water in a parcel at a node among the node's inflows at the
+//  parcel's time and moves each part upstream through its inflow link.
+
+void SourceTracker::split(const Parcel& p, double tMin)
+{
+    const float* q = &flows[findRecord(p.time) * linkCount];
+
+    // ... find the node's total inflow and outflow
+    double qIn = 0.0, qOut = 0.0, qMax = 0.0;
+    int kMax = -1;
+    for (int j = adjStart[p.node]; j < adjStart[p.node+1]; j++)
+    {
+        int k = adjLinks[j];
+        double qk = (endNode[k] == p.node) ? q[k] : -q[k];
+        if ( qk > ZERO_FLOW )
+        {
+            qIn += qk;
+            if ( qk > qMax )
+            {
+                qMax = qk;
+                kMax = k;
+            }
+        }
+        else if ( qk < -ZERO_FLOW ) qOut -= qk;
+    }
+
+    // ... a junction supplies any outflow its inflows don't account for
+    double qExt = 0.0;
+    if ( isJunction[p.node] && qOut - qIn > BALANCE_TOL * qOut ) qExt = qOut - qIn;
+    double qTotal = qIn + qExt;
+    double age = targetTime - p.time;
+
+    // ... water found where nothing flows in stays attributed to the node
+    if ( qTotal <= ZERO_FLOW || steps.size() >= MAX_STEPS )
+    {
+        addSource(p.node, p.step, p.fraction, age);
+        return;
+    }
+
+    // ... a small parcel only follows the node's largest inflow
+    bool splitting = p.fraction >= MIN_SPLIT;
+    if ( qExt > 0.0 && (splitting || qExt >= qMax) )
+    {
+        addSource(p.node, p.step, p.fraction * (splitting ? qExt / qTotal : 1.0), age);
+        if ( !splitting ) return;
+    }
+
+    for (int j = adjStart[p.node]; j < adjStart[p.node+1]; j++)
+    {
+        int k = adjLinks[j];
+        double qk = (endNode[k] == p.node) ? q[k] : -q[k];
+        if ( qk <= ZERO_FLOW ) continue;
+        if ( !splitting && k != kMax ) continue;
+        double f = p.fraction * (splitting ? qk / qTotal : 1.0);
+
+        // ... record the step taken through the link
+        int step = (int)steps.size();
+        Step s = {p.step, k};
+        steps.push_back(s);
+
+        double t = p.time;
+        int exitNode;
+        if ( traverse(k, p.node, t, tMin, exitNode) )
+        {
+            Parcel next = {exitNode, step, t, f};
+            parcels.push_back(next);
+        }
+        else addSource(-1, step, f, targetTime - t);
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+//  Adds a parcel that has reached a source node (or -1 if its source is
+//  unknown) after traveling for age seconds.
+
+void SourceTracker::addSource(int node, int step, double fraction, double age)
+{
+    int& i = sourceOf[node + 1];
+    if ( i < 0 )
+    {
+        i = (int)sources.size();
+        sources.push_back(Source());
+        Source& s = sources.back();
+        s.node = node;
+        s.fraction = 0.0;
+        s.ageSum = 0.0;
+        s.bestStep = step;
+        s.bestFraction = 0.0;
+    }
+    Source& s = sources[i];
+    s.fraction += fraction;
+    s.ageSum += fraction * age;
+    if ( fraction > s.bestFraction )
+    {
+        s.bestFraction = fraction;
+        s.bestStep = step;
+    }
+    s.ages.push_back(age);
+    s.weights.push_back(fraction);
+}
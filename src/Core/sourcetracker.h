@@ -0,0 +1,119 @@
+/* EPANET 3
+ *
+ * Copyright (c) 2016 Open Water Analytics
+ * Licensed under the terms of the MIT License (see the LICENSE file for details).
+ *
+ */
+
+//! \file sourcetracker.h
+//! \brief Describes the SourceTracker class.
+
+#ifndef SOURCETRACKER_H_
+#define SOURCETRACKER_H_
+
+#include <vector>
+
+class Network;
+
+//! \class SourceTracker
+//! \brief Traces the water found at a node back to where it came from.
+//!
+//! Once opened, the tracker records the network's link flows after each
+//! hydraulic solution, giving a piecewise constant flow history. A query
+//! releases a parcel of water at a target node and time and follows it
+//! backwards through that history. At a junction the parcel splits among
+//! the links flowing into it, and any external inflow, in proportion to
+//! their flows. In a pipe it moves upstream at the recorded flow rate (and
+//! back downstream while the flow is reversed), so the time it takes to
+//! leave a pipe is found from the pipe's volume and every flow change
+//! along the way. Pumps and valves are crossed instantly.
+//!
+//! A parcel's track ends at a reservoir, a tank, a junction with external
+//! inflow (its share of that inflow), or once it is older than the query's
+//! age limit or reaches the start of the recorded history. Water in the
+//! last group is attributed to no node (a source index of -1). Parcels
+//! carrying less than a small fraction of the target's water follow only
+//! their largest inflow, which bounds the work done by a query while still
+//! accounting for all of the water. A tank chosen as the target is traced
+//! through the links filling it at the query time.
+//!
+//! Each source found has the fraction of the target's water that came from
+//! it, the time each parcel took to arrive from it, and the sequence of
+//! links followed by its largest parcel.
+
+class SourceTracker
+{
+  public:
+
+    SourceTracker();
+    ~SourceTracker();
+
+    void   open(Network* nw);
+    void   close();
+    bool   isOpen() { return network != 0; }
+
+    void   record(int t);
+    void   truncate(int t);
+    int    track(int node, int t, int maxAge);
+    int    sourceCount() { return (int)sources.size(); }
+
+    void   getSource(int i, int* node, double* fraction, double* meanAge);
+    void   getArrivals(int i, int binWidth, int binCount, double* fractions);
+    int    getPath(int i, int size, int* links);
+
+  private:
+
+    // A parcel's arrival at a node or its end in a link
+    struct Step
+    {
+        int    parent;                     //!< step the parcel moved on to (or -1)
+        int    link;                       //!< link traveled to reach the parent
+    };
+
+    // A parcel waiting to be followed upstream of a node
+    struct Parcel
+    {
+        int    node;                       //!< node the parcel is at
+        int    step;                       //!< step recording its arrival
+        double time;                       //!< time it is at the node (sec)
+        double fraction;                   //!< fraction of target's water carried
+    };
+
+    // Water arriving at the target from one source
+    struct Source
+    {
+        int    node;                       //!< source node (or -1)
+        double fraction;                   //!< fraction of target's water
+        double ageSum;                     //!< fraction-weighted sum of ages
+        int    bestStep;                   //!< final step of largest parcel
+        double bestFraction;               //!< fraction carried by that parcel
+        std::vector<double> ages;          //!< age of each parcel (sec)
+        std::vector<double> weights;       //!< fraction carried by each parcel
+    };
+
+    Network*            network;           //!< network being analyzed
+    int                 nodeCount;         //!< number of network nodes
+    int                 linkCount;         //!< number of network links
+    std::vector<char>   isJunction;        //!< true if a node is a junction
+    std::vector<int>    startNode;         //!< index of each link's start node
+    std::vector<int>    endNode;           //!< index of each link's end node
+    std::vector<int>    adjStart;          //!< start of each node's links in adjLinks
+    std::vector<int>    adjLinks;          //!< links attached to each node
+    std::vector<double> volume;            //!< volume of each link (ft3)
+
+    std::vector<int>    times;             //!< time each flow record begins (sec)
+    std::vector<float>  flows;             //!< link flows of each record (cfs)
+
+    double              targetTime;        //!< time of the last query (sec)
+    std::vector<Step>   steps;             //!< steps taken by the last query
+    std::vector<Parcel> parcels;           //!< parcels still being followed
+    std::vector<Source> sources;           //!< sources found by the last query
+    std::vector<int>    sourceOf;          //!< position in sources of each node
+
+    int    findRecord(double t);
+    bool   traverse(int k, int node, double& t, double tMin, int& exitNode);
+    void   split(const Parcel& p, double tMin);
+    void   addSource(int node, int step, double fraction, double age);
+};
+
+#endif
@@ -0,0 +1,257 @@
+/* EPANET 3
+ *
+ * Copyright (c) 2016 Open Water Analytics
+ * Licensed under the terms of the MIT License (see the LICENSE file for details).
+ *
+ */
+
+#include "streamdriver.h"
+#include "Core/network.h"
+#include "Core/hydengine.h"
+#include "Core/error.h"
+#include "Elements/node.h"
+#include "Elements/link.h"
+#include "Utilities/utilities.h"
+
+#include <cstring>
+using namespace std;
+
+static const char* objectWords[] = {"TANK", "NODE", "LINK", 0};
+enum ObjectWord {TANK_WORD, NODE_WORD, LINK_WORD};
+
+static const char* statusWords[] = {"CLOSED", "OPEN", 0};
+
+//-----------------------------------------------------------------------------
+
+//  Constructor
+
+StreamDriver::StreamDriver() :
+    network(0),
+    hydEngine(0),
+    nodeCount(0),
+    linkCount(0)
+{}
+
+//  Destructor
+
+StreamDriver::~StreamDriver()
+{}
+
+//-----------------------------------------------------------------------------
+
+//  Prepares to publish up to capacity solutions for the network's
+//  hydraulic engine.
+
+void StreamDriver::open(Network* nw, HydEngine* engine, int capacity)
+{
+    network = nw;
+    hydEngine = engine;
+    nodeCount = nw->count(Element::NODE);
+    linkCount = nw->count(Element::LINK);
+    results.open(capacity, 2 * nodeCount + linkCount);
+}
+
+//-----------------------------------------------------------------------------
+
+void StreamDriver::close()
+{
+    if ( hydEngine ) hydEngine->clearBoundaries();
+    results.close();
+}
+
+//-----------------------------------------------------------------------------
+
+//  Imposes a measured value (in user units) on a tank, junction or link.
+
+void StreamDriver::setBoundary(int type, int index, double value)
+{
+    switch (type)
+    {
+    case HydEngine::TANK_LEVEL:
+    case HydEngine::NODE_DEMAND:
+    {
+        if ( index < 0 || index >= nodeCount )
+        {
+            throw InputError(InputError::UNDEFINED_OBJECT, Utilities::to_string(index));
+        }
+        Node* node = network->node(index);
+        if ( type == HydEngine::TANK_LEVEL )
+        {
+            if ( node->type() != Node::TANK )
+                throw InputError(InputError::UNDEFINED_OBJECT, node->name);
+            value /= network->ucf(Units::LENGTH);
+        }
+        else
+        {
+            if ( node->type() != Node::JUNCTION )
+                throw InputError(InputError::UNDEFINED_OBJECT, node->name);
+            value /= network->ucf(Units::FLOW);
+        }
+        break;
+    }
+
+    case HydEngine::LINK_STATUS:
+    case HydEngine::LINK_SETTING:
+    {
+        if ( index < 0 || index >= linkCount )
+        {
+            throw InputError(InputError::UNDEFINED_OBJECT, Utilities::to_string(index));
+        }
+        if ( type == HydEngine::LINK_STATUS )
+        {
+            value = (value == 0.0 ? Link::LINK_CLOSED : Link::LINK_OPEN);
+        }
+        else value = network->link(index)->convertSetting(network, value);
+        break;
+    }
+
+    default:
+        throw InputError(InputError::INVALID_KEYWORD, Utilities::to_string(type));
+    }
+    hydEngine->setBoundary(type, index, value);
+}
+
+//-----------------------------------------------------------------------------
+
+//  Re-solves hydraulics at time t (sec) from the current network state and
+//  publishes the solution.
+
+int StreamDriver::solve(int t)
+{
+    hydEngine->setTime(t);
+    int statusCode = hydEngine->solve(&t);
+    publish(t);
+    return statusCode;
+}
+
+//-----------------------------------------------------------------------------
+
+//  Applies the records read from a measurement feed, re-solving hydraulics
+//  after each batch. Returns the number of solutions published.
+
+int StreamDriver::run(istream& feed)
+{
+    string line;
+    vector<string> tokens;
+    int  solutions = 0;
+    int  batchTime = 0;
+    bool pending = false;
+
+    while ( getline(feed, line) )
+    {
+        // ... strip comments and split the record into tokens
+        size_t pos = line.find(';');
+        if ( pos != string::npos ) line.erase(pos);
+        tokens.clear();
+        Utilities::split(tokens, line);
+
+        // ... a blank line ends the current batch
+        if ( tokens.empty() )
+        {
+            if ( pending )
+            {
+                solve(batchTime);
+                solutions++;
+                pending = false;
+            }
+            continue;
+        }
+
+        // ... so does a record with a new time stamp
+        if ( tokens.size() < 4 ) throw InputError(InputError::TOO_FEW_ITEMS, line);
+        int t = Utilities::getSeconds(tokens[0], "");
+        if ( t < 0 ) throw InputError(InputError::INVALID_TIME, tokens[0]);
+        if ( pending && t != batchTime )
+        {
+            solve(batchTime);
+            solutions++;
+        }
+        batchTime = t;
+        applyRecord(tokens);
+        pending = true;
+    }
+
+    if ( pending )
+    {
+        solve(batchTime);
+        solutions++;
+    }
+    return solutions;
+}
+
+//-----------------------------------------------------------------------------
+
+//  Copies the earliest published solution newer than afterFrame into the
+//  node head, node demand and link flow arrays (any of which can be null).
+//  Returns the solution's frame number or 0 if there is no newer solution.
+
+long StreamDriver::readResults(long afterFrame, int* t, double* nodeHead,
+                               double* nodeDemand, double* linkFlow)
+{
+    if ( !results.isOpen() ) return 0;
+    vector<double> frame(results.frameSize());
+    long n = results.read(afterFrame, t, &frame[0]);
+    if ( n == 0 ) return 0;
+    size_t nodeBytes = nodeCount * sizeof(double);
+    if ( nodeHead ) memcpy(nodeHead, &frame[0], nodeBytes);
+    if ( nodeDemand ) memcpy(nodeDemand, &frame[nodeCount], nodeBytes);
+    if ( linkFlow ) memcpy(linkFlow, &frame[2*nodeCount], linkCount * sizeof(double));
+    return n;
+}
+
+//-----------------------------------------------------------------------------
+
+void StreamDriver::applyRecord(vector<string>& tokens)
+{
+    int objType = Utilities::findMatch(tokens[1], objectWords);
+    if ( objType < 0 ) throw InputError(InputError::INVALID_KEYWORD, tokens[1]);
+
+    // ... find the node or link being measured
+    int index;
+    if ( objType == LINK_WORD ) index = network->indexOf(Element::LINK, tokens[2]);
+    else index = network->indexOf(Element::NODE, tokens[2]);
+    if ( index < 0 ) throw InputError(InputError::UNDEFINED_OBJECT, tokens[2]);
+
+    // ... a link's value is either a status or a setting
+    int type;
+    double value;
+    int status = Utilities::findMatch(tokens[3], statusWords);
+    if ( objType == LINK_WORD && status >= 0 )
+    {
+        type = HydEngine::LINK_STATUS;
+        value = status;
+    }
+    else
+    {
+        if ( !Utilities::parseNumber(tokens[3], value) )
+        {
+            throw InputError(InputError::INVALID_NUMBER, tokens[3]);
+        }
+        if ( objType == TANK_WORD )      type = HydEngine::TANK_LEVEL;
+        else if ( objType == NODE_WORD ) type = HydEngine::NODE_DEMAND;
+        else                             type = HydEngine::LINK_SETTING;
+    }
+    setBoundary(type, index, value);
+}
+
+//-----------------------------------------------------------------------------
+
+//  Writes the current solution, in user units, to the results buffer.
+
+void StreamDriver::publish(int t)
+{
+    double lcf = network->ucf(Units::LENGTH);
+    double qcf = network->ucf(Units::FLOW);
+    double* frame = results.beginFrame();
+    for (int i = 0; i < nodeCount; i++)
+    {
+        Node* node = network->node(i);
+        frame[i] = node->head * lcf;
+        frame[nodeCount + i] = node->actualDemand * qcf;
+    }
+    for (int i = 0; i < linkCount; i++)
+    {
+        frame[2*nodeCount + i] = network->link(i)->flow * qcf;
+    }
+    results.publish(t);
+}
@@ -0,0 +1,75 @@
+/* EPANET 3
+ *
+ * Copyright (c) 2016 Open Water Analytics
+ * Licensed under the terms of the MIT License (see the LICENSE file for details).
+ *
+ */
+
+//! \file streamdriver.h
+//! \brief Describes the StreamDriver class.
+
+#ifndef STREAMDRIVER_H_
+#define STREAMDRIVER_H_
+
+#include "Utilities/ringbuffer.h"
+
+#include <string>
+#include <vector>
+#include <istream>
+
+class Network;
+class HydEngine;
+
+//! \class StreamDriver
+//! \brief Re-solves hydraulics in response to a stream of live measurements.
+//!
+//! In streaming mode the hydraulic engine is not stepped through an extended
+//! period simulation. Instead, measured tank levels, link statuses and
+//! settings, and junction demands are imposed on the network as boundary
+//! conditions and hydraulics are re-solved at the time of each batch of
+//! measurements, starting from the previous solution rather than from a
+//! re-initialized state. Each solution's node heads, node demands and link
+//! flows are published to a RingBuffer that other threads can read from
+//! without ever blocking the solver.
+//!
+//! A measurement feed is a text stream (a file, pipe or socket) with one
+//! record per line of the form:
+//!
+//!   time  TANK  id  level
+//!   time  NODE  id  demand
+//!   time  LINK  id  OPEN | CLOSED | setting
+//!
+//! in the project's units. Hydraulics are re-solved whenever the time
+//! changes from one record to the next, when a blank line is read, and
+//! at the end of the feed.
+
+class StreamDriver
+{
+  public:
+
+    StreamDriver();
+    ~StreamDriver();
+
+    void   open(Network* nw, HydEngine* engine, int capacity);
+    void   close();
+    bool   isOpen() { return results.isOpen(); }
+
+    void   setBoundary(int type, int index, double value);
+    int    solve(int t);
+    int    run(std::istream& feed);
+    long   readResults(long afterFrame, int* t, double* nodeHead,
+                       double* nodeDemand, double* linkFlow);
+
+  private:
+
+    Network*    network;       //!< network being analyzed
+    HydEngine*  hydEngine;     //!< engine that solves network hydraulics
+    RingBuffer  results;       //!< solutions published to consumers
+    int         nodeCount;     //!< number of network nodes
+    int         linkCount;     //!< number of network links
+
+    void        applyRecord(std::vector<std::string>& tokens);
+    void        publish(int t);
+};
+
+#endif
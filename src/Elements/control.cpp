@@ -13,6 +13,7 @@
 #include "Utilities/utilities.h"
 
 #include <cmath>
+#include <algorithm>
 #include <sstream>
 
 using namespace std;
@@ -88,9 +89,17 @@ void Control::convertUnits(Network* network)
 //-----------------------------------------------------------------------------
 
 int Control::timeToActivate(Network* network, int t, int tod)
+{
+    int aTime = timeToTrigger(t, tod);
+    if ( aTime > 0 && canActivate(network) ) return aTime;
+    else return -1;
+}
+
+//-----------------------------------------------------------------------------
+
+int Control::timeToTrigger(int t, int tod)
 {
     Tank* tank;
-    bool makeChange = false; //do not implement any control actions
     int  aTime = -1;
     switch (type)
     {
@@ -110,9 +119,31 @@ int Control::timeToActivate(Network* network, int t, int tod)
         else aTime = 86400 - tod + time;
         break;
     }
+    return aTime;
+}
 
-    if ( aTime > 0 && activate(makeChange, network->msgLog) ) return aTime;
-    else return -1;
+//-----------------------------------------------------------------------------
+
+bool Control::canActivate(Network* network)
+{
+    bool makeChange = false; //do not implement any control actions
+    return activate(makeChange, network->msgLog);
+}
+
+//-----------------------------------------------------------------------------
+
+void Control::indexPressureControls(Network* network)
+{
+    vector<Control*>& index = network->pressureControls;
+    index.clear();
+    for (Control* control : network->controls)
+    {
+        if ( control->type == PRESSURE_LEVEL ) index.push_back(control);
+    }
+
+    // ... group controls by trigger node, keeping input order within a group
+    stable_sort(index.begin(), index.end(),
+        [](Control* c1, Control* c2) { return c1->node->index < c2->node->index; });
 }
 
 //-----------------------------------------------------------------------------
@@ -121,22 +152,24 @@ bool Control::applyPressureControls(Network* network)
 {
     bool makeChange = true;
     bool changed = false;
+    Node* node = nullptr;
+    double h = 0.0;
 
-    for (Control* control : network->controls)
+    for (Control* control : network->pressureControls)
     {
-        if ( control->type == PRESSURE_LEVEL )
+        // ... controls are grouped by node so its head is fetched once
+        if ( control->node != node )
         {
-            if ( (control->levelType == LOW_LEVEL &&
-                  control->node->head < control->head)
-            ||   (control->levelType == HI_LEVEL &&
-                  control->node->head > control->head) )
-            {
-                if (control->activate(makeChange, network->msgLog))
-                    changed = true;
-            }
+            node = control->node;
+            h = node->head;
+        }
+        if ( (control->levelType == LOW_LEVEL && h < control->head)
+        ||   (control->levelType == HI_LEVEL && h > control->head) )
+        {
+            if (control->activate(makeChange, network->msgLog))
+                changed = true;
         }
     }
-
     return changed;
 }
 
@@ -40,6 +40,9 @@ class Control: public Element
     // return true if status of any link changes
     static  bool     applyPressureControls(Network* network);
 
+    // Builds the network's list of pressure controls ordered by trigger node
+    static  void     indexPressureControls(Network* network);
+
     // Sets the properties of a control
     void    setProperties(
                 int    controlType,
@@ -61,9 +64,19 @@ class Control: public Element
     int     getType()
             { return type; }
 
+    // Returns the node whose head triggers the control
+    Node*   getNode()
+            { return node; }
+
     // Finds the time until the control is next activated
     int    timeToActivate(Network* network, int t, int tod);
 
+    // Finds the time until the control's trigger condition is next met
+    int    timeToTrigger(int t, int tod);
+
+    // Checks if the control's action would change the state of its link
+    bool   canActivate(Network* network);
+
     // Checks if the control's conditions are met
     void    apply(Network* network, int t, int tod);
 
@@ -42,6 +42,7 @@ class Pattern: public Element
     // Methods
     void           setTimeInterval(int t) { interval = t; }
     void           addFactor(double f) { factors.push_back(f); }
+    void           setFactor(int i, double f) { factors[i] = f; }
     int            timeInterval() { return interval; }
     int            size() { return factors.size(); }
     double         factor(int i) { return factors[i]; }
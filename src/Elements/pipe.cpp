@@ -27,7 +27,10 @@ Pipe::Pipe(string name) :
     leakCoeff2(MISSING),
     bulkCoeff(MISSING),
     wallCoeff(MISSING),
-    massTransCoeff(0.0)
+    massTransCoeff(0.0),
+    reactFactor(-1.0),
+    reactFlow(0.0),
+    reactStep(0.0)
 {}
 
 Pipe::~Pipe() {}
@@ -65,6 +65,9 @@ class Pipe: public Link
     double bulkCoeff;        //!< bulk reaction coefficient (mass^n/sec)
     double wallCoeff;        //!< wall reaction coefficient (mass^n/sec)
     double massTransCoeff;   //!< mass transfer coefficient (mass^n/sec)
+    double reactFactor;      //!< first order decay factor over reactStep (or -1)
+    double reactFlow;        //!< flow rate reaction factors were found for (cfs)
+    double reactStep;        //!< time step reaction factors were found for (sec)
  };
 
 #endif
@@ -0,0 +1,133 @@
+/* EPANET 3
+ *
+ * Copyright (c) 2016 Open Water Analytics
+ * Licensed under the terms of the MIT License (see the LICENSE file for details).
+ *
+ */
+
+#include "rule.h"
+#include "node.h"
+#include "link.h"
+#include "Core/network.h"
+
+#include <sstream>
+using namespace std;
+
+//-----------------------------------------------------------------------------
+
+const char* Rule::ObjectWords[] = {"NODE", "LINK", "SYSTEM", 0};
+
+const char* Rule::VariableWords[] =
+    {"DEMAND", "HEAD", "GRADE", "LEVEL", "PRESSURE", "FILLTIME", "DRAINTIME",
+     "FLOW", "STATUS", "SETTING", "TIME", "CLOCKTIME", 0};
+
+const char* Rule::RelationWords[] = {"=", "<>", "<", "<=", ">", ">=", 0};
+
+const char* Rule::StatusWords[] = {"CLOSED", "OPEN", "ACTIVE", 0};
+
+static const char* logicWords[] = {"IF", "AND", "OR"};
+
+//-----------------------------------------------------------------------------
+
+Rule::Rule(string name_) :
+    Element(name_),
+    priority(0.0)
+{}
+
+Rule::~Rule() {}
+
+//-----------------------------------------------------------------------------
+
+void Rule::convertUnits(Network* network)
+{
+    double ucf = 1.0;
+    for (RulePremise& p : premises)
+    {
+        double offset = 0.0;
+        switch (p.variable)
+        {
+        case RulePremise::DEMAND:
+        case RulePremise::FLOW:
+            ucf = network->ucf(Units::FLOW);
+            break;
+
+        case RulePremise::HEAD:
+        case RulePremise::GRADE:
+            ucf = network->ucf(Units::LENGTH);
+            break;
+
+        // ... levels and pressures are compared as heads
+        case RulePremise::LEVEL:
+            ucf = network->ucf(Units::LENGTH);
+            offset = static_cast<Node*>(p.element)->elev;
+            break;
+
+        case RulePremise::PRESSURE:
+            ucf = network->ucf(Units::PRESSURE);
+            offset = static_cast<Node*>(p.element)->elev;
+            break;
+
+        // ... fill and drain times are given in hours
+        case RulePremise::FILLTIME:
+        case RulePremise::DRAINTIME:
+            ucf = 1.0 / 3600.0;
+            break;
+
+        // ... statuses, settings and times need no conversion
+        default:
+            ucf = 1.0;
+        }
+        p.value = p.value / ucf + offset;
+        p.tolerance = p.tolerance / ucf;
+    }
+
+    for (RuleAction& a : thenActions)
+    {
+        if ( a.status < 0 ) a.setting = a.link->convertSetting(network, a.setting);
+    }
+    for (RuleAction& a : elseActions)
+    {
+        if ( a.status < 0 ) a.setting = a.link->convertSetting(network, a.setting);
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+bool Rule::isTimePremise(const RulePremise& premise)
+{
+    return premise.variable == RulePremise::TIME ||
+           premise.variable == RulePremise::CLOCKTIME;
+}
+
+//-----------------------------------------------------------------------------
+
+string Rule::toStr(Network* network)
+{
+    stringstream s;
+    s << "RULE " << name << "\n";
+
+    // ... write each premise
+    for (RulePremise& p : premises)
+    {
+        s << logicWords[p.logic] << " " << ObjectWords[p.object] << " ";
+        if ( p.element ) s << p.element->name << " ";
+        s << VariableWords[p.variable] << " " << RelationWords[p.relation] <<
+             " " << p.valueStr << "\n";
+    }
+
+    // ... write each action
+    for (size_t i = 0; i < thenActions.size(); i++)
+    {
+        RuleAction& a = thenActions[i];
+        s << (i == 0 ? "THEN" : "AND") << " LINK " << a.link->name <<
+             (a.status < 0 ? " SETTING" : " STATUS") << " IS " << a.valueStr << "\n";
+    }
+    for (size_t i = 0; i < elseActions.size(); i++)
+    {
+        RuleAction& a = elseActions[i];
+        s << (i == 0 ? "ELSE" : "AND") << " LINK " << a.link->name <<
+             (a.status < 0 ? " SETTING" : " STATUS") << " IS " << a.valueStr << "\n";
+    }
+    if ( priority != 0.0 ) s << "PRIORITY " << priority << "\n";
+    return s.str();
+}
@@ -0,0 +1,87 @@
+/* EPANET 3
+ *
+ * Copyright (c) 2016 Open Water Analytics
+ * Licensed under the terms of the MIT License (see the LICENSE file for details).
+ *
+ */
+
+//! \file rule.h
+//! \brief Describes the Rule class.
+
+#ifndef RULE_H_
+#define RULE_H_
+
+#include "Elements/element.h"
+
+#include <string>
+#include <vector>
+
+class Link;
+class Network;
+
+//! \struct RulePremise
+//! \brief A condition in the IF part of a rule-based control.
+
+struct RulePremise
+{
+    enum Logic    {IF, AND, OR};
+    enum Object   {NODE, LINK, SYSTEM};
+    enum Variable {DEMAND, HEAD, GRADE, LEVEL, PRESSURE, FILLTIME, DRAINTIME,
+                   FLOW, STATUS, SETTING, TIME, CLOCKTIME};
+    enum Relation {EQ, NE, LT, LE, GT, GE};
+
+    int         logic;       //!< how premise is joined to preceding ones
+    int         object;      //!< type of object the premise refers to
+    Element*    element;     //!< node or link referred to (null for SYSTEM)
+    int         variable;    //!< variable being tested
+    int         relation;    //!< relational operator
+    double      value;       //!< value tested against (internal units)
+    double      tolerance;   //!< tolerance used to test for equality
+    std::string valueStr;    //!< value as it appears in the input file
+};
+
+//! \struct RuleAction
+//! \brief A link status or setting change in the THEN or ELSE part of a rule.
+
+struct RuleAction
+{
+    Link*       link;        //!< link being acted on
+    int         status;      //!< new link status (-1 if a setting change)
+    double      setting;     //!< new link setting (internal units)
+    std::string valueStr;    //!< status or setting as it appears in the input file
+};
+
+//! \class Rule
+//! \brief A rule-based control consisting of a set of premises, the actions
+//!        taken when they hold true, the actions taken when they don't, and
+//!        a priority used to resolve conflicting actions.
+
+class Rule: public Element
+{
+  public:
+
+    static const char* ObjectWords[];
+    static const char* VariableWords[];
+    static const char* RelationWords[];
+    static const char* StatusWords[];
+
+    // Constructor/Destructor
+    Rule(std::string name_);
+    ~Rule();
+
+    // Converts premise and action values to internal units
+    void        convertUnits(Network* network);
+
+    // Checks if a premise depends only on elapsed or clock time
+    static bool isTimePremise(const RulePremise& premise);
+
+    // Produces a string representation of the rule
+    std::string toStr(Network* network);
+
+    std::vector<RulePremise> premises;      //!< conditions tested by the rule
+    std::vector<RuleAction>  thenActions;   //!< actions when conditions are true
+    std::vector<RuleAction>  elseActions;   //!< actions when conditions are false
+    double                   priority;      //!< priority (higher value wins)
+};
+
+#endif
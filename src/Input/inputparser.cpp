@@ -5,9 +5,6 @@
  *
  */
 
- // TO DO:
- // - add support for Rule-Based controls
-
 #include "inputparser.h"
 #include "inputreader.h"
 #include "Core/network.h"
@@ -24,11 +21,16 @@ using namespace std;
 //  Input File Keywords
 //-----------------------------------------------------------------------------
 static const char* w_Pump = "PUMP";
-//static const char* w_Rule = "RULE";
+static const char* w_Rule = "RULE";
 static const char* w_Variable = "VARIABLE";
 static const char* w_Bulk = "BULK";
 static const char* w_Wall = "WALL";
 static const char* w_Tank = "TANK";
+static const char* w_Species = "SPECIES";
+static const char* w_Reaction = "REACTION";
+static const char* w_Quality = "QUALITY";
+static const char* w_Trace = "TRACE";
+static const char* w_Inject = "INJECT";
 
 //-----------------------------------------------------------------------------
 
@@ -191,24 +193,44 @@ void ObjectParser::parseLine(string& line, int section)
         }
         break;
 
-/*
     case InputReader::RULE:
         // Check for Rule keyword
-        if (Utilities::match(s1, w_Rule))
+        if ( Utilities::upperCase(s1) == w_Rule )
         {
             // Parse rule's name
-            sin >> s2;
-            if (sin.fail()) return InputError::TOO_FEW_ITEMS;
+            istringstream sin(line);
+            sin >> s1 >> s2;
+            if ( sin.fail() ) throw InputError(InputError::TOO_FEW_ITEMS, "");
 
             // Check if rule with same name already exists
-            if (network->indexOf(Element::CONTROL, s2) >= 0)
-                return InputError::DUPLICATE_ID;
+            if ( network->indexOf(Element::RULE, s2) >= 0 )
+            {
+                throw InputError(InputError::DUPLICATE_ID, s2);
+            }
 
             // Add new rule
-            network->addElement(Element::CONTROL, s2);
+            if ( !network->addElement(Element::RULE, 0, s2) )
+            {
+                throw InputError(InputError::CANNOT_CREATE_OBJECT, s2);
+            }
+        }
+        break;
+
+    case InputReader::SPECIES:
+        // Check for Species keyword
+        if ( Utilities::match(s1, w_Species) )
+        {
+            // Parse species name & units
+            istringstream sin(line);
+            string s3;
+            sin >> s1 >> s2 >> s3;
+            if ( sin.fail() ) throw InputError(InputError::TOO_FEW_ITEMS, "");
+            if ( network->speciesModel.addSpecies(s2, s3) < 0 )
+            {
+                throw InputError(InputError::DUPLICATE_ID, s2);
+            }
         }
         break;
-*/
     }
 }
 
@@ -244,6 +266,14 @@ void PropertyParser::parseLine(string& line, int section)
 	    return;
     }
 
+    // ... for Rules, apply special rule parser
+
+    if ( section == InputReader::RULE )
+    {
+        ruleParser.parseRuleLine(line, network);
+        return;
+    }
+
     // ... split the input line into an array of string tokens
 
     tokens.clear();
@@ -281,10 +311,6 @@ void PropertyParser::parseLine(string& line, int section)
             curveParser.parseCurveData(network->curve(id), tokens);
 	        break;
 
-        // Rules
-        case InputReader::RULE:
-            break;
-
         // Node properties
         case InputReader::EMITTER:
         case InputReader::DEMAND:
@@ -329,6 +355,11 @@ void PropertyParser::parseLine(string& line, int section)
         case InputReader::REPORT:
             optionParser.parseReportOption(network, tokens);
             break;
+
+        // Extra water quality species
+        case InputReader::SPECIES:
+            parseSpeciesProperty(id);
+            break;
     }
 }
 
@@ -405,3 +436,105 @@ void PropertyParser::parseReactProperty(string& reactType)
     }
     else optionParser.parseReactOption(network, tokens);
 }
+
+//-----------------------------------------------------------------------------
+
+//  Read a species reaction term or node value from an input stream
+//  (species themselves are added by the ObjectParser)
+
+void PropertyParser::parseSpeciesProperty(string& keyword)
+{
+    SpeciesModel& species = network->speciesModel;
+    if ( Utilities::match(keyword, w_Species) ) return;
+
+    // ... REACTION target rate [species1 [species2]]
+    if ( Utilities::match(keyword, w_Reaction) )
+    {
+        if ( tokens.size() < 3 ) throw InputError(InputError::TOO_FEW_ITEMS, "");
+        if ( tokens.size() > 5 ) throw InputError(InputError::INVALID_KEYWORD, tokens[5]);
+        int s[3] = {-1, -1, -1};
+        for (size_t i = 1; i < tokens.size(); i++)
+        {
+            if ( i == 2 ) continue;
+            int j = species.indexOf(tokens[i]);
+            if ( j < 0 ) throw InputError(InputError::UNDEFINED_OBJECT, tokens[i]);
+            s[i == 1 ? 0 : i - 2] = j;
+        }
+        double rate;
+        if ( !Utilities::parseNumber(tokens[2], rate) )
+        {
+            throw InputError(InputError::INVALID_NUMBER, tokens[2]);
+        }
+        species.addReaction(s[0], rate, s[1], s[2]);
+    }
+
+    // ... QUALITY nodeID species value
+    else if ( Utilities::match(keyword, w_Quality) )
+    {
+        if ( tokens.size() < 4 ) throw InputError(InputError::TOO_FEW_ITEMS, "");
+        int node = network->indexOf(Element::NODE, tokens[1]);
+        if ( node < 0 ) throw InputError(InputError::UNDEFINED_OBJECT, tokens[1]);
+        int j = species.indexOf(tokens[2]);
+        if ( j < 0 ) throw InputError(InputError::UNDEFINED_OBJECT, tokens[2]);
+        double value;
+        if ( !Utilities::parseNumber(tokens[3], value) || value < 0.0 )
+        {
+            throw InputError(InputError::INVALID_NUMBER, tokens[3]);
+        }
+        species.setNodeValue(node, j, value);
+    }
+
+    // ... TRACE nodeID
+    else if ( Utilities::match(keyword, w_Trace) )
+    {
+        if ( tokens.size() < 2 ) throw InputError(InputError::TOO_FEW_ITEMS, "");
+        int node = network->indexOf(Element::NODE, tokens[1]);
+        if ( node < 0 ) throw InputError(InputError::UNDEFINED_OBJECT, tokens[1]);
+        if ( species.addTrace(node, tokens[1]) < 0 )
+        {
+            throw InputError(InputError::DUPLICATE_ID, tokens[1]);
+        }
+    }
+
+    // ... INJECT nodeID|* value [rate [start [duration]]]
+    else if ( Utilities::match(keyword, w_Inject) )
+    {
+        if ( tokens.size() < 3 ) throw InputError(InputError::TOO_FEW_ITEMS, "");
+        if ( tokens.size() > 6 ) throw InputError(InputError::INVALID_KEYWORD, tokens[6]);
+        double value, rate = 0.0;
+        if ( !Utilities::parseNumber(tokens[2], value) || value < 0.0 )
+        {
+            throw InputError(InputError::INVALID_NUMBER, tokens[2]);
+        }
+        if ( tokens.size() > 3 && !Utilities::parseNumber(tokens[3], rate) )
+        {
+            throw InputError(InputError::INVALID_NUMBER, tokens[3]);
+        }
+        int times[2] = {0, 0};
+        for (size_t i = 4; i < tokens.size(); i++)
+        {
+            times[i-4] = Utilities::getSeconds(tokens[i], "");
+            if ( times[i-4] < 0 ) throw InputError(InputError::INVALID_TIME, tokens[i]);
+        }
+
+        // ... a * injects at every junction
+        int first = network->indexOf(Element::NODE, tokens[1]);
+        int last = first;
+        if ( tokens[1] == "*" )
+        {
+            first = 0;
+            last = network->count(Element::NODE) - 1;
+        }
+        else if ( first < 0 ) throw InputError(InputError::UNDEFINED_OBJECT, tokens[1]);
+        for (int i = first; i <= last; i++)
+        {
+            Node* node = network->node(i);
+            if ( tokens[1] == "*" && node->type() != Node::JUNCTION ) continue;
+            if ( species.addInjection(i, node->name, value, rate, times[0], times[1]) < 0 )
+            {
+                throw InputError(InputError::DUPLICATE_ID, node->name);
+            }
+        }
+    }
+    else throw InputError(InputError::INVALID_KEYWORD, keyword);
+}
@@ -12,11 +12,15 @@
 #include "Utilities/utilities.h"
 
 #include <fstream>
+#include <cstring>
+#include <cctype>
+#include <algorithm>
 using namespace std;
 
 //-----------------------------------------------------------------------------
 
 static const int    MAXERRS = 10;             // maximum number of input errors allowed
+static const size_t MINPARALLEL = 1000;       // fewest lines worth parsing in parallel
 static const string WHITESPACE = " \t\n\r";   // whitespace characters
 
 //-----------------------------------------------------------------------------
@@ -32,7 +36,8 @@ const char* sections[]  =
     "[ENERGY",          "[QUALITY",         "[SOURCE",          "[REACTION",
     "[MIXING",          "[OPTION",          "[TIME",            "[REPORT",
     "[COORD",           "[VERTICES",        "[LABEL",           "[MAP",
-    "[BACKDROP",        "[TAG",             "[END",             0
+    "[BACKDROP",        "[TAG",             "[SPECIES",         "[END",
+    0
 };
 
 //-----------------------------------------------------------------------------
@@ -52,126 +57,278 @@ InputReader::InputReader(): errcount(0), section(-1)
 
 void InputReader::readFile(const char* inpFile, Network* network)
 {
-    // ... initialize current input section
+    // ... read the file into memory and index its lines
 
-    section = -1;
+    readText(inpFile);
+    scanText(network);
+
+    // ... parse object names from the file
+
+    ObjectParser objectParser(network);
+    parseFile(objectParser);
+
+    // ... parse object properties from the file, using more than one
+    //     thread for large files
+
+    if ( lines.size() >= MINPARALLEL ) threadPool.open(0);
+    parseProperties(network);
+    threadPool.close();
+}
 
-    // ... open the input file
+//-----------------------------------------------------------------------------
+
+//  Read the entire contents of the input file into memory.
 
-    ifstream fin(inpFile, ios::in);
+void InputReader::readText(const char* inpFile)
+{
+    ifstream fin(inpFile, ios::in | ios::binary);
     if (!fin.is_open()) throw FileError(FileError::CANNOT_OPEN_INPUT_FILE);
-    try
+    fin.seekg(0, ios::end);
+    streamoff size = fin.tellg();
+    fin.seekg(0, ios::beg);
+    text.assign(size > 0 ? (size_t)size : 0, '\0');
+    if ( size > 0 ) fin.read(&text[0], size);
+    text.resize((size_t)fin.gcount());
+    fin.close();
+}
+
+//-----------------------------------------------------------------------------
+
+//  Index each non-blank line of the input file's text and reserve room
+//  in the network for the nodes and links it describes.
+
+void InputReader::scanText(Network* network)
+{
+    const char* s = text.c_str();
+    size_t n = text.size();
+    size_t pos = 0;
+    int nodeLines = 0;
+    int linkLines = 0;
+    section = -1;
+    lines.clear();
+
+    while ( pos < n )
     {
-        // ... parse object names from the file
+        // ... find the end of the line and of any data before a comment
 
-        ObjectParser objectParser(network);
-        parseFile(fin, objectParser);
+        const char* eol = (const char*)memchr(s + pos, '\n', n - pos);
+        size_t end = eol ? eol - s : n;
+        const char* semi = (const char*)memchr(s + pos, ';', end - pos);
+        size_t last = semi ? semi - s : end;
 
-        // ... parse object properties from the file
+        // ... trim any trailing whitespace
 
-        PropertyParser propertyParser(network);
-        parseFile(fin, propertyParser);
-        fin.close();
-    }
+        while ( last > pos && WHITESPACE.find(s[last-1]) != string::npos ) last--;
 
-    // ... catch and re-throw any exception thrown by the parsing process
+        // ... skip blank lines
 
-    catch (...)
-    {
-        fin.close();
-        throw;
+        size_t first = pos;
+        while ( first < last && isspace((unsigned char)s[first]) ) first++;
+        if ( first < last )
+        {
+            Line l = { pos, (int)(last - pos), s[first] == '[' };
+            lines.push_back(l);
+
+            // ... keep track of the section for counting nodes and links
+
+            if ( l.isHeader )
+            {
+                size_t i = first;
+                while ( i < last && !isspace((unsigned char)s[i]) ) i++;
+                token.assign(s + first, i - first);
+                int newSection = Utilities::findMatch(token, sections);
+                if ( newSection >= 0 ) section = newSection;
+            }
+            else if ( section >= JUNCTION && section <= TANK ) nodeLines++;
+            else if ( section >= PIPE && section <= VALVE ) linkLines++;
+        }
+        pos = end + 1;
     }
+    network->reserve(Element::NODE, nodeLines);
+    network->reserve(Element::LINK, linkLines);
 }
 
 //-----------------------------------------------------------------------------
 
-//  Read and parse each line of the input file.
+//  Parse each line of the input file.
 
-void InputReader::parseFile(istream& fin, InputParser& parser)
+void InputReader::parseFile(InputParser& parser)
 {
-    string line;
-    string token;
+    section = -1;
+    for (const Line& l : lines)
+    {
+        if ( errcount >= MAXERRS ) break;
+        parseLine(parser, l);
+    }
 
-    // ... reset input file
+    // ... throw general input file exception if errors were found
 
-    fin.clear();
-    fin.seekg(0);
-    section = -1;
+    if ( errcount > 0 ) throw InputError(InputError::ERRORS_IN_INPUT_DATA, "");
+}
+
+//-----------------------------------------------------------------------------
 
-    // ... read each line from input file
+//  Parse the properties of each object in the input file, parsing long
+//  runs of lines in sections that describe one element per line in
+//  parallel.
 
-    for (;;)
+void InputReader::parseProperties(Network* network)
+{
+    PropertyParser parser(network);
+    section = -1;
+    size_t i = 0;
+    while ( i < lines.size() && errcount < MAXERRS )
     {
-        if ( errcount >= MAXERRS ) break;
-        getline(fin, line, '\n');
-        if (fin.fail())
+        if ( lines[i].isHeader )
         {
-            if ( fin.eof() ) break;    // end of file reached - normal termination
+            parseLine(parser, lines[i]);
+            i++;
+            continue;
         }
 
-        // ... remove any comment from input line
+        // ... find the run of data lines that ends at the next section header
 
-        trimLine(line);
+        size_t last = i;
+        while ( last < lines.size() && !lines[last].isHeader ) last++;
 
-        // ... read 1st token from input line
+        if ( threadPool.size() > 1 && last - i >= MINPARALLEL &&
+             ( section == JUNCTION || section == PIPE || section == DEMAND ||
+               section == PATTERN || section == COORD ) )
+        {
+            parseInParallel(network, i, last);
+        }
+        else for (size_t j = i; j < last && errcount < MAXERRS; j++)
+        {
+            parseLine(parser, lines[j]);
+        }
+        i = last;
+    }
 
-        sin.clear();                   // clear string stream status flags
-        sin.str(line);                 // assign input line to string stream
-        sin >> token;                  // read 1st token from string stream
+    // ... throw general input file exception if errors were found
 
-        // ... skip blank lines
+    if ( errcount > 0 ) throw InputError(InputError::ERRORS_IN_INPUT_DATA, "");
+}
 
-        if ( sin.fail() || token[0] == '\0' ) continue;
-        try
-        {
-            // ... see if at start of new input section
+//-----------------------------------------------------------------------------
 
-            if ( token[0] == '[' ) findSection(token);
+//  Parse lines first to last-1 of the current section on the threads of
+//  the thread pool.
 
-            // ... otherwise parse input line of data
+void InputReader::parseInParallel(Network* network, size_t first, size_t last)
+{
+    int taskCount = threadPool.size();
+    vector< vector<LineError> > taskErrors(taskCount);
 
-            else parser.parseLine(line, section);
-        }
-        catch (InputError& e)
+    threadPool.run(taskCount, [&](int k)
+    {
+        PropertyParser parser(network);
+        string taskLine;
+        for (size_t i = first; i < last; i++)
         {
-            errcount++;
-            if ( section >= 0 )
+            // ... a line is parsed by the task its element's ID hashes to,
+            //     so that all lines for an element are parsed in order
+
+            const char* s = text.c_str() + lines[i].start;
+            const char* end = s + lines[i].length;
+            while ( s < end && (*s == ' ' || *s == '\t') ) s++;
+            unsigned hash = 2166136261u;
+            while ( s < end && *s != ' ' && *s != '\t' )
             {
-                parser.network->msgLog << e.msg << " at following line of " <<
-                    sections[section] << "] section:\n";
+                hash = (hash ^ (unsigned char)*s++) * 16777619u;
             }
-            else
+            if ( (int)(hash % taskCount) != k ) continue;
+
+            taskLine.assign(text, lines[i].start, lines[i].length);
+            try
             {
-                parser.network->msgLog << e.msg << " at following line of file:\n";
+                parser.parseLine(taskLine, section);
+            }
+            catch (InputError& e)
+            {
+                LineError err = { i, true, e.msg };
+                taskErrors[k].push_back(err);
+            }
+            catch (...)
+            {
+                LineError err = { i, false, "" };
+                taskErrors[k].push_back(err);
             }
-            parser.network->msgLog << line << "\n";
         }
-        catch (...)
+    });
+
+    // ... report errors in the order their lines appear in the file
+
+    vector<LineError> errors;
+    for (vector<LineError>& e : taskErrors)
+    {
+        errors.insert(errors.end(), e.begin(), e.end());
+    }
+    sort(errors.begin(), errors.end(),
+        [](const LineError& a, const LineError& b) { return a.index < b.index; });
+    for (LineError& err : errors)
+    {
+        if ( errcount >= MAXERRS ) break;
+        if ( err.isInputError )
         {
-            errcount++;
+            line.assign(text, lines[err.index].start, lines[err.index].length);
+            logError(network, err.msg);
         }
+        else errcount++;
     }
-
-    // ... throw general input file exception if errors were found
-
-    if ( errcount > 0 ) throw InputError(InputError::ERRORS_IN_INPUT_DATA, "");
 }
 
 //-----------------------------------------------------------------------------
 
-//  Trim a comment from a line of text.
+//  Parse a single line of the input file.
 
-void InputReader::trimLine(string& line)
+void InputReader::parseLine(InputParser& parser, const Line& l)
 {
-    // ... skip any characters following a ';'
+    line.assign(text, l.start, l.length);
+    try
+    {
+        // ... see if at start of new input section
+
+        if ( l.isHeader )
+        {
+            size_t first = line.find_first_not_of(" \t\n\v\f\r");
+            size_t last = line.find_first_of(" \t\n\v\f\r", first);
+            if ( last == string::npos ) last = line.size();
+            token.assign(line, first, last - first);
+            findSection(token);
+        }
+
+        // ... otherwise parse input line of data
+
+        else parser.parseLine(line, section);
+    }
+    catch (InputError& e)
+    {
+        logError(parser.network, e.msg);
+    }
+    catch (...)
+    {
+        errcount++;
+    }
+}
 
-    size_t pos = line.find(";");
-    if (pos != string::npos) line.erase(pos);
+//-----------------------------------------------------------------------------
 
-    // ... trim any trailing whitespace
+//  Write an error message and the line of input that caused it to the
+//  network's message log.
 
-    pos = line.find_last_not_of(WHITESPACE);
-    if (pos != string::npos) line.erase(pos + 1);
+void InputReader::logError(Network* network, const string& msg)
+{
+    errcount++;
+    if ( section >= 0 )
+    {
+        network->msgLog << msg << " at following line of " <<
+            sections[section] << "] section:\n";
+    }
+    else
+    {
+        network->msgLog << msg << " at following line of file:\n";
+    }
+    network->msgLog << line << "\n";
 }
 
 //-----------------------------------------------------------------------------
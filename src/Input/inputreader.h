@@ -11,8 +11,10 @@
 #ifndef INPUTREADER_H_
 #define INPUTREADER_H_
 
-#include <iostream>
-#include <sstream>
+#include "Utilities/threadpool.h"
+
+#include <string>
+#include <vector>
 
 class Network;
 class InputParser;
@@ -25,6 +27,20 @@ class InputParser;
 //! in the network and then using the PropertyParser to read the properties
 //! assigned to each of these elements. This two-pass approach allows the
 //! description of the elements to appear in any order in the file.
+//!
+//! The file is read into memory all at once and scanned a single time to
+//! find where each of its non-blank lines begins and ends (less any
+//! comment) and which section it belongs to. Both passes then work from
+//! this index of lines rather than re-reading the file, and the number of
+//! lines in the node and link sections is used to size the network's
+//! element lists and ID tables before any element is created.
+//!
+//! In the property pass, a long run of lines in the [JUNCTIONS], [PIPES],
+//! [DEMANDS], [PATTERNS] or [COORDINATES] sections is shared out among a
+//! pool of threads. A line in these sections only changes the element
+//! it names, so all lines naming the same element go to the same thread,
+//! which parses them in file order. Errors are written to the message log
+//! in the order their lines appear in the file, just as in a serial pass.
 
 class InputReader
 {
@@ -38,7 +54,7 @@ class InputReader
         ENERGY,             QUALITY,            SOURCE,             REACTION,
         MIXING,             OPTION,             TIME,               REPORT,
         COORD,              VERTICES,           LABEL,              MAP,
-        BACKDROP,           TAG,                END
+        BACKDROP,           TAG,                SPECIES,            END
     };
 
     InputReader();
@@ -48,12 +64,37 @@ class InputReader
 
   protected:
 
-    std::istringstream sin;         //!< string stream containing a line of input
+    // A non-blank line of the input file
+    struct Line
+    {
+        size_t start;               //!< position of the line in the file's text
+        int    length;              //!< length without any comment or trailing blanks
+        bool   isHeader;            //!< true if the line starts a new section
+    };
+
+    // An error found when parsing a line on a separate thread
+    struct LineError
+    {
+        size_t      index;          //!< index of the line in the list of lines
+        bool        isInputError;   //!< false if not an InputError
+        std::string msg;            //!< error message
+    };
+
+    std::string        text;        //!< contents of the input file
+    std::vector<Line>  lines;       //!< non-blank lines of the file
+    std::string        line;        //!< line of input being parsed
+    std::string        token;       //!< first token of the line
     int                errcount;    //!< error count
     int                section;     //!< file section being processed
+    ThreadPool         threadPool;  //!< threads that parse large sections
 
-    void parseFile(std::istream& fin, InputParser& parser);
-    void trimLine(std::string& line);
+    void readText(const char* inpFile);
+    void scanText(Network* network);
+    void parseFile(InputParser& parser);
+    void parseProperties(Network* network);
+    void parseInParallel(Network* network, size_t first, size_t last);
+    void parseLine(InputParser& parser, const Line& l);
+    void logError(Network* network, const std::string& msg);
     void findSection(std::string& token);
 };
 
@@ -23,7 +23,7 @@ static const char* stringOptionKeywords[] =
      "", "", // placeholders for file names
      "MAP_FILE", "HEADLOSS_MODEL", "DEMAND_MODEL", "LEAKAGE_MODEL",
      "HYDRAULIC_SOLVER", "STEP_SIZING", "MATRIX_SOLVER", "",
-     "QUALITY_MODEL", "QUALITY_NAME", "QUALITY_UNITS", 0};
+     "QUALITY_MODEL", "QUALITY_NAME", "QUALITY_UNITS", "", "QUALITY_SOLVER", 0};
 
 // ... Keywords for IndexOption enumeration in options.h
 static const char* indexOptionKeywords[] =
@@ -34,7 +34,8 @@ static const char* indexOptionKeywords[] =
      "",  // placeholder for ENERGY_PRICE_PATTERN
      "",  // placeholder for QUAL_TYPE
      "",  // placeholder for QUAL_UNITS
-     "TRACE_NODE", 0};
+     "TRACE_NODE", "THREADS", "MAXIMUM_SEGMENTS", "TOTAL_SEGMENTS",
+     "PIPE_CELLS", 0};
 
 // ... Keywords for reporting options portion of IndexOption enumeration
 static const char* reportOptionKeywords[] =
@@ -46,8 +47,10 @@ static const char* valueOptionKeywords[] =
      "MINIMUM_PRESSURE", "SERVICE_PRESSURE", "PRESSURE_EXPONENT",
 	 "EMITTER_EXPONENT", "LEAKAGE_COEFF1", "LEAKAGE_COEFF2",
 	 "RELATIVE_ACCURACY", "HEAD_TOLERANCE", "FLOW_TOLERANCE",
-	 "FLOW_CHANGE_LIMIT", "TIME_WEIGHT", "SPECIFIC_DIFFUSIVITY",
-	 "QUALITY_TOLERANCE", 0};
+	 "FLOW_CHANGE_LIMIT", "TIME_WEIGHT", "CYCLE_TOLERANCE",
+	 "TANK_TOLERANCE", "SPECIFIC_DIFFUSIVITY", "QUALITY_TOLERANCE",
+	 "COURANT_NUMBER", "EXPOSURE_LIMIT",
+	 "EQUILIBRIUM_TOLERANCE", 0};
 
 // ... Keywords for TimeOption enumeration in options.h
 static const char* timeOptionKeywords[] =
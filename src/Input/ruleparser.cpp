@@ -0,0 +1,273 @@
+/* EPANET 3
+ *
+ * Copyright (c) 2016 Open Water Analytics
+ * Licensed under the terms of the MIT License (see the LICENSE file for details).
+ *
+ */
+
+#include "ruleparser.h"
+#include "Core/network.h"
+#include "Core/error.h"
+#include "Elements/rule.h"
+#include "Elements/node.h"
+#include "Elements/link.h"
+#include "Utilities/utilities.h"
+
+using namespace std;
+
+//-----------------------------------------------------------------------------
+//  Rule Keywords
+//-----------------------------------------------------------------------------
+static const char* w_RULE     = "RULE";
+static const char* w_IF       = "IF";
+static const char* w_AND      = "AND";
+static const char* w_OR       = "OR";
+static const char* w_THEN     = "THEN";
+static const char* w_ELSE     = "ELSE";
+static const char* w_PRIORITY = "PRIORITY";
+static const char* w_IS       = "IS";
+
+static const char* objectWords[] =
+    {"NODE", "JUNCTION", "RESERVOIR", "TANK", "LINK", "PIPE", "PUMP", "VALVE",
+     "SYSTEM", 0};
+static const char* relationWords[] =
+    {"=", "<>", "<", "<=", ">", ">=", "IS", "NOT", "BELOW", "ABOVE", 0};
+static const int   relations[] =
+    {RulePremise::EQ, RulePremise::NE, RulePremise::LT, RulePremise::LE,
+     RulePremise::GT, RulePremise::GE, RulePremise::EQ, RulePremise::NE,
+     RulePremise::LT, RulePremise::GT};
+static const int   linkStatus[] =
+    {Link::LINK_CLOSED, Link::LINK_OPEN, Link::VALVE_ACTIVE};
+
+// Default tolerance (in user's units) used when testing for equality
+static const double VALUE_TOL = 0.001;
+
+//-----------------------------------------------------------------------------
+
+RuleParser::RuleParser() :
+    rule(nullptr),
+    rulePart(NO_PART)
+{}
+
+//-----------------------------------------------------------------------------
+
+void RuleParser::parseRuleLine(string& line, Network* network)
+
+// Formats are:
+//   RULE id
+//   IF/AND/OR NODE/JUNCTION/RESERVOIR/TANK id variable relation value
+//   IF/AND/OR LINK/PIPE/PUMP/VALVE id variable relation value
+//   IF/AND/OR SYSTEM variable relation value
+//   THEN/ELSE/AND LINK/PIPE/PUMP/VALVE id STATUS/SETTING IS value
+//   PRIORITY value
+
+{
+    tokens.clear();
+    Utilities::split(tokens, line);
+    if ( tokens.size() == 0 ) return;
+    string keyword = Utilities::upperCase(tokens[0]);
+
+    // ... start of a new rule (created when its name was first read)
+    if ( keyword == w_RULE )
+    {
+        if ( tokens.size() < 2 ) throw InputError(InputError::TOO_FEW_ITEMS, "");
+        if ( network->indexOf(Element::RULE, tokens[1]) < 0 )
+            throw InputError(InputError::UNDEFINED_OBJECT, tokens[1]);
+        rule = network->rule(tokens[1]);
+        rulePart = NO_PART;
+        return;
+    }
+    if ( rule == nullptr ) throw InputError(InputError::INVALID_KEYWORD, tokens[0]);
+
+    // ... premises
+    if ( keyword == w_IF )
+    {
+        if ( rulePart != NO_PART ) throw InputError(InputError::INVALID_KEYWORD, tokens[0]);
+        rulePart = PREMISES;
+        parsePremise(RulePremise::IF, network);
+    }
+    else if ( keyword == w_OR )
+    {
+        if ( rulePart != PREMISES ) throw InputError(InputError::INVALID_KEYWORD, tokens[0]);
+        parsePremise(RulePremise::OR, network);
+    }
+
+    // ... an AND clause continues whichever part of the rule is being read
+    else if ( keyword == w_AND )
+    {
+        switch (rulePart)
+        {
+        case PREMISES:     parsePremise(RulePremise::AND, network); break;
+        case THEN_ACTIONS: parseAction(rule->thenActions, network); break;
+        case ELSE_ACTIONS: parseAction(rule->elseActions, network); break;
+        default: throw InputError(InputError::INVALID_KEYWORD, tokens[0]);
+        }
+    }
+
+    // ... actions
+    else if ( keyword == w_THEN )
+    {
+        if ( rulePart != PREMISES ) throw InputError(InputError::INVALID_KEYWORD, tokens[0]);
+        rulePart = THEN_ACTIONS;
+        parseAction(rule->thenActions, network);
+    }
+    else if ( keyword == w_ELSE )
+    {
+        if ( rulePart != THEN_ACTIONS ) throw InputError(InputError::INVALID_KEYWORD, tokens[0]);
+        rulePart = ELSE_ACTIONS;
+        parseAction(rule->elseActions, network);
+    }
+
+    // ... priority
+    else if ( keyword == w_PRIORITY ) parsePriority();
+
+    else throw InputError(InputError::INVALID_KEYWORD, tokens[0]);
+}
+
+//-----------------------------------------------------------------------------
+
+void RuleParser::parsePremise(int logic, Network* network)
+{
+    RulePremise premise;
+    premise.logic = logic;
+    premise.element = nullptr;
+    premise.tolerance = VALUE_TOL;
+
+    // ... identify the type of object being tested
+    if ( tokens.size() < 2 ) throw InputError(InputError::TOO_FEW_ITEMS, "");
+    int k = Utilities::findFullMatch(Utilities::upperCase(tokens[1]), objectWords);
+    if ( k < 0 ) throw InputError(InputError::INVALID_KEYWORD, tokens[1]);
+    if ( k < 4 ) premise.object = RulePremise::NODE;
+    else if ( k < 8 ) premise.object = RulePremise::LINK;
+    else premise.object = RulePremise::SYSTEM;
+
+    // ... identify the node or link being tested
+    size_t n = 2;
+    if ( premise.object != RulePremise::SYSTEM )
+    {
+        if ( tokens.size() < 3 ) throw InputError(InputError::TOO_FEW_ITEMS, "");
+        int index;
+        if ( premise.object == RulePremise::NODE )
+        {
+            index = network->indexOf(Element::NODE, tokens[2]);
+            if ( index >= 0 ) premise.element = network->node(index);
+        }
+        else
+        {
+            index = network->indexOf(Element::LINK, tokens[2]);
+            if ( index >= 0 ) premise.element = network->link(index);
+        }
+        if ( index < 0 ) throw InputError(InputError::UNDEFINED_OBJECT, tokens[2]);
+        n = 3;
+    }
+
+    // ... identify the variable being tested and check that it applies
+    //     to the type of object
+    if ( tokens.size() < n + 3 ) throw InputError(InputError::TOO_FEW_ITEMS, "");
+    int v = Utilities::findFullMatch(Utilities::upperCase(tokens[n]),
+                                     Rule::VariableWords);
+    bool valid = false;
+    switch (premise.object)
+    {
+    case RulePremise::NODE:
+        valid = v >= RulePremise::DEMAND && v <= RulePremise::DRAINTIME;
+        break;
+    case RulePremise::LINK:
+        valid = v >= RulePremise::FLOW && v <= RulePremise::SETTING;
+        break;
+    case RulePremise::SYSTEM:
+        valid = v == RulePremise::DEMAND || v == RulePremise::TIME ||
+                v == RulePremise::CLOCKTIME;
+        break;
+    }
+    if ( !valid ) throw InputError(InputError::INVALID_KEYWORD, tokens[n]);
+    premise.variable = v;
+
+    // ... identify the relational operator
+    k = Utilities::findFullMatch(Utilities::upperCase(tokens[n+1]), relationWords);
+    if ( k < 0 ) throw InputError(InputError::INVALID_KEYWORD, tokens[n+1]);
+    premise.relation = relations[k];
+
+    // ... parse the value being tested against
+    premise.valueStr = tokens[n+2];
+    if ( v == RulePremise::STATUS )
+    {
+        k = Utilities::findFullMatch(Utilities::upperCase(tokens[n+2]),
+                                     Rule::StatusWords);
+        if ( k < 0 ) throw InputError(InputError::INVALID_KEYWORD, tokens[n+2]);
+        premise.value = linkStatus[k];
+        premise.tolerance = 0.0;
+    }
+    else if ( Rule::isTimePremise(premise) )
+    {
+        premise.value = parseTime(v, n+2);
+        premise.tolerance = 0.0;
+        if ( tokens.size() > n + 3 ) premise.valueStr += " " + tokens[n+3];
+    }
+    else if ( !Utilities::parseNumber(tokens[n+2], premise.value) )
+    {
+        throw InputError(InputError::INVALID_NUMBER, tokens[n+2]);
+    }
+    rule->premises.push_back(premise);
+}
+
+//-----------------------------------------------------------------------------
+
+void RuleParser::parseAction(vector<RuleAction>& actions, Network* network)
+{
+    // ... check that a link is being acted on
+    if ( tokens.size() < 6 ) throw InputError(InputError::TOO_FEW_ITEMS, "");
+    int k = Utilities::findFullMatch(Utilities::upperCase(tokens[1]), objectWords);
+    if ( k < 4 || k > 7 ) throw InputError(InputError::INVALID_KEYWORD, tokens[1]);
+    int index = network->indexOf(Element::LINK, tokens[2]);
+    if ( index < 0 ) throw InputError(InputError::UNDEFINED_OBJECT, tokens[2]);
+
+    RuleAction action;
+    action.link = network->link(index);
+    action.status = -1;
+    action.setting = 0.0;
+    action.valueStr = tokens[5];
+
+    // ... parse the new status or setting
+    int v = Utilities::findFullMatch(Utilities::upperCase(tokens[3]),
+                                     Rule::VariableWords);
+    if ( !Utilities::match(tokens[4], w_IS) )
+        throw InputError(InputError::INVALID_KEYWORD, tokens[4]);
+    if ( v == RulePremise::STATUS )
+    {
+        k = Utilities::findFullMatch(Utilities::upperCase(tokens[5]),
+                                     Rule::StatusWords);
+        if ( k < 0 ) throw InputError(InputError::INVALID_KEYWORD, tokens[5]);
+        action.status = linkStatus[k];
+    }
+    else if ( v == RulePremise::SETTING )
+    {
+        if ( !Utilities::parseNumber(tokens[5], action.setting) )
+            throw InputError(InputError::INVALID_NUMBER, tokens[5]);
+    }
+    else throw InputError(InputError::INVALID_KEYWORD, tokens[3]);
+    actions.push_back(action);
+}
+
+//-----------------------------------------------------------------------------
+
+void RuleParser::parsePriority()
+{
+    if ( tokens.size() < 2 ) throw InputError(InputError::TOO_FEW_ITEMS, "");
+    if ( !Utilities::parseNumber(tokens[1], rule->priority) )
+        throw InputError(InputError::INVALID_NUMBER, tokens[1]);
+}
+
+//-----------------------------------------------------------------------------
+
+//  Convert the time value starting at token 'first' into seconds.
+
+double RuleParser::parseTime(int variable, int first)
+{
+    string strUnits = "";
+    if ( (int)tokens.size() > first + 1 ) strUnits = tokens[first+1];
+    int t = Utilities::getSeconds(tokens[first], strUnits);
+    if ( t < 0 ) throw InputError(InputError::INVALID_TIME, tokens[first]);
+    if ( variable == RulePremise::CLOCKTIME ) t = t % 86400;
+    return t;
+}
@@ -0,0 +1,49 @@
+/* EPANET 3
+ *
+ * Copyright (c) 2016 Open Water Analytics
+ * Licensed under the terms of the MIT License (see the LICENSE file for details).
+ *
+ */
+
+//! \file ruleparser.h
+//! \brief Describes the RuleParser class.
+
+#ifndef RULEPARSER_H_
+#define RULEPARSER_H_
+
+#include <string>
+#include <vector>
+
+class Rule;
+struct RuleAction;
+class Network;
+
+//! \class RuleParser
+//! \brief Parses the clauses of a rule-based control from lines of text.
+//!
+//! Each line of the [RULES] section holds a single clause (RULE, IF, AND,
+//! OR, THEN, ELSE or PRIORITY). The parser remembers which rule and which
+//! part of that rule is being read so that AND clauses can be assigned to
+//! either the rule's premises or its actions.
+
+class RuleParser
+{
+  public:
+    RuleParser();
+    ~RuleParser() {}
+    void parseRuleLine(std::string& line, Network* network);
+
+  private:
+    enum RulePart {NO_PART, PREMISES, THEN_ACTIONS, ELSE_ACTIONS};
+
+    Rule*                    rule;       //!< rule being parsed
+    int                      rulePart;   //!< part of rule being parsed
+    std::vector<std::string> tokens;     //!< tokens of current line
+
+    void   parsePremise(int logic, Network* network);
+    void   parseAction(std::vector<RuleAction>& actions, Network* network);
+    void   parsePriority();
+    double parseTime(int variable, int first);
+};
+
+#endif
@@ -96,6 +96,12 @@ void ChemModel::init(Network* nw)
 
     // save concentration limit
     cLimit = nw->option(Options::LIMITING_CONCEN) / FT3perL;
+
+    // discard any reaction factors saved from a previous run
+    for (Link* link : nw->links)
+    {
+        if ( link->type() == Link::PIPE ) static_cast<Pipe*>(link)->reactStep = 0.0;
+    }
 }
 
 //-----------------------------------------------------------------------------
@@ -118,12 +124,46 @@ bool ChemModel::setReactive(Network* nw)
 
 //-----------------------------------------------------------------------------
 
+//  Find the factors used to react a pipe's contents over a time step.
+//
+//  The pipe's mass transfer coefficient depends only on its flow rate, and
+//  when both bulk and wall reactions are first order (with no limiting
+//  concentration) the reaction over a time step just scales concentration
+//  by a factor that depends only on the pipe, its flow and the time step.
+//  Both are saved with the pipe and only found again when its flow or the
+//  time step changes.
+
+void ChemModel::findReactFactors(Pipe* pipe, double tstep)
+{
+    if ( pipe->flow == pipe->reactFlow && tstep == pipe->reactStep ) return;
+    pipe->reactFlow = pipe->flow;
+    pipe->reactStep = tstep;
+    findMassTransCoeff(pipe);
+
+    // ... reaction rate per unit of concentration is constant
+    //     for first order kinetics
+    pipe->reactFactor = -1.0;
+    if ( pipeOrder != 1.0 || cLimit != 0.0 ) return;
+    double kw = pipe->wallCoeff / SECperDAY * wallUcf;
+    if ( kw != 0.0 && wallOrder != 1.0 ) return;
+    double rate = pipe->bulkCoeff / SECperDAY * pipeUcf;
+    if ( kw != 0.0 )
+    {
+        rate += findWallRate(kw, pipe->diameter, pipe->massTransCoeff,
+                             wallOrder, 1.0);
+    }
+    pipe->reactFactor = 1.0 + rate * tstep;
+}
+
+//-----------------------------------------------------------------------------
+
 //  Find a mass transfer coefficient between the bulk flow and the pipe wall
-//  for the current flow rate.
+//  for the current flow rate. (The coefficient is kept with the pipe so
+//  that different pipes can be reacted concurrently.)
 
 void ChemModel::findMassTransCoeff(Pipe* pipe)
 {
-    massTransCoeff = 0.0;
+    pipe->massTransCoeff = 0.0;
 
     // ... return if no wall reaction or zero diffusivity
     if ( pipe->wallCoeff == 0.0 ) return;
@@ -157,7 +197,7 @@ void ChemModel::findMassTransCoeff(Pipe* pipe)
     }
 
    // ... compute mass transfer coeff. (in ft/sec)
-   massTransCoeff = Sh * diffus / d;
+   pipe->massTransCoeff = Sh * diffus / d;
 }
 
 //-----------------------------------------------------------------------------
@@ -166,13 +206,23 @@ void ChemModel::findMassTransCoeff(Pipe* pipe)
 
 double ChemModel::pipeReact(Pipe* pipe, double c, double tstep)
 {
+    // ... use the pipe's first order decay factor if it applies
+    if ( pipe->reactFactor >= 0.0 && tstep == pipe->reactStep )
+    {
+        return max(0.0, c * pipe->reactFactor);
+    }
+
     double dCdT = 0.0;
 
     double kb = pipe->bulkCoeff / SECperDAY;
     if ( kb != 0.0 ) dCdT = findBulkRate(kb, pipeOrder, c) * pipeUcf;
 
     double kw = pipe->wallCoeff / SECperDAY * wallUcf;
-    if ( kw != 0.0 ) dCdT += findWallRate(kw, pipe->diameter, wallOrder, c);
+    if ( kw != 0.0 )
+    {
+        dCdT += findWallRate(kw, pipe->diameter, pipe->massTransCoeff,
+                             wallOrder, c);
+    }
 
     c = c + dCdT * tstep;
     return max(0.0, c);
@@ -232,7 +282,8 @@ double ChemModel::findBulkRate(double kb, double order, double c)
 
 //  Find the wall reaction rate at a given chemical concentration.
 
-double ChemModel::findWallRate(double kw, double d, double order, double c)
+double ChemModel::findWallRate(double kw, double d, double kf, double order,
+                               double c)
 {
     // ... find pipe's hydraulic radius (area / wetted perimeter)
 
@@ -241,7 +292,7 @@ double ChemModel::findWallRate(double kw, double d, double order, double c)
 
     // ... if mass transfer ignored return rate based just on wall coeff.
 
-    if ( massTransCoeff == 0.0 )
+    if ( kf == 0.0 )
     {
         if (order == 0.0) c = 1.0;
         return c * kw / rh;
@@ -255,7 +306,7 @@ double ChemModel::findWallRate(double kw, double d, double order, double c)
         //     wall rate & mass transfer rate
         if ( order == 0.0 )
         {
-            double kf = Utilities::sign(kw) * c * massTransCoeff;   // mass/ft2/sec
+            kf = Utilities::sign(kw) * c * kf;                   // mass/ft2/sec
             if ( abs(kf) < abs(kw) ) kw = kf;
             return kw / rh;                                      // mass/ft3/sec
         }
@@ -264,7 +315,6 @@ double ChemModel::findWallRate(double kw, double d, double order, double c)
         //     composite of wall & mass transfer coeffs.
         else
         {
-            double kf = massTransCoeff;
             return c * kw * kf / (kf + abs(kw)) / rh;
         }
     }
@@ -46,7 +46,7 @@ class QualModel
     virtual void init(Network* nw)
 	{ }
 
-    virtual void findMassTransCoeff(Pipe* pipe)
+    virtual void findReactFactors(Pipe* pipe, double tstep)
 	{ }
 
     virtual double pipeReact(Pipe* pipe, double c, double tstep)
@@ -73,7 +73,7 @@ class ChemModel : public QualModel
     ChemModel();
     bool   isReactive() { return reactive; }
     void   init(Network* nw);
-    void   findMassTransCoeff(Pipe* pipe);
+    void   findReactFactors(Pipe* pipe, double tstep);
     double pipeReact(Pipe* pipe, double c, double tstep);
     double tankReact(Tank* tank, double c, double tstep);
 
@@ -85,15 +85,16 @@ class ChemModel : public QualModel
     double  pipeOrder;        // pipe bulk fluid reaction order
     double  tankOrder;        // tank bulk fluid reaction order
     double  wallOrder;        // pipe wall reaction order
-    double  massTransCoeff;   // a pipe's mass transfer coeff. (ft/sec)
     double  pipeUcf;          // volume conversion factor for pipes
     double  tankUcf;          // volume conversion factor for tanks
     double  wallUcf;          // wall reaction coefficient conversion factor for pipes
     double  cLimit;           // min/max concentration limit (mass/ft3)
 
     bool    setReactive(Network* nw);
+    void    findMassTransCoeff(Pipe* pipe);
     double  findBulkRate(double kb, double order, double c);
-    double  findWallRate(double kw, double d, double order, double c);
+    double  findWallRate(double kw, double d, double kf, double order,
+                         double c);
 };
 
 
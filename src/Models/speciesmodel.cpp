@@ -0,0 +1,380 @@
+/* EPANET 3
+ *
+ * Copyright (c) 2016 Open Water Analytics
+ * Licensed under the terms of the MIT License (see the LICENSE file for details).
+ *
+ */
+
+#include "speciesmodel.h"
+#include "Utilities/utilities.h"
+
+#include <algorithm>
+#include <cmath>
+using namespace std;
+
+//  Seconds per day (rates are supplied per day)
+static const double SECperDAY = 86400.0;
+
+//  Value of a trace species at the node it traces
+static const double TRACE_PERCENT = 100.0;
+
+//-----------------------------------------------------------------------------
+
+SpeciesModel::SpeciesModel() :
+    firstOrder(true)
+{}
+
+SpeciesModel::~SpeciesModel()
+{}
+
+//-----------------------------------------------------------------------------
+
+//  Remove all species along with their reactions and node values.
+
+void SpeciesModel::clear()
+{
+    names.clear();
+    unitNames.clear();
+    traceNodes.clear();
+    injectionIndex.clear();
+    injections.clear();
+    injectionsByNode.clear();
+    tracedNodes.clear();
+    nameIndex.clear();
+    terms.clear();
+    decayRates.clear();
+    firstOrder = true;
+    nodeValues.clear();
+}
+
+//-----------------------------------------------------------------------------
+
+//  Add a new species and return its index (or -1 if its name is in use).
+
+int SpeciesModel::addSpecies(const string& name, const string& units)
+{
+    if ( indexOf(name) >= 0 ) return -1;
+    nameIndex[Utilities::upperCase(name)] = (int)names.size();
+    names.push_back(name);
+    unitNames.push_back(units);
+    traceNodes.push_back(-1);
+    injectionIndex.push_back(-1);
+    decayRates.push_back(0.0);
+    return (int)names.size() - 1;
+}
+
+//-----------------------------------------------------------------------------
+
+//  Add a species, named after the node it traces, that gives the percent
+//  of flow coming from that node. Returns the species index (or -1 if the
+//  name is in use).
+
+int SpeciesModel::addTrace(int node, const string& nodeName)
+{
+    int s = addSpecies(nodeName, "%");
+    if ( s < 0 ) return -1;
+    traceNodes[s] = node;
+    tracedNodes.insert(node);
+    setNodeValue(node, s, TRACE_PERCENT);
+    return s;
+}
+
+//-----------------------------------------------------------------------------
+
+//  Add a species, named nodeName#k for the k-th injection at its node,
+//  whose value in the water leaving the node is held at value for duration
+//  seconds (or for good if duration is 0) from time start and which reacts
+//  at a first order rate per day. Returns the species index.
+
+int SpeciesModel::addInjection(int node, const string& nodeName, double value,
+                               double rate, int start, int duration)
+{
+    // ... number the injection among those at its node, skipping past
+    //     any name already taken by another species
+    int k = 1;
+    for (const Injection& injection : injections)
+    {
+        if ( injection.node == node ) k++;
+    }
+    string name;
+    do name = nodeName + "#" + to_string(k++); while ( indexOf(name) >= 0 );
+
+    int s = addSpecies(name, "");
+    if ( s < 0 ) return -1;
+    Injection injection;
+    injection.species = s;
+    injection.node = node;
+    injection.value = value;
+    injection.rate = rate;
+    injection.start = start;
+    injection.duration = duration;
+    injection.active = false;
+    injectionIndex[s] = (int)injections.size();
+    injections.push_back(injection);
+    if ( rate != 0.0 ) addReaction(s, rate, s, -1);
+    return s;
+}
+
+//-----------------------------------------------------------------------------
+
+//  Retrieve the properties of the j-th injection (with its rate per day).
+
+void SpeciesModel::getInjection(int j, double& value, double& rate, int& start,
+                                int& duration)
+{
+    value = injections[j].value;
+    rate = injections[j].rate;
+    start = injections[j].start;
+    duration = injections[j].duration;
+}
+
+//-----------------------------------------------------------------------------
+
+//  Mark which injections are under way at time t (sec).
+
+void SpeciesModel::setInjectionTime(int t)
+{
+    for (Injection& injection : injections)
+    {
+        injection.active = t >= injection.start &&
+            (injection.duration == 0 || t < injection.start + injection.duration);
+    }
+
+    // ... index the injections by node for inject()
+    if ( injectionsByNode.size() != injections.size() )
+    {
+        injectionsByNode.resize(injections.size());
+        for (size_t j = 0; j < injections.size(); j++) injectionsByNode[j] = (int)j;
+        stable_sort(injectionsByNode.begin(), injectionsByNode.end(),
+            [this](int a, int b) { return injections[a].node < injections[b].node; });
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+//  Set the values x of any species being injected at a node. Injected
+//  species that aren't under way are set to 0 if the node's values are
+//  fixed (as a reservoir's are).
+
+void SpeciesModel::inject(int node, double* x, bool fixed)
+{
+    auto it = lower_bound(injectionsByNode.begin(), injectionsByNode.end(), node,
+        [this](int j, int i) { return injections[j].node < i; });
+    for ( ; it != injectionsByNode.end(); ++it)
+    {
+        Injection& injection = injections[*it];
+        if ( injection.node != node ) break;
+        if ( injection.active ) x[injection.species] = injection.value;
+        else if ( fixed ) x[injection.species] = 0.0;
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+//  Add the term rate*[s1]*[s2] to the rate equation of species target,
+//  where rate is per day and s1 or s2 is -1 if the factor is omitted.
+
+void SpeciesModel::addReaction(int target, double rate, int s1, int s2)
+{
+    Term term;
+    term.target = target;
+    term.rate = rate / SECperDAY;
+    term.s1 = s1;
+    term.s2 = s2;
+    terms.push_back(term);
+    if ( s1 == target && s2 < 0 ) decayRates[target] += term.rate;
+    else firstOrder = false;
+}
+
+//-----------------------------------------------------------------------------
+
+//  Assign a species value to a node. It's the initial value of junctions
+//  and tanks and the fixed supply value of reservoirs.
+
+void SpeciesModel::setNodeValue(int node, int species, double value)
+{
+    NodeValue nodeValue;
+    nodeValue.node = node;
+    nodeValue.species = species;
+    nodeValue.value = value;
+    nodeValues.push_back(nodeValue);
+}
+
+//-----------------------------------------------------------------------------
+
+//  Find the index of a species given its name (or -1 if there's none).
+
+int SpeciesModel::indexOf(const string& name)
+{
+    auto it = nameIndex.find(Utilities::upperCase(name));
+    if ( it == nameIndex.end() ) return -1;
+    return it->second;
+}
+
+//-----------------------------------------------------------------------------
+
+//  Retrieve the i-th reaction term (with its rate per day).
+
+void SpeciesModel::getTerm(int i, int& target, double& rate, int& s1, int& s2)
+{
+    target = terms[i].target;
+    rate = terms[i].rate * SECperDAY;
+    s1 = terms[i].s1;
+    s2 = terms[i].s2;
+}
+
+//-----------------------------------------------------------------------------
+
+//  Retrieve the i-th species value assigned to a node.
+
+void SpeciesModel::getNodeValue(int i, int& node, int& species, double& value)
+{
+    node = nodeValues[i].node;
+    species = nodeValues[i].species;
+    value = nodeValues[i].value;
+}
+
+//-----------------------------------------------------------------------------
+
+//  Fill x with the value of each species (in user units) at each node,
+//  where node i's values start at x[i*count()]. Unassigned values are 0,
+//  except for injections under way at time 0.
+
+void SpeciesModel::initNodeValues(vector<double>& x, int nodeCount)
+{
+    int m = count();
+    x.assign(nodeCount * m, 0.0);
+    for (NodeValue& nv : nodeValues)
+    {
+        if ( nv.node < nodeCount ) x[nv.node * m + nv.species] = nv.value;
+    }
+    setInjectionTime(0);
+    for (Injection& injection : injections)
+    {
+        if ( injection.active && injection.node < nodeCount )
+        {
+            x[injection.node * m + injection.species] = injection.value;
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+//  React a batch of n segments over a time step of tstep seconds.
+//
+//  x[s] points to the n values of species s. The rate equations are
+//  integrated with a single classical Runge-Kutta step, working on a
+//  contiguous copy of the batch in work, and the results are kept from
+//  going negative.
+
+void SpeciesModel::react(double* const* x, int n, double tstep,
+                         vector<double>& work)
+{
+    int m = count();
+    int size = m * n;
+    if ( terms.empty() || size == 0 ) return;
+    if ( firstOrder )
+    {
+        decay(x, n, tstep, work);
+        return;
+    }
+    work.resize(4 * size);
+    double* y   = &work[0];            // values at start of step
+    double* yt  = &work[size];         // values at an intermediate stage
+    double* k   = &work[2*size];       // rates at the current stage
+    double* sum = &work[3*size];       // weighted sum of stage rates
+
+    for (int s = 0; s < m; s++) copy(x[s], x[s] + n, y + s*n);
+
+    // ... stage 1
+    findRates(y, k, n);
+    for (int j = 0; j < size; j++)
+    {
+        sum[j] = k[j];
+        yt[j] = y[j] + 0.5 * tstep * k[j];
+    }
+
+    // ... stage 2
+    findRates(yt, k, n);
+    for (int j = 0; j < size; j++)
+    {
+        sum[j] += 2.0 * k[j];
+        yt[j] = y[j] + 0.5 * tstep * k[j];
+    }
+
+    // ... stage 3
+    findRates(yt, k, n);
+    for (int j = 0; j < size; j++)
+    {
+        sum[j] += 2.0 * k[j];
+        yt[j] = y[j] + tstep * k[j];
+    }
+
+    // ... stage 4 and the weighted update
+    findRates(yt, k, n);
+    for (int s = 0; s < m; s++)
+    {
+        double* xs = x[s];
+        int j0 = s * n;
+        for (int j = 0; j < n; j++)
+        {
+            double v = y[j0+j] + tstep / 6.0 * (sum[j0+j] + k[j0+j]);
+            xs[j] = max(0.0, v);
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+//  React a batch of n segments over a time step of tstep seconds when each
+//  species only has first order terms in itself, using the exact solution
+//  x(t) = x(0) * exp(k * t). The decay factors are kept in work for as long
+//  as the time step stays the same.
+
+void SpeciesModel::decay(double* const* x, int n, double tstep,
+                         vector<double>& work)
+{
+    int m = count();
+    if ( (int)work.size() != m + 1 || work[m] != tstep )
+    {
+        work.resize(m + 1);
+        for (int s = 0; s < m; s++) work[s] = exp(decayRates[s] * tstep);
+        work[m] = tstep;
+    }
+    for (int s = 0; s < m; s++)
+    {
+        if ( work[s] == 1.0 ) continue;
+        double f = work[s];
+        double* xs = x[s];
+        for (int j = 0; j < n; j++) xs[j] *= f;
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+//  Evaluate the rate equations for a batch of n segments whose species
+//  values y (and rates dydt) are stored one species after another.
+
+void SpeciesModel::findRates(const double* y, double* dydt, int n)
+{
+    fill(dydt, dydt + count() * n, 0.0);
+    for (Term& term : terms)
+    {
+        double* r = dydt + term.target * n;
+        const double* y1 = term.s1 >= 0 ? y + term.s1 * n : 0;
+        const double* y2 = term.s2 >= 0 ? y + term.s2 * n : 0;
+        if ( y1 && y2 )
+        {
+            for (int j = 0; j < n; j++) r[j] += term.rate * y1[j] * y2[j];
+        }
+        else if ( y1 || y2 )
+        {
+            if ( !y1 ) y1 = y2;
+            for (int j = 0; j < n; j++) r[j] += term.rate * y1[j];
+        }
+        else
+        {
+            for (int j = 0; j < n; j++) r[j] += term.rate;
+        }
+    }
+}
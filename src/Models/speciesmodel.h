@@ -0,0 +1,141 @@
+/* EPANET 3
+ *
+ * Copyright (c) 2016 Open Water Analytics
+ * Licensed under the terms of the MIT License (see the LICENSE file for details).
+ *
+ */
+
+//! \file speciesmodel.h
+//! \brief Describes the SpeciesModel class.
+
+#ifndef SPECIESMODEL_H_
+#define SPECIESMODEL_H_
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+
+//! \class SpeciesModel
+//! \brief Describes the extra water quality species carried through a network.
+//!
+//! Besides the constituent of its quality model, a network can carry any
+//! number of additional species (chlorine, TOC, DBPs, etc.) that travel
+//! with the water and react with one another. Their reactions form a
+//! coupled system of rate equations, each built from mass-action terms
+//!
+//!     d[target]/dt += rate * [s1] * [s2]
+//!
+//! where either species factor can be omitted and rate is per day. So a
+//! first order decay of A is the single term (A, -k, A), a second order
+//! reaction between A and B is the pair (A, -k, A, B) and (B, -k, A, B),
+//! and a zero order term (A, 1) makes A count time like water age.
+//!
+//! A species can also trace the flow from a given node, in which case its
+//! value is held at 100 at that node and it gives the percentage of water
+//! at every other node that came from there. Any number of sources can be
+//! traced this way in a single run.
+//!
+//! Injection species make up a contamination ensemble. Each one holds the
+//! water leaving its injection node at a set value over a window of time
+//! and may decay at a first order rate. Since transport, mixing and first
+//! order decay are all linear in the injected value, every injection is an
+//! independent scenario, and thousands of them can ride along with the
+//! same hydraulics as lanes of the species arrays carried by each segment.
+//! Each injection species is named after its node and its number among
+//! the injections there (10#1, 10#2, ...), so a node can be the source of
+//! several scenarios and be traced as well.
+//! When all reactions are first order in the species they change, as they
+//! are for an ensemble, the reactions are integrated exactly instead of
+//! with Runge-Kutta steps.
+//!
+//! Species values are kept in the user's own units. The model's react()
+//! function integrates the rate equations over a time step for a whole
+//! batch of volume segments at once, with each species' values for the
+//! batch held in a separate array.
+
+class SpeciesModel
+{
+  public:
+
+    SpeciesModel();
+    ~SpeciesModel();
+
+    void   clear();
+    int    addSpecies(const std::string& name, const std::string& units);
+    int    addTrace(int node, const std::string& nodeName);
+    int    addInjection(int node, const std::string& nodeName, double value,
+                        double rate, int start, int duration);
+    void   addReaction(int target, double rate, int s1, int s2);
+    void   setNodeValue(int node, int species, double value);
+
+    int    count() { return (int)names.size(); }
+    int    indexOf(const std::string& name);
+    std::string name(int species) { return names[species]; }
+    std::string units(int species) { return unitNames[species]; }
+    int    traceNode(int species) { return traceNodes[species]; }
+    bool   isTraced(int node) { return tracedNodes.count(node) > 0; }
+    int    injectionCount() { return (int)injections.size(); }
+    int    injectionSpecies(int j) { return injections[j].species; }
+    int    injectionOf(int species) { return injectionIndex[species]; }
+    int    injectionNode(int j) { return injections[j].node; }
+    void   getInjection(int j, double& value, double& rate, int& start, int& duration);
+    void   setInjectionTime(int t);
+    void   inject(int node, double* x, bool fixed);
+    bool   isReactive() { return terms.size() > 0; }
+    bool   isFirstOrder() { return firstOrder; }
+    double decayRate(int species) { return decayRates[species]; }
+    int    termCount() { return (int)terms.size(); }
+    void   getTerm(int i, int& target, double& rate, int& s1, int& s2);
+    int    nodeValueCount() { return (int)nodeValues.size(); }
+    void   getNodeValue(int i, int& node, int& species, double& value);
+
+    void   initNodeValues(std::vector<double>& x, int nodeCount);
+    void   react(double* const* x, int n, double tstep, std::vector<double>& work);
+
+  private:
+
+    struct Term              //!< mass-action reaction term
+    {
+        int    target;       //!< species whose rate the term adds to
+        double rate;         //!< rate coefficient (per sec)
+        int    s1;           //!< first species factor (or -1)
+        int    s2;           //!< second species factor (or -1)
+    };
+
+    struct Injection         //!< species injected at a node
+    {
+        int    species;      //!< species index
+        int    node;         //!< node index
+        double value;        //!< value of water leaving the node (user units)
+        double rate;         //!< first order rate (per day)
+        int    start;        //!< time injection starts (sec)
+        int    duration;     //!< injection duration (sec, 0 if unlimited)
+        bool   active;       //!< true if injecting at the current time
+    };
+
+    struct NodeValue         //!< species value assigned to a node
+    {
+        int    node;         //!< node index
+        int    species;      //!< species index
+        double value;        //!< initial or supply value (user units)
+    };
+
+    std::vector<std::string> names;        //!< name of each species
+    std::vector<std::string> unitNames;    //!< units of each species
+    std::vector<int>         traceNodes;   //!< node traced by each species (or -1)
+    std::vector<int>         injectionIndex; //!< injection of each species (or -1)
+    std::vector<Injection>   injections;   //!< injected species
+    std::vector<int>         injectionsByNode; //!< injections sorted by node
+    std::unordered_set<int>  tracedNodes;  //!< nodes traced by any species
+    std::unordered_map<std::string, int> nameIndex; //!< species index by upper case name
+    std::vector<Term>        terms;        //!< terms of the rate equations
+    bool                     firstOrder;   //!< true if all terms are first order in their target
+    std::vector<double>      decayRates;   //!< first order rate of each species (per sec)
+    std::vector<NodeValue>   nodeValues;   //!< values assigned to nodes
+
+    void   decay(double* const* x, int n, double tstep, std::vector<double>& work);
+    void   findRates(const double* y, double* dydt, int n);
+};
+
+#endif
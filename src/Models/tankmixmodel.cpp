@@ -26,8 +26,8 @@ TankMixModel::TankMixModel() :
     fracMixed(0.0),
     cTank(0.0),
     vMixed(0.0),
-    firstSeg(nullptr),
-    lastSeg(nullptr)
+    segPool(nullptr),
+    segList(0)
 { }
 
 TankMixModel::~TankMixModel()
@@ -37,7 +37,7 @@ TankMixModel::~TankMixModel()
 
 //  Initialize a tank's mixing model.
 
-void TankMixModel::init(Tank* tank, SegPool* segPool, double _cTol)
+void TankMixModel::init(Tank* tank, SegPool* segPool_, double _cTol)
 {
     // ... save project's quality tolerance, initial quality, and
     //     mixing zone volume (needed only for MIX2 model)
@@ -45,39 +45,39 @@ void TankMixModel::init(Tank* tank, SegPool* segPool, double _cTol)
     cTank = tank->quality;
     vMixed = fracMixed * tank->maxVolume;
 
-    // ... create a volume segment for the entire tank
-    firstSeg = segPool->getSegment(tank->volume, cTank);
-    if ( firstSeg == nullptr )
-        throw SystemError(SystemError::OUT_OF_MEMORY);
-    lastSeg = firstSeg;
+    // ... create a list to hold the tank's volume segments
+    segPool = segPool_;
+    segList = segPool->newList();
 
     // ... create a second segment for the 2-compartment model
     if ( type == MIX2 )
     {
-        // ... firstSeg contains stagnant zone
+        // ... first segment contains stagnant zone
         double v = max(0.0, tank->volume - vMixed);
-        firstSeg->v = v;
+        if ( !segPool->pushBack(segList, v, cTank) )
+            throw SystemError(SystemError::OUT_OF_MEMORY);
 
-        // ... lastSeg contains mixing zone
-        lastSeg = segPool->getSegment(tank->volume - v, cTank);
-        if ( lastSeg == nullptr )
+        // ... last segment contains mixing zone
+        if ( !segPool->pushBack(segList, tank->volume - v, cTank) )
             throw SystemError(SystemError::OUT_OF_MEMORY);
-        firstSeg->next = lastSeg;
     }
+
+    // ... otherwise create a volume segment for the entire tank
+    else if ( !segPool->pushBack(segList, tank->volume, cTank) )
+        throw SystemError(SystemError::OUT_OF_MEMORY);
 }
 
 //-----------------------------------------------------------------------------
 
 //  Update the quality of water released by a tank.
 
-double TankMixModel::findQuality(double vNet, double vIn,
-                                 double wIn, SegPool* segPool)
+double TankMixModel::findQuality(double vNet, double vIn, double wIn)
 {
 	switch (type)
 	{
     case MIX2: return findMIX2Quality(vNet, vIn, wIn);
-    case FIFO: return findFIFOQuality(vNet, vIn, wIn, segPool);
-    case LIFO: return findLIFOQuality(vNet, vIn, wIn, segPool);
+    case FIFO: return findFIFOQuality(vNet, vIn, wIn);
+    case LIFO: return findLIFOQuality(vNet, vIn, wIn);
     default:   return findMIX1Quality(vNet, vIn, wIn);
 	}
 }
@@ -89,13 +89,13 @@ double TankMixModel::findQuality(double vNet, double vIn,
 double TankMixModel::react(Tank* tank, QualModel* qualModel, double tstep)
 {
     double massReacted = 0.0;
-    Segment* seg = firstSeg;
-    while (seg)
+    int n = segPool->size(segList);
+    Segment* seg = segPool->first(segList);
+    for (int i = 0; i < n; i++)
     {
-        double c = seg->c;
-        seg->c = qualModel->tankReact(tank, c, tstep);
-        massReacted += (c - seg->c) * seg->v;
-        seg = seg->next;
+        double c = seg[i].c;
+        seg[i].c = qualModel->tankReact(tank, c, tstep);
+        massReacted += (c - seg[i].c) * seg[i].v;
     }
     return massReacted;
 }
@@ -107,13 +107,57 @@ double TankMixModel::react(Tank* tank, QualModel* qualModel, double tstep)
 double TankMixModel::storedMass()
 {
     double totalMass = 0.0;
-    Segment* seg = firstSeg;
-    while (seg)
+    int n = segPool->size(segList);
+    Segment* seg = segPool->first(segList);
+    for (int i = 0; i < n; i++) totalMass += seg[i].c * seg[i].v;
+    return totalMass;
+}
+
+//-----------------------------------------------------------------------------
+
+//  Find the volume of water stored in a tank's segments.
+
+double TankMixModel::storedVolume()
+{
+    double totalVolume = 0.0;
+    int n = segPool->size(segList);
+    Segment* seg = segPool->first(segList);
+    for (int i = 0; i < n; i++) totalVolume += seg[i].v;
+    return totalVolume;
+}
+
+//-----------------------------------------------------------------------------
+
+//  Append the volume and quality of each of a tank's segments to v and c
+//  and return the number of segments appended.
+
+int TankMixModel::getSegments(vector<double>& v, vector<double>& c)
+{
+    int n = segPool->size(segList);
+    Segment* seg = segPool->first(segList);
+    for (int i = 0; i < n; i++)
     {
-        totalMass += seg->c * seg->v;
-        seg = seg->next;
+        v.push_back(seg[i].v);
+        c.push_back(seg[i].c);
+    }
+    return n;
+}
+
+//-----------------------------------------------------------------------------
+
+//  Replace a tank's segments with a new list of n segments in segPool.
+
+void TankMixModel::setSegments(const double* v, const double* c, int n,
+                               double cInternal, SegPool* segPool_)
+{
+    cTank = cInternal;
+    segPool = segPool_;
+    segList = segPool->newList();
+    for (int i = 0; i < n; i++)
+    {
+        if ( !segPool->pushBack(segList, v[i], c[i]) )
+            throw SystemError(SystemError::OUT_OF_MEMORY);
     }
-    return totalMass;
 }
 
 //-----------------------------------------------------------------------------
@@ -122,13 +166,14 @@ double TankMixModel::storedMass()
 
 double TankMixModel::findMIX1Quality(double vNet, double vIn, double wIn)
 {
-    double vNew = firstSeg->v + vIn;
+    Segment* seg = segPool->first(segList);
+    double vNew = seg->v + vIn;
     if ( vNew > 0.0 )
     {
-        firstSeg->c = (firstSeg->c * firstSeg->v + wIn) / vNew;
+        seg->c = (seg->c * seg->v + wIn) / vNew;
     }
-    firstSeg->v += vNet;
-    cTank = firstSeg->c;
+    seg->v += vNet;
+    cTank = seg->c;
     return cTank;
 }
 
@@ -138,8 +183,8 @@ double TankMixModel::findMIX1Quality(double vNet, double vIn, double wIn)
 
 double TankMixModel::findMIX2Quality(double vNet, double vIn, double wIn)
 {
-    Segment* mixZone = lastSeg;    // mixing compartment
-    Segment* stagZone = firstSeg;  // stagnant compartment
+    Segment* mixZone = segPool->last(segList);    // mixing compartment
+    Segment* stagZone = segPool->first(segList);  // stagnant compartment
     double vTransfer = 0.0;        // volume transferred between compartments
 
     // ... tank is filling
@@ -196,24 +241,23 @@ double TankMixModel::findMIX2Quality(double vNet, double vIn, double wIn)
 
 //  Find the quality leaving the the first segment of a plug flow (FIFO) tank.
 
-double TankMixModel::findFIFOQuality(double vNet, double vIn, double wIn,
-                                     SegPool* segPool)
+double TankMixModel::findFIFOQuality(double vNet, double vIn, double wIn)
 {
     // ... add new last segment for flow entering the tank
     if ( vIn > 0.0 )
     {
         // ... increase segment volume if inflow has same quality as segment
         double cIn = wIn / vIn;
-        if ( lastSeg && abs(lastSeg->c - cIn ) < cTol ) lastSeg->v += vIn;
+        if ( segPool->size(segList) > 0 &&
+             abs(segPool->last(segList)->c - cIn ) < cTol )
+        {
+            segPool->last(segList)->v += vIn;
+        }
 
         // ... otherwise add a new last segment to the tank
-        else
+        else if ( !segPool->pushBack(segList, vIn, cIn) )
         {
-            Segment* seg = segPool->getSegment(vIn, cIn);
-            if ( seg == nullptr ) throw SystemError(SystemError::OUT_OF_MEMORY);
-            if ( firstSeg == nullptr ) firstSeg = seg;
-            if ( lastSeg ) lastSeg->next = seg;
-            lastSeg = seg;
+            throw SystemError(SystemError::OUT_OF_MEMORY);
         }
     }
 
@@ -221,27 +265,26 @@ double TankMixModel::findFIFOQuality(double vNet, double vIn, double wIn,
     double vSum = 0.0;
     double wSum = 0.0;
     double vOut = vIn - vNet;
-    while (vOut > 0.0)
+    int n = segPool->size(segList);
+    Segment* seg = segPool->first(segList);
+    int consumed = 0;
+    while ( vOut > 0.0 && consumed < n )
     {
-        Segment* seg = firstSeg;
-        if ( seg == nullptr ) break;
-        double vSeg = min(seg->v, vOut);
-        if ( seg == lastSeg ) vSeg = vOut;
+        Segment& first = seg[consumed];
+        double vSeg = min(first.v, vOut);
+        if ( consumed == n - 1 ) vSeg = vOut;
         vSum += vSeg;
-        wSum += seg->c * vSeg;
+        wSum += first.c * vSeg;
         vOut -= vSeg;
-        if ( vOut >= 0.0 && vSeg >= seg->v && seg->next )
-        {
-            firstSeg = seg->next;
-            segPool->freeSegment(seg);
-        }
-        else seg->v -= vSeg;
+        if ( vOut >= 0.0 && vSeg >= first.v && consumed < n - 1 ) consumed++;
+        else first.v -= vSeg;
     }
+    segPool->popFront(segList, consumed);
 
     // ... return average quality withdrawn from 1st segment
     if ( vSum > 0.0 ) cTank = wSum / vSum;
-    else if ( firstSeg == nullptr ) cTank = 0.0;
-    else  cTank = firstSeg->c;
+    else if ( segPool->size(segList) == 0 ) cTank = 0.0;
+    else  cTank = segPool->first(segList)->c;
     return cTank;
 }
 
@@ -249,25 +292,25 @@ double TankMixModel::findFIFOQuality(double vNet, double vIn, double wIn,
 
 //  Find the quality leaving the bottom (last) segment of a vertical FIFO tank.
 
-double TankMixModel::findLIFOQuality(double vNet, double vIn, double wIn,
-                                     SegPool* segPool)
+double TankMixModel::findLIFOQuality(double vNet, double vIn, double wIn)
 {
     // ... if filling then create a new first segment
     if ( vNet > 0.0 )
     {
         // ... increase current first segment volume if inflow has same quality
         double cIn = wIn / vIn;
-        if ( firstSeg && abs(firstSeg->c - cIn ) < cTol ) firstSeg->v += vNet;
+        if ( segPool->size(segList) > 0 &&
+             abs(segPool->first(segList)->c - cIn ) < cTol )
+        {
+            segPool->first(segList)->v += vNet;
+        }
 
         // ... otherwise add a new first segment to the tank
-        else
+        else if ( !segPool->pushFront(segList, vNet, cIn) )
         {
-            Segment* seg = segPool->getSegment(vNet, cIn);
-            if ( seg == nullptr ) throw SystemError(SystemError::OUT_OF_MEMORY);
-            seg->next = firstSeg;
-            firstSeg = seg;
+            throw SystemError(SystemError::OUT_OF_MEMORY);
         }
-        cTank = firstSeg->c;
+        cTank = segPool->first(segList)->c;
     }
 
     // ... if emptying then remove first segments until vNet is reached
@@ -276,22 +319,21 @@ double TankMixModel::findLIFOQuality(double vNet, double vIn, double wIn,
         double vSum = 0.0;
         double wSum = 0.0;
         vNet = -vNet;
-        while ( vNet > 0.0 )
+        int n = segPool->size(segList);
+        Segment* seg = segPool->first(segList);
+        int consumed = 0;
+        while ( vNet > 0.0 && consumed < n )
         {
-            Segment* seg = firstSeg;
-            if ( seg == nullptr ) break;
-            double vSeg = min(seg->v, vNet);
-            if ( seg->next == nullptr ) vSeg = vNet;
+            Segment& first = seg[consumed];
+            double vSeg = min(first.v, vNet);
+            if ( consumed == n - 1 ) vSeg = vNet;
             vSum += vSeg;
-            wSum += seg->c * vSeg;
+            wSum += first.c * vSeg;
             vNet -= vSeg;
-            if ( vNet >= 0.0 && vSeg >= seg->v && seg->next )
-            {
-                firstSeg = seg->next;
-                segPool->freeSegment(seg);
-            }
-            else seg->v -= vSeg;
+            if ( vNet >= 0.0 && vSeg >= first.v && consumed < n - 1 ) consumed++;
+            else first.v -= vSeg;
         }
+        segPool->popFront(segList, consumed);
 
         // ... avg. quality released is mixture of quality in flow
         //     released and any inflow
@@ -11,10 +11,11 @@
 #ifndef TANKMIXMODEL_H_
 #define TANKMIXMODEL_H_
 
+#include <vector>
+
 class Tank;
 class QualModel;
 class SegPool;
-struct Segment;
 
 //! \class TankMixModel
 //! \brief The model used to compute mixing behavior within a storage tank.
@@ -38,9 +39,14 @@ class TankMixModel
 
     // Methods
     void   init(Tank* tank, SegPool* segPool, double _cTol);
-    double findQuality(double vNet, double vIn, double wIn, SegPool* segPool);
+    double findQuality(double vNet, double vIn, double wIn);
     double react(Tank* tank, QualModel* qualModel, double tstep);
     double storedMass();
+    double storedVolume();
+    double getInternalQuality() { return cTank; }
+    int    getSegments(std::vector<double>& v, std::vector<double>& c);
+    void   setSegments(const double* v, const double* c, int n, double cInternal,
+                       SegPool* segPool);
 
     // Properties
     int      type;           //!< type of mixing model
@@ -51,14 +57,14 @@ class TankMixModel
     // Methods
     double findMIX1Quality(double vNet, double vIn, double wIn);
     double findMIX2Quality(double vNet, double vIn, double wIn);
-    double findFIFOQuality(double vNet, double vIn, double wIn, SegPool* segPool);
-    double findLIFOQuality(double vNet, double vIn, double wIn, SegPool* segPool);
+    double findFIFOQuality(double vNet, double vIn, double wIn);
+    double findLIFOQuality(double vNet, double vIn, double wIn);
 
     // Properties
     double   cTank;          //!< internal quality within tank (mass/ft3)
     double   vMixed;         //!< mixing zone volume (ft3)
-    Segment* firstSeg;       //!< first volume segment in tank
-    Segment* lastSeg;        //!< last volume segment in tank
+    SegPool* segPool;        //!< store holding the tank's volume segments
+    int      segList;        //!< index of the tank's list in segPool
 };
 
 #endif // TANKMIXING_H_
@@ -9,6 +9,7 @@
 #include "Core/network.h"
 #include "Core/constants.h"
 #include "Core/error.h"
+#include "Core/qualengine.h"
 #include "Elements/node.h"
 #include "Elements/link.h"
 #include "Elements/pipe.h"
@@ -29,6 +30,7 @@ OutputFile::OutputFile():
     nodeCount(0),
     linkCount(0),
     pumpCount(0),
+    speciesCount(0),
     timePeriodCount(0),
     reportStart(0),
     reportStep(0),
@@ -83,20 +85,30 @@ int OutputFile::initWriter()
     linkCount = network->count(Element::LINK);
     pumpCount = findPumpCount(network);
 
+    // ... injection species are summarized by their impacts instead
+    savedSpecies.clear();
+    for (int s = 0; s < network->speciesModel.count(); s++)
+    {
+        if ( network->speciesModel.injectionOf(s) < 0 ) savedSpecies.push_back(s);
+    }
+    speciesCount = (int)savedSpecies.size();
+
     // ... retrieve reporting time steps
     timePeriodCount = 0;
     reportStart = network->option(Options::REPORT_START);
     reportStep = network->option(Options::REPORT_STEP);
 
     // ... compute byte offsets for where energy results and network results begin
-    energyResultsOffset = NumSysVars * IntSize;
+    //     (the prolog has an extra word for the species count if any are saved)
+    int sysVarCount = speciesCount > 0 ? NumSysVars + 1 : NumSysVars;
+    energyResultsOffset = sysVarCount * IntSize;
     networkResultsOffset = energyResultsOffset + pumpCount *
                            (IntSize + NumPumpVars * FloatSize) + FloatSize;
 
     // ... write system info to the output file
-    int sysBuf[NumSysVars];
+    int sysBuf[NumSysVars + 1];
     sysBuf[0] = MAGICNUMBER;
-    sysBuf[1] = VERSION;
+    sysBuf[1] = speciesCount > 0 ? SpeciesFileVersion : VERSION;
     sysBuf[2] = 0;                     // reserved for error code
     sysBuf[3] = 0;                     // reserved for warning flag
     sysBuf[4] = energyResultsOffset;
@@ -116,7 +128,8 @@ int OutputFile::initWriter()
     sysBuf[18] = NumNodeVars;
     sysBuf[19] = NumLinkVars;
     sysBuf[20] = NumPumpVars;
-    fwriter.write((char *)sysBuf, sizeof(sysBuf));
+    sysBuf[21] = speciesCount;
+    fwriter.write((char *)sysBuf, sysVarCount * IntSize);
     if ( fwriter.fail() ) return FileError::CANNOT_WRITE_TO_OUTPUT_FILE;
 
     // ... position the file to where network results begins
@@ -187,12 +200,13 @@ int OutputFile::writeEnergyResults(double totalHrs, double peakKwatts)
 
 //-----------------------------------------------------------------------------
 
-int OutputFile::writeNetworkResults()
+int OutputFile::writeNetworkResults(QualEngine* qualEngine)
 {
     if ( !fwriter.is_open() || !network ) return 0;
     timePeriodCount++;
     writeNodeResults();
     writeLinkResults();
+    if ( speciesCount > 0 ) writeSpeciesResults(qualEngine);
     if ( fwriter.fail() ) return FileError::CANNOT_WRITE_TO_OUTPUT_FILE;
     return 0;
 }
@@ -279,6 +293,28 @@ void OutputFile::writeLinkResults()
 
 //-----------------------------------------------------------------------------
 
+void OutputFile::writeSpeciesResults(QualEngine* qualEngine)
+{
+    if ( fwriter.fail() ) return;
+
+    // ... species values (already in user units) at each node, then each link
+    float x;
+    for (int objType = 0; objType < 2; objType++)
+    {
+        int n = objType == 0 ? nodeCount : linkCount;
+        for (int i = 0; i < n; i++)
+        {
+            for (int s : savedSpecies)
+            {
+                x = (float)qualEngine->getSpecies(objType, i, s);
+                fwriter.write((char *)&x, FloatSize);
+            }
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+
 //// The following set of functions reads results back from the binary output
 //// file for use when constructing a report written to a text file.
 
@@ -331,3 +367,8 @@ void OutputFile::skipLinkResults()
 {
     freader.seekg(linkCount*sizeof(linkResults), ios::cur);
 }
+
+void OutputFile::skipSpeciesResults()
+{
+    freader.seekg((nodeCount + linkCount)*speciesCount*FloatSize, ios::cur);
+}
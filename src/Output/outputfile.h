@@ -13,19 +13,29 @@
 
 #include <fstream>
 #include <string>
+#include <vector>
 
 class Network;
+class QualEngine;
 class ReportWriter;
 
 const    int   IntSize = sizeof(int);
 const    int   FloatSize = sizeof(float);
 const    int   NumSysVars = 21;
+const    int   SpeciesFileVersion = 30001;
 const    int   NumNodeVars = 6;
 const    int   NumLinkVars = 7;
 const    int   NumPumpVars = 6;
 
 //! \class OutputFile
 //! \brief Manages the writing and reading of analysis results to a binary file.
+//!
+//! When the network carries extra water quality species (other than
+//! injections) the file's version number is SpeciesFileVersion rather
+//! than VERSION and its prolog has a 22nd integer, the number of species
+//! saved. Each time period's node and link results are then followed by
+//! the value of each species at each node and then in each link. Files
+//! without species keep the original layout.
 
 class OutputFile
 {
@@ -38,7 +48,7 @@ class OutputFile
 
     int    initWriter();
     int    writeEnergyResults(double totalHrs, double peakKwatts);
-    int    writeNetworkResults();
+    int    writeNetworkResults(QualEngine* qualEngine);
 
     int    initReader();
     void   seekEnergyOffset();
@@ -49,6 +59,7 @@ class OutputFile
     void   readLinkResults();
     void   skipNodeResults();
     void   skipLinkResults();
+    void   skipSpeciesResults();
 
     friend ReportWriter;
 
@@ -60,6 +71,8 @@ class OutputFile
     int           nodeCount;                //!< number of network nodes
     int           linkCount;                //!< number of network links
     int           pumpCount;                //!< number of pump links
+    int           speciesCount;             //!< number of extra quality species saved
+    std::vector<int> savedSpecies;          //!< index of each species saved
     int           timePeriodCount;          //!< number of time periods written
     int           reportStart;              //!< time when reporting starts (sec)
     int           reportStep;               //!< time between reporting periods (sec)
@@ -70,6 +83,7 @@ class OutputFile
     float         pumpResults[NumPumpVars]; //!< array of pump results
     void          writeNodeResults();
     void          writeLinkResults();
+    void          writeSpeciesResults(QualEngine* qualEngine);
 };
 
 #endif
@@ -19,6 +19,7 @@
 #include "Elements/curve.h"
 #include "Elements/pattern.h"
 #include "Elements/control.h"
+#include "Elements/rule.h"
 #include "Elements/emitter.h"
 #include "Elements/qualsource.h"
 #include "Utilities/utilities.h"
@@ -60,11 +61,13 @@ int ProjectWriter::writeFile(const char* fname, Network* nw)
     writePatterns();
     writeCurves();
     writeControls();
+    writeRules();
     writeEnergy();
     writeQuality();
     writeSources();
     writeMixing();
     writeReactions();
+    writeSpecies();
     writeOptions();
     writeTimes();
     writeReport();
@@ -436,6 +439,17 @@ void ProjectWriter::writeControls()
 
 //-----------------------------------------------------------------------------
 
+void ProjectWriter::writeRules()
+{
+    fout << "\n[RULES]\n";
+    for (Rule* rule : network->rules)
+    {
+        fout << rule->toStr(network) << "\n";
+    }
+}
+
+//-----------------------------------------------------------------------------
+
 void ProjectWriter::writeEnergy()
 {
     fout << "\n[ENERGY]\n";
@@ -589,6 +603,67 @@ void ProjectWriter::writeTimes()
 
 //-----------------------------------------------------------------------------
 
+void ProjectWriter::writeSpecies()
+{
+    SpeciesModel& species = network->speciesModel;
+    if ( species.count() == 0 ) return;
+    fout << "\n[SPECIES]\n";
+    for (int i = 0; i < species.count(); i++)
+    {
+        if ( species.traceNode(i) >= 0 )
+        {
+            fout << "TRACE     ";
+            fout << network->node(species.traceNode(i))->name << "\n";
+            continue;
+        }
+        int j = species.injectionOf(i);
+        if ( j >= 0 )
+        {
+            int start, duration;
+            double value, rate;
+            species.getInjection(j, value, rate, start, duration);
+            fout << "INJECT    ";
+            fout << left << setw(16) << network->node(species.injectionNode(j))->name << " ";
+            fout << fixed << setprecision(4) << value << " " << rate << " ";
+            fout << start / 3600.0 << " " << duration / 3600.0 << "\n";
+            continue;
+        }
+        fout << "SPECIES   ";
+        fout << left << setw(16) << species.name(i) << " ";
+        fout << species.units(i) << "\n";
+    }
+
+    int target, s1, s2;
+    double rate;
+    for (int i = 0; i < species.termCount(); i++)
+    {
+        species.getTerm(i, target, rate, s1, s2);
+
+        // ... an injection's decay is written with the injection
+        if ( species.injectionOf(target) >= 0 && s1 == target && s2 < 0 ) continue;
+        fout << "REACTION  ";
+        fout << left << setw(16) << species.name(target) << " ";
+        fout << setw(12) << fixed << setprecision(4) << rate;
+        if ( s1 >= 0 ) fout << " " << species.name(s1);
+        if ( s2 >= 0 ) fout << " " << species.name(s2);
+        fout << "\n";
+    }
+
+    int node;
+    double value;
+    for (int i = 0; i < species.nodeValueCount(); i++)
+    {
+        species.getNodeValue(i, node, s1, value);
+        if ( species.traceNode(s1) >= 0 ) continue;
+        fout << "QUALITY   ";
+        fout << left << setw(16) << network->node(node)->name << " ";
+        fout << setw(16) << species.name(s1) << " ";
+        fout << fixed << setprecision(4) << value << "\n";
+    }
+}
+
+//-----------------------------------------------------------------------------
+
 void ProjectWriter::writeReport()
 {
     fout << "\n[REPORT]\n";
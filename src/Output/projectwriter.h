@@ -40,10 +40,12 @@ class ProjectWriter
     void writePatterns();
     void writeCurves();
     void writeControls();
+    void writeRules();
     void writeQuality();
     void writeSources();
     void writeMixing();
     void writeReactions();
+    void writeSpecies();
     void writeEnergy();
     void writeTimes();
     void writeOptions();
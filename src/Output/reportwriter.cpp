@@ -335,6 +335,7 @@ void ReportWriter::writeSavedResults(OutputFile* outFile)
             }
         }
         else outFile->skipLinkResults();
+        outFile->skipSpeciesResults();
 
         t += reportStep;
     }
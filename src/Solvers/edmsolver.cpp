@@ -0,0 +1,673 @@
+/* EPANET 3
+ *
+ * Copyright (c) 2016 Open Water Analytics
+ * Licensed under the terms of the MIT License (see the LICENSE file for details).
+ *
+ */
+
+ ////////////////////////////////////////////////////////////////////
+ //  Implementation of the Event Driven water quality solver.     //
+ ////////////////////////////////////////////////////////////////////
+
+#include "edmsolver.h"
+#include "Core/network.h"
+#include "Core/qualbalance.h"
+#include "Core/error.h"
+#include "Core/checkpoint.h"
+#include "Models/qualmodel.h"
+#include "Models/tankmixmodel.h"
+#include "Elements/qualsource.h"
+#include "Elements/junction.h"
+#include "Elements/tank.h"
+#include "Elements/pipe.h"
+
+#include <cmath>
+#include <algorithm>
+
+using namespace std;
+
+//  Number of links whose reactions make up a single parallel task
+static const int REACT_CHUNK = 256;
+
+//-----------------------------------------------------------------------------
+
+//  Constructor
+
+EDMSolver::EDMSolver(Network* nw) : QualSolver(nw)
+{
+    nodeCount = network->count(Element::NODE);
+    linkCount = network->count(Element::LINK);
+    traceNode = network->option(Options::TRACE_NODE);
+    cTol = network->option(Options::QUAL_TOLERANCE) /
+           network->ucf(Units::CONCEN);
+    qualStep = network->option(Options::QUAL_STEP);
+    if ( qualStep <= 0.0 ) qualStep = 300.0;
+    tstep = 0.0;
+    tEnd = 0.0;
+    tankTime = 0.0;
+
+    linkTime.resize(linkCount, 0.0);
+    linkEvent.resize(linkCount, -1.0);
+    nodeTime.resize(nodeCount, 0.0);
+    volRate.resize(nodeCount, 0.0);
+    massRate.resize(nodeCount, 0.0);
+    outRate.resize(nodeCount, 0.0);
+    outQual.resize(nodeCount, 0.0);
+    volIn.resize(nodeCount, 0.0);
+    massIn.resize(nodeCount, 0.0);
+    nodeMixed.resize(nodeCount, 0);
+
+    // ... list the links incident on each node
+    nodeLinkStart.assign(nodeCount + 1, 0);
+    for (Link* link : network->links)
+    {
+        nodeLinkStart[link->fromNode->index + 1]++;
+        nodeLinkStart[link->toNode->index + 1]++;
+    }
+    for (int i = 0; i < nodeCount; i++) nodeLinkStart[i+1] += nodeLinkStart[i];
+    nodeLinks.resize(nodeLinkStart[nodeCount]);
+    vector<int> next(nodeLinkStart.begin(), nodeLinkStart.end() - 1);
+    for (int k = 0; k < linkCount; k++)
+    {
+        Link* link = network->link(k);
+        nodeLinks[next[link->fromNode->index]++] = k;
+        nodeLinks[next[link->toNode->index]++] = k;
+    }
+
+    for (Node* node : network->nodes)
+    {
+        if ( node->type() == Node::TANK ) tanks.push_back(node->index);
+    }
+    threadPool.open(network->option(Options::THREADS));
+}
+
+//-----------------------------------------------------------------------------
+
+// Destructor
+
+EDMSolver::~EDMSolver()
+{
+}
+
+//-----------------------------------------------------------------------------
+
+//  Initialize water quality segments in each pipe
+
+void EDMSolver::init()
+{
+    // ... add one segment with downstream node quality to each link
+    //     that has volume (links without volume hold no segments)
+    segPool.init();
+    for (int k = 0; k < linkCount; k++)
+    {
+        segPool.newList();
+        Link* link = network->link(k);
+        double v = link->getVolume();
+        if ( v > 0.0 && !segPool.pushBack(k, v, link->toNode->quality) )
+            throw SystemError(SystemError::OUT_OF_MEMORY);
+    }
+
+    for (int i : tanks)
+    {
+        Tank* tank = static_cast<Tank *>(network->node(i));
+        tank->mixingModel.init(tank, &segPool, cTol);
+    }
+
+    for (Node* node : network->nodes) outQual[node->index] = node->quality;
+
+    // ... initialize mass balance quantities
+    updateLinkQuality();
+    network->qualBalance.init(findStoredMass());
+}
+
+//-----------------------------------------------------------------------------
+
+//  Reverse the order of the segments in a link to accommodate a flow reversal
+
+void EDMSolver::reverseFlow(int k)
+{
+    segPool.reverse(k);
+}
+
+//-----------------------------------------------------------------------------
+
+//  Solve for water quality throughout the network at the end of a time step
+//
+//  Flows are constant over the time step, so the time at which each link's
+//  leading segment will have drained is known in advance. These events are
+//  processed in time order, along with a tank update at the end of each
+//  quality step, until the end of the time step is reached.
+
+int EDMSolver::solve(int* sortedLinks, int cyclicLinks, int timeStep)
+{
+    tstep = timeStep;
+    tEnd = timeStep;
+
+    // ... react contents of each pipe and tank
+    if ( network->qualModel->isReactive() ) react();
+
+    // ... re-mix each node for the time step's flows
+    startStep(sortedLinks);
+
+    // ... process events in time order
+    double nextTankTime = tanks.empty() ? tEnd : min(qualStep, tEnd);
+    while ( true )
+    {
+        double t = events.empty() ? tEnd + 1.0 : events.top().first;
+        if ( nextTankTime < tEnd && nextTankTime <= t )
+        {
+            updateTanks(nextTankTime);
+            nextTankTime += qualStep;
+            continue;
+        }
+        if ( t > tEnd ) break;
+
+        int k = events.top().second;
+        events.pop();
+        if ( linkEvent[k] == t ) drainLink(k, t);
+    }
+    while ( !events.empty() ) events.pop();
+
+    // ... bring every link and node up to the end of the time step
+    for (int k = 0; k < linkCount; k++) moveLink(k, tEnd);
+    updateTanks(tEnd);
+    for (int i = 0; i < nodeCount; i++) accumulate(i, tEnd);
+
+    // ... find the average concentration within each link and the
+    //     mass stored in the network
+    updateLinkQuality();
+    network->qualBalance.updateStored(findStoredMass());
+    return 0;
+}
+
+//-----------------------------------------------------------------------------
+
+//  Save the segments in each pipe and tank to a checkpoint
+
+void EDMSolver::saveState(Checkpoint& cp)
+{
+    cp.peakSegCount = segPool.peakSegCount();
+    cp.peakSegMemory = segPool.peakMemoryUsed();
+    cp.segCount.clear();
+    cp.segVolume.clear();
+    cp.segQuality.clear();
+    cp.tankQuality.clear();
+
+    // ... pipe segments are listed from downstream to upstream end
+    for (int k = 0; k < linkCount; k++)
+    {
+        int n = segPool.size(k);
+        Segment* seg = segPool.first(k);
+        for (int i = 0; i < n; i++)
+        {
+            cp.segVolume.push_back(seg[i].v);
+            cp.segQuality.push_back(seg[i].c);
+        }
+        cp.segCount.push_back(n);
+    }
+
+    // ... tank segments follow those of the pipes
+    for (int i : tanks)
+    {
+        Tank* tank = static_cast<Tank *>(network->node(i));
+        int n = tank->mixingModel.getSegments(cp.segVolume, cp.segQuality);
+        cp.segCount.push_back(n);
+        cp.tankQuality.push_back(tank->mixingModel.getInternalQuality());
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+//  Rebuild the segments in each pipe and tank from a checkpoint
+
+void EDMSolver::restoreState(Checkpoint& cp)
+{
+    if ( (int)cp.segCount.size() != linkCount + (int)tanks.size() )
+        throw SystemError(SystemError::NO_CHECKPOINT);
+
+    // ... rebuild each pipe's segment list
+    segPool.init();
+    int iSeg = 0;
+    for (int k = 0; k < linkCount; k++)
+    {
+        segPool.newList();
+        for (int i = 0; i < cp.segCount[k]; i++)
+        {
+            if ( !segPool.pushBack(k, cp.segVolume[iSeg], cp.segQuality[iSeg]) )
+                throw SystemError(SystemError::OUT_OF_MEMORY);
+            iSeg++;
+        }
+    }
+
+    // ... rebuild each tank's segment list
+    for (size_t iTank = 0; iTank < tanks.size(); iTank++)
+    {
+        Tank* tank = static_cast<Tank *>(network->node(tanks[iTank]));
+        int n = cp.segCount[linkCount + iTank];
+        tank->mixingModel.setSegments(&cp.segVolume[iSeg],
+            &cp.segQuality[iSeg], n, cp.tankQuality[iTank], &segPool);
+        iSeg += n;
+    }
+    segPool.setPeaks(cp.peakSegCount, cp.peakSegMemory);
+
+    for (Node* node : network->nodes) outQual[node->index] = node->quality;
+}
+
+//-----------------------------------------------------------------------------
+
+//  Return one of the solver's segment statistics
+
+double EDMSolver::getStatistic(int type)
+{
+    switch (type)
+    {
+    case SEGMENT_COUNT:       return segPool.segCount();
+    case PEAK_SEGMENT_COUNT:  return segPool.peakSegCount();
+    case SEGMENT_MEMORY:      return (double)segPool.memoryUsed();
+    case PEAK_SEGMENT_MEMORY: return (double)segPool.peakMemoryUsed();
+    }
+    return 0.0;
+}
+
+//-----------------------------------------------------------------------------
+
+//  React the contents of each pipe and tank (in the same fixed blocks of
+//  links as the LTD solver)
+
+void EDMSolver::react()
+{
+    int pipeTasks = (linkCount + REACT_CHUNK - 1) / REACT_CHUNK;
+    int taskCount = pipeTasks + (int)tanks.size();
+    massReacted.assign(taskCount, 0.0);
+
+    threadPool.run(taskCount, [this, pipeTasks](int task)
+    {
+        if ( task < pipeTasks )
+        {
+            int first = task * REACT_CHUNK;
+            int last = min(first + REACT_CHUNK, linkCount);
+            massReacted[task] = reactPipes(first, last);
+        }
+        else
+        {
+            Tank* tank = static_cast<Tank *>(network->node(tanks[task - pipeTasks]));
+            massReacted[task] =
+                tank->mixingModel.react(tank, network->qualModel, tstep);
+        }
+    });
+
+    for (double mass : massReacted) network->qualBalance.updateReacted(mass);
+}
+
+//-----------------------------------------------------------------------------
+
+//  React the contents of links first to last-1 and return the mass reacted
+
+double EDMSolver::reactPipes(int first, int last)
+{
+    double mass = 0.0;
+    for (int i = first; i < last; i++)
+    {
+        Link* link = network->link(i);
+        if ( link->type() != Link::PIPE ) continue;
+        Pipe* pipe = static_cast<Pipe *>(link);
+
+        network->qualModel->findReactFactors(pipe, tstep);
+        int n = segPool.size(i);
+        Segment* seg = segPool.first(i);
+        for (int j = 0; j < n; j++)
+        {
+            double c = seg[j].c;
+            seg[j].c = network->qualModel->pipeReact(pipe, c, tstep);
+            mass += (c - seg[j].c) * seg[j].v;
+        }
+    }
+    return mass;
+}
+
+//-----------------------------------------------------------------------------
+
+//  Set up the start of a time step
+//
+//  Each node is re-mixed for the step's flows, visiting the nodes in the
+//  topological order of the sorted links so that nodes fed through links
+//  without volume see their upstream node's new quality. Each link then
+//  starts a new segment if its inflow quality has changed, and the drain
+//  time of each link's leading segment is scheduled.
+
+void EDMSolver::startStep(int* sortedLinks)
+{
+    tankTime = 0.0;
+    fill(linkTime.begin(), linkTime.end(), 0.0);
+    fill(nodeTime.begin(), nodeTime.end(), 0.0);
+    fill(volIn.begin(), volIn.end(), 0.0);
+    fill(massIn.begin(), massIn.end(), 0.0);
+    fill(outRate.begin(), outRate.end(), 0.0);
+    fill(nodeMixed.begin(), nodeMixed.end(), 0);
+
+    for (int k = 0; k < linkCount; k++)
+    {
+        outRate[upstreamNode(k)] += abs(network->link(k)->flow);
+    }
+
+    for (int i = 0; i < linkCount; i++)
+    {
+        int j = upstreamNode(sortedLinks[i]);
+        if ( !nodeMixed[j] ) mixNode(j, 0.0);
+        nodeMixed[j] = 1;
+    }
+    for (int i = 0; i < nodeCount; i++)
+    {
+        if ( !nodeMixed[i] ) mixNode(i, 0.0);
+    }
+
+    for (int k = 0; k < linkCount; k++)
+    {
+        linkEvent[k] = -1.0;
+        if ( network->link(k)->flow == 0.0 || segPool.size(k) == 0 ) continue;
+        double c = outQual[upstreamNode(k)];
+        Segment* last = segPool.last(k);
+        if ( abs(last->c - c) >= cTol && last->c != c )
+        {
+            if ( !segPool.pushBack(k, 0.0, c) )
+                throw SystemError(SystemError::OUT_OF_MEMORY);
+        }
+        scheduleEvent(k, 0.0);
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+//  Move the water in link k forward to time t
+//
+//  The flow volume since the link was last moved is added to its last
+//  segment and taken from its first one. (A link with a single segment
+//  is left unchanged since its inflow and outflow have the same quality.)
+
+void EDMSolver::moveLink(int k, double t)
+{
+    double dt = t - linkTime[k];
+    if ( dt <= 0.0 ) return;
+    linkTime[k] = t;
+    if ( segPool.size(k) < 2 ) return;
+    double v = abs(network->link(k)->flow) * dt;
+    segPool.last(k)->v += v;
+    Segment* first = segPool.first(k);
+    first->v = max(0.0, first->v - v);
+}
+
+//-----------------------------------------------------------------------------
+
+//  Schedule the time at which link k's leading segment will have drained,
+//  given that the link was moved up to time t
+
+void EDMSolver::scheduleEvent(int k, double t)
+{
+    linkEvent[k] = -1.0;
+    double q = abs(network->link(k)->flow);
+    if ( q == 0.0 || segPool.size(k) < 2 ) return;
+    double tDrain = t + segPool.first(k)->v / q;
+    linkEvent[k] = tDrain;
+    if ( tDrain <= tEnd ) events.push(Event(tDrain, k));
+}
+
+//-----------------------------------------------------------------------------
+
+//  Remove link k's drained leading segment at time t and re-mix the node
+//  it flows into, which now receives the quality of the next segment
+
+void EDMSolver::drainLink(int k, double t)
+{
+    moveLink(k, t);
+
+    // ... any volume left over from round-off joins the next segment
+    double v = segPool.first(k)->v;
+    segPool.popFront(k, 1);
+    segPool.first(k)->v += v;
+    scheduleEvent(k, t);
+
+    int j = downstreamNode(k);
+    if ( mixNode(j, t) ) releaseNode(j, t, 0);
+}
+
+//-----------------------------------------------------------------------------
+
+//  Add node i's inflows and outflows since it was last updated up to time
+//  t to its inflow accumulators and to the mass balance
+
+void EDMSolver::accumulate(int i, double t)
+{
+    double dt = t - nodeTime[i];
+    if ( dt <= 0.0 ) return;
+    nodeTime[i] = t;
+    volIn[i] += volRate[i] * dt;
+    massIn[i] += massRate[i] * dt;
+
+    Node* node = network->node(i);
+    if ( i == traceNode )
+    {
+        network->qualBalance.updateInflow(volRate[i] * dt * node->quality);
+    }
+
+    // ... demand outflow from junctions
+    else if ( node->type() == Node::JUNCTION && node->outflow > 0.0 )
+    {
+        double vOut = min(node->outflow, volRate[i]) * dt;
+        network->qualBalance.updateOutflow(node->quality * vOut);
+    }
+
+    // ... inflow from reservoirs
+    else if ( node->type() == Node::RESERVOIR && node->outflow < 0.0 )
+    {
+        network->qualBalance.updateInflow(node->quality * (-node->outflow) * dt);
+    }
+
+    // ... mass added by a source
+    if ( node->qualSource && network->qualModel->type == QualModel::CHEM )
+    {
+        network->qualBalance.updateInflow(
+            (outQual[i] - node->quality) * outRate[i] * dt);
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+//  Re-mix the flows entering node i at time t
+//
+//  A junction's quality becomes the mixture of the leading segments of
+//  its inflow links (or the quality leaving the upstream node of a link
+//  without volume). Tanks only collect their inflow, which is mixed when
+//  the tanks are next updated. Returns true if the quality released from
+//  the node has changed.
+
+bool EDMSolver::mixNode(int i, double t)
+{
+    accumulate(i, t);
+
+    // ... find the volume & mass flow into the node
+    double vRate = 0.0;
+    double mRate = 0.0;
+    for (int p = nodeLinkStart[i]; p < nodeLinkStart[i+1]; p++)
+    {
+        int k = nodeLinks[p];
+        double q = network->link(k)->flow;
+        if ( q == 0.0 || downstreamNode(k) != i ) continue;
+        double c = outQual[upstreamNode(k)];
+        if ( segPool.size(k) > 0 ) c = segPool.first(k)->c;
+        vRate += abs(q);
+        mRate += abs(q) * c;
+    }
+    volRate[i] = vRate;
+    massRate[i] = mRate;
+
+    // ... update a junction's quality
+    Node* node = network->node(i);
+    if ( i != traceNode && node->type() == Node::JUNCTION )
+    {
+        // ... account for dilution from any external negative demand
+        if ( node->outflow < 0.0 && node->qualSource == nullptr )
+        {
+            vRate -= node->outflow;
+        }
+        if ( vRate > 0.0 ) node->quality = mRate / vRate;
+    }
+
+    // ... check if the quality released into outflow links has changed
+    double c = releaseQuality(node);
+    if ( c == outQual[i] ) return false;
+    outQual[i] = c;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+
+//  Start a new segment with node i's release quality at time t in each
+//  link leaving the node
+//
+//  Links without volume pass the new quality straight on to their
+//  downstream node (depth counts the number of such links passed through,
+//  to stop a loop of them from being followed forever).
+
+void EDMSolver::releaseNode(int i, double t, int depth)
+{
+    double c = outQual[i];
+    for (int p = nodeLinkStart[i]; p < nodeLinkStart[i+1]; p++)
+    {
+        int k = nodeLinks[p];
+        if ( network->link(k)->flow == 0.0 || upstreamNode(k) != i ) continue;
+
+        // ... a link without volume
+        if ( segPool.size(k) == 0 )
+        {
+            int j = downstreamNode(k);
+            if ( depth < nodeCount && mixNode(j, t) ) releaseNode(j, t, depth + 1);
+            continue;
+        }
+
+        // ... add a new segment to the link unless its last segment
+        //     is close enough in quality
+        moveLink(k, t);
+        Segment* last = segPool.last(k);
+        if ( abs(last->c - c) < cTol || last->c == c ) continue;
+        if ( last->v == 0.0 && segPool.size(k) > 1 ) last->c = c;
+        else
+        {
+            if ( !segPool.pushBack(k, 0.0, c) )
+                throw SystemError(SystemError::OUT_OF_MEMORY);
+            if ( segPool.size(k) == 2 ) scheduleEvent(k, t);
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+//  Update the quality of each tank at time t from the inflow it has
+//  received since the tanks were last updated
+
+void EDMSolver::updateTanks(double t)
+{
+    double dt = t - tankTime;
+    if ( dt <= 0.0 ) return;
+    tankTime = t;
+    for (int i : tanks)
+    {
+        accumulate(i, t);
+        Tank* tank = static_cast<Tank *>(network->node(i));
+        if ( i != traceNode )
+        {
+            tank->quality = tank->mixingModel.findQuality(
+                            tank->outflow * dt, volIn[i], massIn[i]);
+        }
+        volIn[i] = 0.0;
+        massIn[i] = 0.0;
+        double c = releaseQuality(tank);
+        if ( c != outQual[i] )
+        {
+            outQual[i] = c;
+            releaseNode(i, t, 0);
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+//  Find the quality of the flow a node releases into its outflow links
+
+double EDMSolver::releaseQuality(Node* node)
+{
+    if ( node->qualSource && network->qualModel->type == QualModel::CHEM )
+    {
+        return node->qualSource->getQuality(node);
+    }
+    return node->quality;
+}
+
+//-----------------------------------------------------------------------------
+
+int EDMSolver::upstreamNode(int k)
+{
+    Link* link = network->link(k);
+    if ( link->flow < 0.0 ) return link->toNode->index;
+    return link->fromNode->index;
+}
+
+//-----------------------------------------------------------------------------
+
+int EDMSolver::downstreamNode(int k)
+{
+    Link* link = network->link(k);
+    if ( link->flow < 0.0 ) return link->fromNode->index;
+    return link->toNode->index;
+}
+
+//-----------------------------------------------------------------------------
+
+//  Update the average quality in each link
+
+void EDMSolver::updateLinkQuality()
+{
+    for (int i = 0; i < linkCount; i++)
+    {
+        Link* link = network->link(i);
+        double volume = 0.0;
+        double mass = 0.0;
+
+        // ... add up volume & mass in each link segment
+        int n = segPool.size(i);
+        Segment* seg = segPool.first(i);
+        for (int j = 0; j < n; j++)
+        {
+            volume += seg[j].v;
+            mass += seg[j].c * seg[j].v;
+        }
+
+        // ... average quality is link total mass / link total volume
+        if ( volume > 0.0 ) link->quality = mass / volume;
+
+        // ... if there are no volume segments use avg. of end node quality
+        else
+        {
+            link->quality = (link->fromNode->quality +
+                             link->toNode->quality) / 2.0;
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+//  Find the mass stored in each link and tank
+
+double EDMSolver::findStoredMass()
+{
+    double totalMass = 0.0;
+    for (Link* link : network->links)
+    {
+        totalMass += link->quality * link->getVolume();
+    }
+    for (int i : tanks)
+    {
+        Tank* tank = static_cast<Tank *>(network->node(i));
+        totalMass += max(0.0, tank->mixingModel.storedMass());
+    }
+    return totalMass;
+}
@@ -0,0 +1,110 @@
+/* EPANET 3
+ *
+ * Copyright (c) 2016 Open Water Analytics
+ * Licensed under the terms of the MIT License (see the LICENSE file for details).
+ *
+ */
+
+//! \file edmsolver.h
+//! \brief Describes the EDMSolver class.
+
+#ifndef EDMSOLVER_H_
+#define EDMSOLVER_H_
+
+#include "Solvers/qualsolver.h"
+#include "Utilities/segpool.h"
+#include "Utilities/threadpool.h"
+#include <vector>
+#include <queue>
+#include <functional>
+
+class Network;
+class Node;
+
+//! \class EDMSolver
+//! \brief A water quality solver based on the Event Driven (Lagrangian) Method.
+//!
+//! Pipes hold volume segments as with the LTD solver, but instead of moving
+//! every pipe's segments at each quality step the solver works from one
+//! event to the next, where an event is the time at which the leading
+//! segment of a pipe has drained into its downstream node. Only at those
+//! times can a junction's quality change, and only then is it re-mixed and
+//! a new segment started in the pipes it feeds. Between events flows move
+//! water through the pipes without any work being done: the volume a pipe
+//! gains at its upstream end and loses at its downstream end is applied
+//! only when the pipe is next visited.
+//!
+//! Tanks are updated by their mixing models once per quality step. When
+//! the constituent doesn't react the quality engine lets the solver take a
+//! whole hydraulic time step at once, and conservative constituents are
+//! then transported exactly (up to the quality tolerance). Reactions are
+//! applied to all segments at the start of each quality step.
+
+class EDMSolver : public QualSolver
+{
+  public:
+
+    EDMSolver(Network* nw);
+    ~EDMSolver();
+
+    void   init();
+    void   reverseFlow(int k);
+    int    solve(int* sortedLinks, int cyclicLinks, int timeStep);
+    void   saveState(Checkpoint& cp);
+    void   restoreState(Checkpoint& cp);
+    double getStatistic(int type);
+    bool   isEventDriven() { return true; }
+
+  private:
+
+	typedef std::pair<double, int> Event;   // time of event & link index
+
+	int                    nodeCount;        // number of nodes
+	int                    linkCount;        // number of links
+	int                    traceNode;        // index of trace node (or -1)
+	double                 cTol;             // quality tolerance (mass/ft3)
+	double                 qualStep;         // interval between tank updates (sec)
+	double                 tstep;            // time step (sec)
+	double                 tEnd;             // end of current time step (sec)
+	double                 tankTime;         // time tanks were last updated (sec)
+
+	std::vector<int>       nodeLinkStart;    // start of each node's links
+	std::vector<int>       nodeLinks;        // links incident on each node
+
+	std::vector<double>    linkTime;         // time each link was last moved
+	std::vector<double>    linkEvent;        // time of each link's next event
+	std::vector<double>    nodeTime;         // time each node was last updated
+	std::vector<double>    volRate;          // flow into each node from links
+	std::vector<double>    massRate;         // mass flow into each node
+	std::vector<double>    outRate;          // flow out of each node into links
+	std::vector<double>    outQual;          // quality released from each node
+	std::vector<double>    volIn;            // volume inflow to each node
+	std::vector<double>    massIn;           // mass inflow to each node
+	std::vector<char>      nodeMixed;        // true if node quality updated
+
+	std::priority_queue< Event, std::vector<Event>,
+	                     std::greater<Event> > events;  // pending events
+
+	SegPool                segPool;          // segments in each link (by index) & tank
+	std::vector<int>       tanks;            // indexes of tank nodes
+	std::vector<double>    massReacted;      // mass reacted by each react task
+	ThreadPool             threadPool;       // threads that share reactions
+
+	void   react();
+	double reactPipes(int first, int last);
+	void   startStep(int* sortedLinks);
+	void   moveLink(int k, double t);
+	void   scheduleEvent(int k, double t);
+	void   drainLink(int k, double t);
+	void   accumulate(int i, double t);
+	bool   mixNode(int i, double t);
+	void   releaseNode(int i, double t, int depth);
+	void   updateTanks(double t);
+	double releaseQuality(Node* node);
+	int    upstreamNode(int k);
+	int    downstreamNode(int k);
+	void   updateLinkQuality();
+	double findStoredMass();
+};
+
+#endif
@@ -0,0 +1,512 @@
+/* EPANET 3
+ *
+ * Copyright (c) 2016 Open Water Analytics
+ * Licensed under the terms of the MIT License (see the LICENSE file for details).
+ *
+ */
+
+ ///////////////////////////////////////////////////////////////////////////
+ //  Implementation of the Eulerian Finite Volume water quality solver.  //
+ ///////////////////////////////////////////////////////////////////////////
+
+#include "efvsolver.h"
+#include "Core/network.h"
+#include "Core/qualbalance.h"
+#include "Core/error.h"
+#include "Core/checkpoint.h"
+#include "Models/qualmodel.h"
+#include "Models/tankmixmodel.h"
+#include "Elements/qualsource.h"
+#include "Elements/junction.h"
+#include "Elements/tank.h"
+#include "Elements/pipe.h"
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+using namespace std;
+
+//  Number of links whose reactions make up a single parallel task
+static const int REACT_CHUNK = 256;
+
+//-----------------------------------------------------------------------------
+
+//  Constructor
+
+EFVSolver::EFVSolver(Network* nw) : QualSolver(nw)
+{
+    nodeCount = network->count(Element::NODE);
+    linkCount = network->count(Element::LINK);
+    cellsPerPipe = network->option(Options::PIPE_CELLS);
+    volIn.resize(nodeCount, 0);
+    massIn.resize(nodeCount, 0);
+    nodeMixed.resize(nodeCount, 0);
+    cTol = network->option(Options::QUAL_TOLERANCE) /
+           network->ucf(Units::CONCEN);
+    tstep = 0.0;
+    for (Node* node : network->nodes)
+    {
+        if ( node->type() == Node::TANK ) tanks.push_back(node->index);
+    }
+    threadPool.open(network->option(Options::THREADS));
+}
+
+//-----------------------------------------------------------------------------
+
+// Destructor
+
+EFVSolver::~EFVSolver()
+{
+}
+
+//-----------------------------------------------------------------------------
+
+//  Divide each pipe into cells and initialize their quality
+
+void EFVSolver::init()
+{
+    // ... links with volume get cellsPerPipe cells, all others get none
+    cellStart.resize(linkCount + 1);
+    cellVolume.resize(linkCount);
+    cellStart[0] = 0;
+    for (int k = 0; k < linkCount; k++)
+    {
+        double v = network->link(k)->getVolume();
+        int n = (v > 0.0) ? cellsPerPipe : 0;
+        cellVolume[k] = (n > 0) ? v / n : 0.0;
+        cellStart[k+1] = cellStart[k] + n;
+    }
+
+    // ... each cell starts with its link's downstream node quality
+    try
+    {
+        cellQual.resize(cellStart[linkCount]);
+    }
+    catch (...)
+    {
+        throw SystemError(SystemError::OUT_OF_MEMORY);
+    }
+    for (int k = 0; k < linkCount; k++)
+    {
+        double c = network->link(k)->toNode->quality;
+        fill(cellQual.begin() + cellStart[k], cellQual.begin() + cellStart[k+1], c);
+    }
+
+    segPool.init();
+    for (Node* node : network->nodes)
+    {
+        if ( node->type() == Node::TANK )
+        {
+            Tank* tank = static_cast<Tank *>(node);
+            tank->mixingModel.init(tank, &segPool, cTol);
+        }
+    }
+
+    // ... initialize mass balance quantities
+    updateLinkQuality();
+    network->qualBalance.init(findStoredMass());
+}
+
+//-----------------------------------------------------------------------------
+
+//  Reverse the order of a link's cells to accommodate a flow reversal
+//  (cells are kept in order from the inlet to the outlet of the link)
+
+void EFVSolver::reverseFlow(int k)
+{
+    reverse(cellQual.begin() + cellStart[k], cellQual.begin() + cellStart[k+1]);
+}
+
+//-----------------------------------------------------------------------------
+
+//  Solve for water quality throughout the network at the end of a time step
+//
+//  Links are advected in the topological order supplied by the quality
+//  engine so that each node is mixed from the outflows of all of its
+//  inflow links before anything is released from it. The first cyclicLinks
+//  links close flow cycles and take their inflow at the quality their
+//  upstream node had at the start of the step.
+
+int EFVSolver::solve(int* sortedLinks, int cyclicLinks, int timeStep)
+{
+    tstep = timeStep;
+
+    // ... initialize node accumulators
+    memset(&volIn[0], 0, nodeCount*sizeof(double));
+    memset(&massIn[0], 0, nodeCount*sizeof(double));
+    memset(&nodeMixed[0], 0, nodeCount*sizeof(char));
+
+    // ... react contents of each pipe and tank
+    if ( network->qualModel->isReactive() ) react();
+
+    // ... advect the links that close a flow cycle
+    for (int i = 0; i < cyclicLinks; i++)
+    {
+        int k = sortedLinks[i];
+        if ( network->link(k)->flow != 0.0 ) advect(k, release(k));
+    }
+
+    // ... mix the inflows to each link's upstream node and advect
+    //     the mixture through the link into its downstream node
+    for (int i = cyclicLinks; i < linkCount; i++)
+    {
+        int k = sortedLinks[i];
+        Link* link = network->link(k);
+        if ( link->flow > 0.0 ) mixNode(link->fromNode->index);
+        else if ( link->flow < 0.0 ) mixNode(link->toNode->index);
+        else continue;
+        advect(k, release(k));
+    }
+
+    // ... update the nodes that have no outflow
+    for (int i = 0; i < nodeCount; i++) mixNode(i);
+
+    // ... find the average concentration within each link
+    updateLinkQuality();
+
+    // ... update the mass balance with mass outflows and final storage
+    updateMassBalance();
+    return 0;
+}
+
+//-----------------------------------------------------------------------------
+
+//  Save the cells in each link and the segments in each tank to a checkpoint
+
+void EFVSolver::saveState(Checkpoint& cp)
+{
+    cp.peakSegCount = segPool.peakSegCount();
+    cp.peakSegMemory = segPool.peakMemoryUsed();
+    cp.segCount.clear();
+    cp.segVolume.clear();
+    cp.segQuality.clear();
+    cp.tankQuality.clear();
+
+    // ... link cells are listed from inlet to outlet
+    for (int k = 0; k < linkCount; k++)
+    {
+        for (int i = cellStart[k]; i < cellStart[k+1]; i++)
+        {
+            cp.segVolume.push_back(cellVolume[k]);
+            cp.segQuality.push_back(cellQual[i]);
+        }
+        cp.segCount.push_back(cellStart[k+1] - cellStart[k]);
+    }
+
+    // ... tank segments follow those of the links
+    for (Node* node : network->nodes)
+    {
+        if ( node->type() == Node::TANK )
+        {
+            Tank* tank = static_cast<Tank *>(node);
+            int n = tank->mixingModel.getSegments(cp.segVolume, cp.segQuality);
+            cp.segCount.push_back(n);
+            cp.tankQuality.push_back(tank->mixingModel.getInternalQuality());
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+//  Restore the cells in each link and the segments in each tank from a
+//  checkpoint
+
+void EFVSolver::restoreState(Checkpoint& cp)
+{
+    // ... the checkpoint must hold the same cells as the solver does
+    if ( (int)cp.segCount.size() != linkCount + (int)tanks.size() )
+        throw SystemError(SystemError::NO_CHECKPOINT);
+    for (int k = 0; k < linkCount; k++)
+    {
+        if ( cp.segCount[k] != cellStart[k+1] - cellStart[k] )
+            throw SystemError(SystemError::NO_CHECKPOINT);
+    }
+
+    // ... copy each link's cell qualities
+    copy(cp.segQuality.begin(), cp.segQuality.begin() + cellStart[linkCount],
+         cellQual.begin());
+
+    // ... rebuild each tank's segment list
+    segPool.init();
+    int iSeg = cellStart[linkCount];
+    for (size_t iTank = 0; iTank < tanks.size(); iTank++)
+    {
+        Tank* tank = static_cast<Tank *>(network->node(tanks[iTank]));
+        int n = cp.segCount[linkCount + iTank];
+        tank->mixingModel.setSegments(&cp.segVolume[iSeg],
+            &cp.segQuality[iSeg], n, cp.tankQuality[iTank], &segPool);
+        iSeg += n;
+    }
+    segPool.setPeaks(cp.peakSegCount, cp.peakSegMemory);
+}
+
+//-----------------------------------------------------------------------------
+
+//  Return one of the solver's segment statistics (link cells are counted
+//  as segments along with the segments held in tanks)
+
+double EFVSolver::getStatistic(int type)
+{
+    size_t cellMemory = cellQual.capacity() * sizeof(double) +
+                        cellVolume.capacity() * sizeof(double) +
+                        cellStart.capacity() * sizeof(int);
+    switch (type)
+    {
+    case SEGMENT_COUNT:
+        return (double)cellQual.size() + segPool.segCount();
+    case PEAK_SEGMENT_COUNT:
+        return (double)cellQual.size() + segPool.peakSegCount();
+    case SEGMENT_MEMORY:
+        return (double)(cellMemory + segPool.memoryUsed());
+    case PEAK_SEGMENT_MEMORY:
+        return (double)(cellMemory + segPool.peakMemoryUsed());
+    }
+    return 0.0;
+}
+
+//-----------------------------------------------------------------------------
+
+//  React the contents of each pipe and tank
+//
+//  As with the LTD solver, pipes are reacted in fixed blocks of links and
+//  the mass reacted is summed in task order.
+
+void EFVSolver::react()
+{
+    int pipeTasks = (linkCount + REACT_CHUNK - 1) / REACT_CHUNK;
+    int taskCount = pipeTasks + (int)tanks.size();
+    massReacted.assign(taskCount, 0.0);
+
+    threadPool.run(taskCount, [this, pipeTasks](int task)
+    {
+        if ( task < pipeTasks )
+        {
+            int first = task * REACT_CHUNK;
+            int last = min(first + REACT_CHUNK, linkCount);
+            massReacted[task] = reactPipes(first, last);
+        }
+        else
+        {
+            Tank* tank = static_cast<Tank *>(network->node(tanks[task - pipeTasks]));
+            massReacted[task] =
+                tank->mixingModel.react(tank, network->qualModel, tstep);
+        }
+    });
+
+    for (double mass : massReacted) network->qualBalance.updateReacted(mass);
+}
+
+//-----------------------------------------------------------------------------
+
+//  React the cells of links first to last-1 and return the mass reacted
+
+double EFVSolver::reactPipes(int first, int last)
+{
+    double mass = 0.0;
+    for (int k = first; k < last; k++)
+    {
+        Link* link = network->link(k);
+        if ( link->type() != Link::PIPE ) continue;
+        Pipe* pipe = static_cast<Pipe *>(link);
+
+        network->qualModel->findReactFactors(pipe, tstep);
+        double cellMass = 0.0;
+        for (int i = cellStart[k]; i < cellStart[k+1]; i++)
+        {
+            double c = cellQual[i];
+            cellQual[i] = network->qualModel->pipeReact(pipe, c, tstep);
+            cellMass += c - cellQual[i];
+        }
+        mass += cellMass * cellVolume[k];
+    }
+    return mass;
+}
+
+//-----------------------------------------------------------------------------
+
+//  Find the quality of the flow released into a link from its upstream node,
+//  updating the mass balance for any source or reservoir inflow
+
+double EFVSolver::release(int k)
+{
+    Link* link = network->link(k);
+    double q = link->flow;
+    double v = abs(q) * tstep;
+
+    Node* node = link->fromNode;
+    if ( q < 0.0 ) node = link->toNode;
+    double c = node->quality;
+
+    // ... modify node quality c to include any source input
+    if ( node->qualSource && network->qualModel->type == QualModel::CHEM )
+    {
+        double c1 = c;
+        c = node->qualSource->getQuality(node);
+        network->qualBalance.updateInflow( (c - c1) * v );
+    }
+
+    // ... update mass balance with inflow from reservoirs
+    if ( node->type() == Node::RESERVOIR )
+    {
+        if ( node->outflow < 0.0 )
+            network->qualBalance.updateInflow(node->quality * (-node->outflow) * tstep);
+    }
+    return c;
+}
+
+//-----------------------------------------------------------------------------
+
+//  Advect a time step's flow volume of quality cIn through a link and add
+//  what leaves the link to its downstream node's inflow
+//
+//  With r the ratio of flow volume to cell volume, the upwind update of
+//  cell i is explicit when r <= 1:
+//      c[i] += r * (c[i-1] - c[i])
+//  and is otherwise the implicit one:
+//      c[i] = (c[i] + r * c'[i-1]) / (1 + r)
+//  where c[-1] = cIn. In either case the mass gained by the link is the
+//  flow volume times the difference between cIn and the outflow quality.
+
+void EFVSolver::advect(int k, double cIn)
+{
+    Link* link = network->link(k);
+    double q = link->flow;
+    double v = abs(q) * tstep;
+    int j = link->toNode->index;
+    if ( q < 0.0 ) j = link->fromNode->index;
+
+    int n = cellStart[k+1] - cellStart[k];
+    double cOut = cIn;
+    if ( n > 0 )
+    {
+        double* c = &cellQual[cellStart[k]];
+        double vCell = cellVolume[k];
+        if ( v <= vCell )
+        {
+            double r = v / vCell;
+            cOut = c[n-1];
+            for (int i = n - 1; i > 0; i--) c[i] += r * (c[i-1] - c[i]);
+            c[0] += r * (cIn - c[0]);
+        }
+        else
+        {
+            double a = vCell / (vCell + v);
+            double b = v / (vCell + v);
+            double cUp = cIn;
+            for (int i = 0; i < n; i++)
+            {
+                c[i] = a * c[i] + b * cUp;
+                cUp = c[i];
+            }
+            cOut = c[n-1];
+        }
+    }
+    volIn[j] += v;
+    massIn[j] += v * cOut;
+}
+
+//-----------------------------------------------------------------------------
+
+//  Update a node with the mixture concentration of its inflows (once
+//  per time step)
+
+void EFVSolver::mixNode(int i)
+{
+    if ( nodeMixed[i] ) return;
+    nodeMixed[i] = 1;
+    Node* node = network->node(i);
+
+    // ... update mass balance for TRACE quality model
+    if ( i == network->option(Options::TRACE_NODE) )
+    {
+        network->qualBalance.updateInflow(volIn[i] * node->quality);
+    }
+    else
+    {
+        if ( node->type() == Node::JUNCTION )
+        {
+            // ... account for dilution from any external negative demand
+            if (node->outflow < 0.0 && node->qualSource == nullptr )
+            {
+                volIn[i] -= node->outflow * tstep;
+            }
+
+            // ... new concen. is mass inflow / volume inflow
+            if ( volIn[i] > 0.0 ) node->quality = massIn[i] / volIn[i];
+        }
+
+        else if ( node->type() == Node::TANK )
+        {
+            Tank* tank = static_cast<Tank *> (node);
+            node->quality = tank->mixingModel.findQuality(
+                            tank->outflow * tstep, volIn[i], massIn[i]);
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+//  Update the average quality in each link
+
+void EFVSolver::updateLinkQuality()
+{
+    for (int k = 0; k < linkCount; k++)
+    {
+        Link* link = network->link(k);
+        int n = cellStart[k+1] - cellStart[k];
+
+        // ... cells have equal volumes so the average is a simple mean
+        if ( n > 0 )
+        {
+            double sum = 0.0;
+            for (int i = cellStart[k]; i < cellStart[k+1]; i++) sum += cellQual[i];
+            link->quality = sum / n;
+        }
+
+        // ... links without cells use avg. of end node quality
+        else
+        {
+            link->quality = (link->fromNode->quality +
+                             link->toNode->quality) / 2.0;
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+//  Find the mass stored in each link and tank
+
+double EFVSolver::findStoredMass()
+{
+    double totalMass = 0.0;
+    for (Link* link : network->links)
+    {
+        totalMass += link->quality * link->getVolume();
+    }
+    for (int i : tanks)
+    {
+        Tank* tank = static_cast<Tank *>(network->node(i));
+        totalMass += max(0.0, tank->mixingModel.storedMass());
+    }
+    return totalMass;
+}
+
+//-----------------------------------------------------------------------------
+
+// Update the system's mass balance by accounting for mass outflows and storage
+
+void EFVSolver::updateMassBalance()
+{
+    for (Node* node : network->nodes)
+    {
+        if ( node->type() == Node::JUNCTION &&  node->outflow > 0.0 )
+        {
+            double vOut = node->outflow * tstep;
+            double vIn = volIn[node->index];
+            if ( vIn < vOut ) vOut = max(0.0, vIn);
+            network->qualBalance.updateOutflow(node->quality * vOut);
+        }
+    }
+    network->qualBalance.updateStored(findStoredMass());
+}
@@ -0,0 +1,76 @@
+/* EPANET 3
+ *
+ * Copyright (c) 2016 Open Water Analytics
+ * Licensed under the terms of the MIT License (see the LICENSE file for details).
+ *
+ */
+
+//! \file efvsolver.h
+//! \brief Describes the EFVSolver class.
+
+#ifndef EFVSOLVER_H_
+#define EFVSOLVER_H_
+
+#include "Solvers/qualsolver.h"
+#include "Utilities/segpool.h"
+#include "Utilities/threadpool.h"
+#include <vector>
+
+class Network;
+
+//! \class EFVSolver
+//! \brief A water quality solver based on the Eulerian Finite Volume method.
+//!
+//! Each pipe is divided into a fixed number of cells of equal volume whose
+//! concentrations are held in a single flat array, so that memory use is
+//! set once when the solver is initialized. Over a time step the cells are
+//! reacted and then advected with a first-order upwind scheme: explicit
+//! when the step's flow volume fits within one cell and implicit (which is
+//! stable for any step) when it doesn't. Links without volume, such as
+//! pumps and valves, pass their inflow straight through. Tanks are handled
+//! by their mixing models just as with the LTD solver.
+
+class EFVSolver : public QualSolver
+{
+  public:
+
+    EFVSolver(Network* nw);
+    ~EFVSolver();
+
+    void   init();
+    void   reverseFlow(int k);
+    int    solve(int* sortedLinks, int cyclicLinks, int timeStep);
+    void   saveState(Checkpoint& cp);
+    void   restoreState(Checkpoint& cp);
+    double getStatistic(int type);
+
+  private:
+	int                    nodeCount;        // number of nodes
+	int                    linkCount;        // number of links
+	int                    cellsPerPipe;     // number of cells in a pipe
+	double                 cTol;             // quality tolerance (mass/ft3)
+	double                 tstep;            // time step (sec)
+
+	std::vector<int>       cellStart;        // index of each link's first cell
+	std::vector<double>    cellVolume;       // volume of each link's cells (ft3)
+	std::vector<double>    cellQual;         // quality of each cell (mass/ft3)
+
+	std::vector<double>    volIn;            // volume inflow to each node
+	std::vector<double>    massIn;           // mass inflow to each node
+	std::vector<char>      nodeMixed;        // true if node quality updated
+	SegPool                segPool;          // segments in each tank
+	std::vector<int>       tanks;            // indexes of tank nodes
+	std::vector<double>    massReacted;      // mass reacted by each react task
+	ThreadPool             threadPool;       // threads that share reactions
+
+	void   react();
+	double reactPipes(int first, int last);
+	double release(int k);
+	void   advect(int k, double cIn);
+	void   mixNode(int i);
+	void   updateLinkQuality();
+	double findStoredMass();
+	void   updateMassBalance();
+};
+
+#endif
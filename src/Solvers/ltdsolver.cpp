@@ -13,8 +13,10 @@
 #include "Core/network.h"
 #include "Core/qualbalance.h"
 #include "Core/error.h"
+#include "Core/checkpoint.h"
 #include "Models/qualmodel.h"
 #include "Models/tankmixmodel.h"
+#include "Models/speciesmodel.h"
 #include "Elements/qualsource.h"
 #include "Elements/junction.h"
 #include "Elements/tank.h"
@@ -23,22 +25,41 @@
 #include <cmath>
 #include <cstring>
 #include <algorithm>
+#include <queue>
 
 using namespace std;
 
+//  Number of links whose reactions make up a single parallel task
+static const int REACT_CHUNK = 256;
+
+//  Number of nodes on a level that make up a single parallel task
+static const int LEVEL_CHUNK = 32;
+
+//-----------------------------------------------------------------------------
+
 //  Constructor
 
 LTDSolver::LTDSolver(Network* nw) : QualSolver(nw)
 {
     nodeCount = network->count(Element::NODE);
     linkCount = network->count(Element::LINK);
-    firstSegment.resize(linkCount, nullptr);
-    lastSegment.resize(linkCount, nullptr);
     volIn.resize(nodeCount, 0);
     massIn.resize(nodeCount, 0);
+    nodeMixed.resize(nodeCount, 0);
     cTol = network->option(Options::QUAL_TOLERANCE) /
            network->ucf(Units::CONCEN);
     tstep = 0.0;
+    for (Node* node : network->nodes)
+    {
+        if ( node->type() == Node::TANK ) tanks.push_back(node->index);
+    }
+    threadPool.open(network->option(Options::THREADS));
+    segLimit = network->option(Options::SEGMENT_LIMIT);
+    totalSegLimit = network->option(Options::TOTAL_SEGMENT_LIMIT);
+    mergeCount = 0.0;
+    speciesCount = network->speciesModel.count();
+    xTol = network->option(Options::QUAL_TOLERANCE);
+    massInSpecies.resize(nodeCount * speciesCount, 0);
 }
 
 //-----------------------------------------------------------------------------
@@ -47,8 +68,6 @@ LTDSolver::LTDSolver(Network* nw) : QualSolver(nw)
 
 LTDSolver::~LTDSolver()
 {
-    firstSegment.clear();
-    lastSegment.clear();
 }
 
 //-----------------------------------------------------------------------------
@@ -58,14 +77,17 @@ LTDSolver::~LTDSolver()
 void LTDSolver::init()
 {
     // ... add one segment with downstream node quality to each pipe
-    segPool.init();
+    //     (a link's segment list has the same index as the link)
+    segPool.init(speciesCount);
+    mergeCount = 0.0;
+    network->speciesModel.initNodeValues(nodeSpecies, nodeCount);
     for (int k = 0; k < linkCount; k++)
     {
-        firstSegment[k] = nullptr;
-        lastSegment[k] = nullptr;
+        segPool.newList();
         Link* link = network->link(k);
         double v = link->getVolume();
-        addSegment(k, v, link->toNode->quality);
+        int j = link->toNode->index;
+        if ( addSegment(k, v, link->toNode->quality, nodeValues(j)) ) mergeCount++;
     }
 
     for (Node* node : network->nodes)
@@ -88,25 +110,20 @@ void LTDSolver::init()
 
 void LTDSolver::reverseFlow(int k)
 {
-    Segment* seg = firstSegment[k];
-    firstSegment[k] = lastSegment[k];
-    lastSegment[k] = seg;
-    Segment* seg1 = nullptr;
-    Segment* seg2 = nullptr;
-    while ( seg != nullptr )
-    {
-        seg2 = seg->next;
-        seg->next = seg1;
-        seg1 = seg;
-        seg = seg2;
-    }
+    segPool.reverse(k);
 }
 
 //-----------------------------------------------------------------------------
 
 //  Solve for water quality throughout the network at the end of a time step
-
-int LTDSolver::solve(int* sortedLinks, int timeStep)
+//
+//  The links are supplied in topological order of their upstream nodes,
+//  preceded by the first cyclicLinks links, which close flow cycles. As
+//  each node's inflows are all in place before its outflow links are
+//  reached, water released into a link can pass through it and on into
+//  the links downstream within the same time step.
+
+int LTDSolver::solve(int* sortedLinks, int cyclicLinks, int timeStep)
 {
     int errCode = 0;
     tstep = timeStep;
@@ -114,19 +131,59 @@ int LTDSolver::solve(int* sortedLinks, int timeStep)
     // ... initialize node accumulators
     memset(&volIn[0], 0, nodeCount*sizeof(double));
     memset(&massIn[0], 0, nodeCount*sizeof(double));
-
-   // ... release constituent mass flow from upstream node of each link
-    for (int i = 0; i < linkCount; i++) release(sortedLinks[i]);
+    memset(&nodeMixed[0], 0, nodeCount*sizeof(char));
+    if ( speciesCount > 0 )
+    {
+        memset(&massInSpecies[0], 0, massInSpecies.size()*sizeof(double));
+    }
 
     // ... react contents of each pipe and tank
-    if ( network->qualModel->isReactive() ) react();
+    if ( network->qualModel->isReactive() ||
+         network->speciesModel.isReactive() ) react();
+
+    // ... with several threads, transport a level of nodes at a time
+    Tally tally;
+    if ( threadPool.size() > 1 ) solveLevels(sortedLinks, cyclicLinks, tally);
+    else
+    {
+        // ... links that close a flow cycle deliver their leading
+        //     segments before the nodes they flow into are mixed
+        for (int i = 0; i < cyclicLinks; i++) transport(sortedLinks[i]);
+
+        // ... mix the inflows to each link's upstream node, release
+        //     the mixture into the link and add the flow volume leaving
+        //     the link to its downstream node
+        for (int i = cyclicLinks; i < linkCount; i++)
+        {
+            int k = sortedLinks[i];
+            Link* link = network->link(k);
+            if ( link->flow > 0.0 ) mixNode(link->fromNode->index, tally);
+            else if ( link->flow < 0.0 ) mixNode(link->toNode->index, tally);
+            release(k, tally);
+            transport(k);
+        }
+
+        // ... cycle-closing links receive their release last
+        for (int i = 0; i < cyclicLinks; i++)
+        {
+            int k = sortedLinks[i];
+            Link* link = network->link(k);
+            if ( link->flow > 0.0 ) mixNode(link->fromNode->index, tally);
+            else if ( link->flow < 0.0 ) mixNode(link->toNode->index, tally);
+            release(k, tally);
+        }
 
-    // ... add mass & flow volume from each link to its downstream node
-    for (int i = 0; i < linkCount; i++) transport(sortedLinks[i]);
+        // ... update the nodes that have no outflow
+        for (int i = 0; i < nodeCount; i++) mixNode(i, tally);
+    }
+    network->qualBalance.updateInflow(tally.massIn);
+    mergeCount += tally.merges;
 
-    // ... use accumulated inflow mass and volume at each
-    //     node to update its constituent concentration
-    updateNodeQuality();
+    // ... merge segments if there are too many of them overall
+    if ( totalSegLimit > 0 && segPool.segCount() > totalSegLimit )
+    {
+        limitTotalSegments();
+    }
 
     // ... find the average concentraion within each link
     updateLinkQuality();
@@ -138,48 +195,402 @@ int LTDSolver::solve(int* sortedLinks, int timeStep)
 
 //-----------------------------------------------------------------------------
 
+//  Transport water through the network one topological level at a time,
+//  sharing each level's nodes (other than tanks) among the threads.
+//
+//  Every flowing link first has room made for the segment it will be
+//  given, so no segment list is moved while the threads are at work.
+//  Tanks, whose mixing models may add segments of their own, are updated
+//  by the calling thread once the rest of their level is done.
+
+void LTDSolver::solveLevels(int* sortedLinks, int cyclicLinks, Tally& tally)
+{
+    if ( levelsChanged(sortedLinks) ) findLevels(sortedLinks, cyclicLinks);
+
+    for (int k = 0; k < linkCount; k++)
+    {
+        if ( network->link(k)->flow != 0.0 && !segPool.reserveBack(k) )
+            throw SystemError(SystemError::OUT_OF_MEMORY);
+    }
+
+    segPool.pauseCount();
+    int levelCount = (int)levelStart.size() - 1;
+    for (int level = 0; level < levelCount; level++)
+    {
+        int first = levelStart[level];
+        int last = levelTanks[level];
+        int taskCount = (last - first + LEVEL_CHUNK - 1) / LEVEL_CHUNK;
+        tallies.assign(taskCount, Tally());
+        threadPool.run(taskCount, [this, first, last](int task)
+        {
+            int p1 = first + task * LEVEL_CHUNK;
+            int p2 = min(p1 + LEVEL_CHUNK, last);
+            for (int p = p1; p < p2; p++) updateNode(levelNodes[p], tallies[task]);
+        });
+        for (Tally& t : tallies)
+        {
+            tally.massIn += t.massIn;
+            tally.merges += t.merges;
+        }
+        for (int p = last; p < levelStart[level+1]; p++)
+        {
+            updateNode(levelNodes[p], tally);
+        }
+    }
+    segPool.resumeCount();
+
+    // ... cycle-closing links receive their release last
+    for (int i = 0; i < cyclicLinks; i++) release(sortedLinks[i], tally);
+}
+
+//-----------------------------------------------------------------------------
+
+//  Check if the sorted links or the direction of flow in any link (the
+//  things a node's level depends on) differ from when levels were found.
+
+bool LTDSolver::levelsChanged(int* sortedLinks)
+{
+    if ( (int)levelLinks.size() != linkCount ) return true;
+    for (int i = 0; i < linkCount; i++)
+    {
+        if ( sortedLinks[i] != levelLinks[i] ) return true;
+        double q = network->link(i)->flow;
+        if ( (q > 0.0) - (q < 0.0) != levelFlows[i] ) return true;
+    }
+    return false;
+}
+
+//-----------------------------------------------------------------------------
+
+//  Group the nodes by level and list the flowing links into and out of
+//  each node, in the order they appear among the sorted links.
+//
+//  The sorted links that don't close a cycle are in topological order of
+//  their upstream nodes, so each node's level is final before the links
+//  leaving it are reached.
+
+void LTDSolver::findLevels(int* sortedLinks, int cyclicLinks)
+{
+    levelLinks.assign(sortedLinks, sortedLinks + linkCount);
+    levelFlows.resize(linkCount);
+    vector<int> level(nodeCount, 0);
+    inStart.assign(nodeCount + 1, 0);
+    outStart.assign(nodeCount + 1, 0);
+
+    for (int i = 0; i < linkCount; i++)
+    {
+        int k = sortedLinks[i];
+        Link* link = network->link(k);
+        double q = link->flow;
+        levelFlows[k] = (q > 0.0) - (q < 0.0);
+        if ( q == 0.0 ) continue;
+        int n1 = link->fromNode->index;
+        int n2 = link->toNode->index;
+        if ( q < 0.0 ) swap(n1, n2);
+        inStart[n2+1]++;
+        if ( i < cyclicLinks ) continue;
+        outStart[n1+1]++;
+        level[n2] = max(level[n2], level[n1] + 1);
+    }
+
+    for (int n = 0; n < nodeCount; n++)
+    {
+        inStart[n+1] += inStart[n];
+        outStart[n+1] += outStart[n];
+    }
+    inLinks.resize(inStart[nodeCount]);
+    outLinks.resize(outStart[nodeCount]);
+    vector<int> nextIn(inStart.begin(), inStart.end() - 1);
+    vector<int> nextOut(outStart.begin(), outStart.end() - 1);
+    for (int i = 0; i < linkCount; i++)
+    {
+        int k = sortedLinks[i];
+        Link* link = network->link(k);
+        double q = link->flow;
+        if ( q == 0.0 ) continue;
+        int n1 = link->fromNode->index;
+        int n2 = link->toNode->index;
+        if ( q < 0.0 ) swap(n1, n2);
+        inLinks[nextIn[n2]++] = k;
+        if ( i >= cyclicLinks ) outLinks[nextOut[n1]++] = k;
+    }
+
+    // ... list each level's nodes with its tanks placed last
+    int levelCount = 0;
+    for (int n = 0; n < nodeCount; n++) levelCount = max(levelCount, level[n] + 1);
+    levelStart.assign(levelCount + 1, 0);
+    for (int n = 0; n < nodeCount; n++) levelStart[level[n]+1]++;
+    for (int l = 0; l < levelCount; l++) levelStart[l+1] += levelStart[l];
+    levelNodes.resize(nodeCount);
+    levelTanks.resize(levelCount);
+    vector<int> next(levelStart.begin(), levelStart.end() - 1);
+    for (int n = 0; n < nodeCount; n++)
+    {
+        if ( network->node(n)->type() != Node::TANK ) levelNodes[next[level[n]]++] = n;
+    }
+    for (int l = 0; l < levelCount; l++) levelTanks[l] = next[l];
+    for (int n = 0; n < nodeCount; n++)
+    {
+        if ( network->node(n)->type() == Node::TANK ) levelNodes[next[level[n]]++] = n;
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+//  Drain the water arriving at a node from its inflow links, mix it and
+//  release the mixture into the node's (non cycle-closing) outflow links.
+
+void LTDSolver::updateNode(int i, Tally& tally)
+{
+    for (int p = inStart[i]; p < inStart[i+1]; p++) transport(inLinks[p]);
+    mixNode(i, tally);
+    for (int p = outStart[i]; p < outStart[i+1]; p++) release(outLinks[p], tally);
+}
+
+//-----------------------------------------------------------------------------
+
+//  Save the segments in each pipe and tank to a checkpoint
+
+void LTDSolver::saveState(Checkpoint& cp)
+{
+    cp.mergeCount = mergeCount;
+    cp.peakSegCount = segPool.peakSegCount();
+    cp.peakSegMemory = segPool.peakMemoryUsed();
+    cp.segCount.clear();
+    cp.segVolume.clear();
+    cp.segQuality.clear();
+    cp.tankQuality.clear();
+    cp.segSpecies.clear();
+    cp.nodeSpecies = nodeSpecies;
+
+    // ... pipe segments are listed from downstream to upstream end
+    //     (with each segment's species values listed together)
+    for (int k = 0; k < linkCount; k++)
+    {
+        int n = segPool.size(k);
+        Segment* seg = segPool.first(k);
+        for (int i = 0; i < n; i++)
+        {
+            cp.segVolume.push_back(seg[i].v);
+            cp.segQuality.push_back(seg[i].c);
+            for (int s = 0; s < speciesCount; s++)
+            {
+                cp.segSpecies.push_back(segPool.values(k, s)[i]);
+            }
+        }
+        cp.segCount.push_back(n);
+    }
+
+    // ... tank segments follow those of the pipes
+    for (Node* node : network->nodes)
+    {
+        if ( node->type() == Node::TANK )
+        {
+            Tank* tank = static_cast<Tank *>(node);
+            int n = tank->mixingModel.getSegments(cp.segVolume, cp.segQuality);
+            cp.segCount.push_back(n);
+            cp.tankQuality.push_back(tank->mixingModel.getInternalQuality());
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+//  Rebuild the segments in each pipe and tank from a checkpoint
+
+void LTDSolver::restoreState(Checkpoint& cp)
+{
+    int tankCount = 0;
+    for (Node* node : network->nodes)
+    {
+        if ( node->type() == Node::TANK ) tankCount++;
+    }
+    if ( (int)cp.segCount.size() != linkCount + tankCount ||
+         cp.nodeSpecies.size() != nodeSpecies.size() )
+        throw SystemError(SystemError::NO_CHECKPOINT);
+
+    // ... return all current segments to the pool
+    segPool.init(speciesCount);
+    nodeSpecies = cp.nodeSpecies;
+
+    // ... rebuild each pipe's segment list
+    int iSeg = 0;
+    for (int k = 0; k < linkCount; k++)
+    {
+        segPool.newList();
+        for (int i = 0; i < cp.segCount[k]; i++)
+        {
+            const double* x = 0;
+            if ( speciesCount > 0 ) x = &cp.segSpecies[iSeg * speciesCount];
+            addSegment(k, cp.segVolume[iSeg], cp.segQuality[iSeg], x);
+            iSeg++;
+        }
+    }
+
+    // ... rebuild each tank's segment list
+    int iTank = 0;
+    for (Node* node : network->nodes)
+    {
+        if ( node->type() == Node::TANK )
+        {
+            Tank* tank = static_cast<Tank *>(node);
+            int n = cp.segCount[linkCount + iTank];
+            tank->mixingModel.setSegments(&cp.segVolume[iSeg],
+                &cp.segQuality[iSeg], n, cp.tankQuality[iTank], &segPool);
+            iSeg += n;
+            iTank++;
+        }
+    }
+
+    // ... segment statistics carry on from where the checkpoint left them
+    //     (merges made while rebuilding aren't counted)
+    mergeCount = cp.mergeCount;
+    segPool.setPeaks(cp.peakSegCount, cp.peakSegMemory);
+}
+
+//-----------------------------------------------------------------------------
+
+//  Return one of the solver's segment statistics
+
+double LTDSolver::getStatistic(int type)
+{
+    switch (type)
+    {
+    case SEGMENT_COUNT:       return segPool.segCount();
+    case PEAK_SEGMENT_COUNT:  return segPool.peakSegCount();
+    case SEGMENT_MEMORY:      return (double)segPool.memoryUsed();
+    case PEAK_SEGMENT_MEMORY: return (double)segPool.peakMemoryUsed();
+    case MERGED_SEGMENTS:     return mergeCount;
+    }
+    return 0.0;
+}
+
+//-----------------------------------------------------------------------------
+
+//  Return the value (in user units) of species s at node i
+
+double LTDSolver::getNodeSpecies(int i, int s)
+{
+    return nodeSpecies[i * speciesCount + s];
+}
+
+//-----------------------------------------------------------------------------
+
+//  Return the average value (in user units) of species s in link k
+
+double LTDSolver::getLinkSpecies(int k, int s)
+{
+    double volume = 0.0;
+    double mass = 0.0;
+    int n = segPool.size(k);
+    Segment* seg = segPool.first(k);
+    double* x = segPool.values(k, s);
+    for (int j = 0; j < n; j++)
+    {
+        volume += seg[j].v;
+        mass += x[j] * seg[j].v;
+    }
+    if ( volume > 0.0 ) return mass / volume;
+    Link* link = network->link(k);
+    return (getNodeSpecies(link->fromNode->index, s) +
+            getNodeSpecies(link->toNode->index, s)) / 2.0;
+}
+
+//-----------------------------------------------------------------------------
+
 //  React the contents of each pipe and tank
+//
+//  Pipes are reacted in fixed blocks of REACT_CHUNK links and each tank on
+//  its own, with the tasks shared among the solver's threads. The mass
+//  reacted by each task is added to the mass balance in task order so the
+//  result doesn't depend on the number of threads. Any extra species are
+//  reacted by the same tasks (a tank's species all sit in its one mixture).
 
 void LTDSolver::react()
 {
-    // ... react contents of each pipe
-    for (int i = 0; i < linkCount; i++)
+    int pipeTasks = (linkCount + REACT_CHUNK - 1) / REACT_CHUNK;
+    int taskCount = pipeTasks + (int)tanks.size();
+    massReacted.assign(taskCount, 0.0);
+
+    threadPool.run(taskCount, [this, pipeTasks](int task)
+    {
+        if ( task < pipeTasks )
+        {
+            int first = task * REACT_CHUNK;
+            int last = min(first + REACT_CHUNK, linkCount);
+            massReacted[task] = reactPipes(first, last);
+        }
+        else
+        {
+            Tank* tank = static_cast<Tank *>(network->node(tanks[task - pipeTasks]));
+            if ( network->qualModel->isReactive() )
+            {
+                massReacted[task] =
+                    tank->mixingModel.react(tank, network->qualModel, tstep);
+            }
+            if ( network->speciesModel.isReactive() )
+            {
+                vector<double*> x(speciesCount);
+                vector<double> work;
+                for (int s = 0; s < speciesCount; s++)
+                {
+                    x[s] = &nodeSpecies[tank->index * speciesCount + s];
+                }
+                network->speciesModel.react(&x[0], 1, tstep, work);
+            }
+        }
+    });
+
+    for (double mass : massReacted) network->qualBalance.updateReacted(mass);
+}
+
+//-----------------------------------------------------------------------------
+
+//  React the contents of links first to last-1 and return the mass reacted
+
+double LTDSolver::reactPipes(int first, int last)
+{
+    double mass = 0.0;
+    bool reactive = network->qualModel->isReactive();
+    bool speciesReactive = network->speciesModel.isReactive();
+    vector<double*> x(speciesCount);
+    vector<double> work;
+    for (int i = first; i < last; i++)
     {
         // ... only pipe links have reactions in them
         Link* link = network->link(i);
         if ( link->type() != Link::PIPE ) continue;
         Pipe* pipe = static_cast<Pipe *>(link);
+        int n = segPool.size(i);
 
         // ... react contents of each pipe segment
-        network->qualModel->findMassTransCoeff(pipe);
-        Segment* seg = firstSegment[i];
-        while ( seg )
+        if ( reactive )
         {
-            double c = seg->c;
-            seg->c = network->qualModel->pipeReact(pipe, seg->c, tstep);
-            network->qualBalance.updateReacted( (c - seg->c) * seg->v );
-            seg = seg->next;
+            network->qualModel->findReactFactors(pipe, tstep);
+            Segment* seg = segPool.first(i);
+            for (int j = 0; j < n; j++)
+            {
+                double c = seg[j].c;
+                seg[j].c = network->qualModel->pipeReact(pipe, c, tstep);
+                mass += (c - seg[j].c) * seg[j].v;
+            }
         }
-    }
 
-    // ... react contents of each tank
-    for (Node* node : network->nodes)
-    {
-        if ( node->type() == Node::TANK )
+        // ... react the species of all of the pipe's segments together
+        if ( speciesReactive && n > 0 )
         {
- 	        Tank * tank = static_cast<Tank *>(node);
- 	        double massReacted =
- 	            tank->mixingModel.react(tank, network->qualModel, tstep);
-            network->qualBalance.updateReacted(massReacted);
+            for (int s = 0; s < speciesCount; s++) x[s] = segPool.values(i, s);
+            network->speciesModel.react(&x[0], n, tstep, work);
         }
     }
+    return mass;
 }
 
 //-----------------------------------------------------------------------------
 
 //  Release flow volume from the upstream node of a pipe
 
-void LTDSolver::release(int k)
+void LTDSolver::release(int k, Tally& tally)
 {
     // ... find flow volume (v) released
     Link* link = network->link(k);
@@ -192,19 +603,20 @@ void LTDSolver::release(int k)
     if ( q < 0.0 ) node = link->toNode;
     double c = node->quality;
     double c1 = c;
+    double* x = nodeValues(node->index);
 
     // ... modify node quality c to include any source input
     if ( node->qualSource && network->qualModel->type == QualModel::CHEM )
     {
         c = node->qualSource->getQuality(node);
-        network->qualBalance.updateInflow( (c - c1) * v );
+        tally.massIn += (c - c1) * v;
     }
 
     // ... update mass balance with inflow from reservoirs
     if ( node->type() == Node::RESERVOIR )
     {
         if ( node->outflow < 0.0 )
-            network->qualBalance.updateInflow(c1 * (-node->outflow) * tstep);
+            tally.massIn += c1 * (-node->outflow) * tstep;
     }
 
     // ... reconcile mass balance for mass outflow from an empty tank
@@ -220,19 +632,19 @@ void LTDSolver::release(int k)
     }
 */
     // ... case where link has a last (most upstream) segment
-    Segment* seg = lastSegment[k];
-    if ( seg )
+    if ( segPool.size(k) > 0 )
     {
         // ... if node quality close to segment quality
         //     then simply increase segment volume
-        if ( abs(seg->c - c) < cTol ) seg->v += v;
+        Segment* seg = segPool.last(k);
+        if ( abs(seg->c - c) < cTol && sameSpecies(k, x) ) seg->v += v;
 
         // ... otherwise add a new segment at upstream end of link
-        else addSegment(k, v, c);
+        else if ( addSegment(k, v, c, x) ) tally.merges++;
     }
 
     // ... link has no segments so add one
-    else addSegment(k, v, c);
+    else if ( addSegment(k, v, c, x) ) tally.merges++;
 }
 
 //-----------------------------------------------------------------------------
@@ -244,6 +656,7 @@ void LTDSolver::transport(int k)
     // ... get flow rate (q) and flow volume (v)
     Link* link = network->link(k);
     double q = link->flow;
+    if ( q == 0.0 ) return;
     double v = abs(q) * tstep;
 
     // ... get index of downstream node
@@ -251,81 +664,130 @@ void LTDSolver::transport(int k)
     if ( q < 0.0 ) j = link->fromNode->index;
 
     // ... transport flow volume from leading segments into downstream
-    //     node, removing segments as their volume is consumed
-    while ( v > 0.0 )
+    //     node, counting the segments whose volume is consumed
+    int n = segPool.size(k);
+    Segment* seg = segPool.first(k);
+    int consumed = 0;
+    while ( v > 0.0 && consumed < n )
     {
-        Segment* seg = firstSegment[k];
-        if ( !seg ) break;
-
         // ... volume transported from first segment is
         //     minimum of remaining flow volume & segment volume
-        double vSeg = seg->v;
-        vSeg = min(vSeg, v);
+        Segment& first = seg[consumed];
+        double vSeg = min(first.v, v);
 
         // ... if current segment is last segment then transport
         //     remaining volume (to maintain conservation of mass)
-        if ( seg == lastSegment[k] ) vSeg = v;
+        if ( consumed == n - 1 ) vSeg = v;
 
         // ... update volume & mass entering downstream node
         volIn[j] += vSeg;
-        massIn[j] += vSeg * seg->c;
+        massIn[j] += vSeg * first.c;
+        for (int s = 0; s < speciesCount; s++)
+        {
+            massInSpecies[j*speciesCount + s] += vSeg * segPool.values(k, s)[consumed];
+        }
 
         // ... reduce remaining flow volume by amount transported
         v -= vSeg;
 
-        // ... if all of segment's volume was transferred
-        if ( v >= 0.0 && vSeg >= seg->v)
-        {
-            // ... replace this leading segment with the one behind it
-            firstSegment[k] = seg->next;
-            if ( firstSegment[k] == nullptr ) lastSegment[k] = nullptr;
-            segPool.freeSegment(seg);
-        }
+        // ... if all of segment's volume was transferred then
+        //     move on to the one behind it
+        if ( v >= 0.0 && vSeg >= first.v) consumed++;
 
         // ... otherwise just reduce this segment's volume
-        else seg->v -= vSeg;
+        else first.v -= vSeg;
     }
+    segPool.popFront(k, consumed);
 }
 
 //-----------------------------------------------------------------------------
 
-//  Update each node with the mixture concentration of its inflows
+//  Update a node with the mixture concentration of its inflows (once
+//  per time step)
 
-void LTDSolver::updateNodeQuality()
+void LTDSolver::mixNode(int i, Tally& tally)
 {
-    int traceNodeIndex = network->option(Options::TRACE_NODE);
-    for (int i = 0; i < nodeCount; i++)
+    if ( nodeMixed[i] ) return;
+    nodeMixed[i] = 1;
+    Node* node = network->node(i);
+
+    // ... volume of a tank before its inflow is mixed in
+    double vStored = 0.0;
+    if ( speciesCount > 0 && node->type() == Node::TANK )
     {
-        Node* node = network->node(i);
+        vStored = static_cast<Tank *>(node)->mixingModel.storedVolume();
+    }
 
-        // ... update mass balance for TRACE quality model
-        if ( i == traceNodeIndex )
+    // ... update mass balance for TRACE quality model
+    if ( i == network->option(Options::TRACE_NODE) )
+    {
+        tally.massIn += volIn[i] * node->quality;
+    }
+    else
+    {
+        if ( node->type() == Node::JUNCTION )
         {
-            network->qualBalance.updateInflow(volIn[i] * node->quality);
+            // ... account for dilution from any external negative demand
+            if (node->outflow < 0.0 && node->qualSource == nullptr )
+            {
+                volIn[i] -= node->outflow * tstep;
+            }
+
+            // ... new concen. is mass inflow / volume inflow
+            if ( volIn[i] > 0.0 ) node->quality = massIn[i] / volIn[i];
         }
-        else
+
+        else if ( node->type() == Node::TANK )
         {
-            if ( node->type() == Node::JUNCTION )
-            {
-                // ... account for dilution from any external negative demand
-                if (node->outflow < 0.0 && node->qualSource == nullptr )
-                {
-                    volIn[i] -= node->outflow * tstep;
-                }
+            Tank* tank = static_cast<Tank *> (node);
+            node->quality = tank->mixingModel.findQuality(
+                            tank->outflow * tstep, volIn[i], massIn[i]);
+        }
+    }
+    if ( speciesCount > 0 ) mixSpecies(i, vStored);
+}
 
-                // ... new concen. is mass inflow / volume inflow
-                if ( volIn[i] > 0.0 ) node->quality = massIn[i] / volIn[i];
-            }
+//-----------------------------------------------------------------------------
 
-            else if ( node->type() == Node::TANK )
-            {
-                Tank* tank = static_cast<Tank *> (node);
-                node->quality = tank->mixingModel.findQuality(
-                                tank->outflow * tstep, volIn[i], massIn[i], &segPool);
-            }
+//  Update a node's species values with the mixture of its inflows and the
+//  volume vStored it already holds
+//
+//  Reservoir values are fixed. So are trace species at a traced node: all
+//  of the water leaving the node is counted as coming from it, so the
+//  node's own trace stays at its initial 100 and any others at 0. Species
+//  being injected at the node take on their injected value.
 
+void LTDSolver::mixSpecies(int i, double vStored)
+{
+    SpeciesModel& species = network->speciesModel;
+    double* x = &nodeSpecies[i * speciesCount];
+    bool fixed = network->node(i)->type() == Node::RESERVOIR;
+    double vNew = vStored + volIn[i];
+    if ( !fixed && vNew > 0.0 )
+    {
+        bool traced = species.isTraced(i);
+        double* w = &massInSpecies[i * speciesCount];
+        for (int s = 0; s < speciesCount; s++)
+        {
+            if ( traced && species.traceNode(s) >= 0 ) continue;
+            x[s] = (x[s] * vStored + w[s]) / vNew;
         }
     }
+    if ( species.injectionCount() > 0 ) species.inject(i, x, fixed);
+}
+
+//-----------------------------------------------------------------------------
+
+//  Check if the species values x match those of the last segment in link k
+
+bool LTDSolver::sameSpecies(int k, const double* x)
+{
+    int last = segPool.size(k) - 1;
+    for (int s = 0; s < speciesCount; s++)
+    {
+        if ( abs(segPool.values(k, s)[last] - x[s]) >= xTol ) return false;
+    }
+    return true;
 }
 
 //-----------------------------------------------------------------------------
@@ -341,12 +803,12 @@ void LTDSolver::updateLinkQuality()
         double mass = 0.0;
 
         // ... add up volume & mass in each link segment
-        Segment* seg = firstSegment[i];
-        while ( seg )
+        int n = segPool.size(i);
+        Segment* seg = segPool.first(i);
+        for (int j = 0; j < n; j++)
         {
-            volume += seg->v;
-            mass += seg->c * seg->v;
-            seg = seg->next;
+            volume += seg[j].v;
+            mass += seg[j].c * seg[j].v;
         }
 
         // ... average quality is link total mass / link total volume
@@ -405,22 +867,88 @@ void LTDSolver::updateMassBalance()
 
 //-----------------------------------------------------------------------------
 
-//  Add a new segment to the end of a pipe
+//  Add a new segment, with species values x, to the end of a pipe
+//  (returning true if two of the pipe's segments had to be merged)
 
-void LTDSolver::addSegment(int k, double v, double c)
+bool LTDSolver::addSegment(int k, double v, double c, const double* x)
 {
     // ... do nothing if there's no volume to add
-    if ( v == 0.0 ) return;
+    if ( v == 0.0 ) return false;
 
-    // ... get an unused volume segment from the segment pool
-    Segment* seg = segPool.getSegment(v, c);
-    if ( seg == nullptr ) throw SystemError(SystemError::OUT_OF_MEMORY);
+    // ... add the new segment on to the end of the pipe's segment list
+    if ( !segPool.pushBack(k, v, c, x) )
+        throw SystemError(SystemError::OUT_OF_MEMORY);
 
-    // ... if the pipe has no segments make this its first segment
-    if ( firstSegment[k] == nullptr ) firstSegment[k] = seg;
+    // ... if the pipe now holds too many segments then merge the
+    //     pair whose merger misplaces the least mass
+    if ( segLimit > 0 && segPool.size(k) > segLimit )
+    {
+        double error;
+        segPool.merge(k, findMergePair(k, error));
+        return true;
+    }
+    return false;
+}
 
-    // ... add the new segment on to the end of the pipe's segment list
-    Segment* lastSeg = lastSegment[k];
-    if ( lastSeg ) lastSeg->next = seg;
-    lastSegment[k] = seg;
+//-----------------------------------------------------------------------------
+
+//  Find the pair of adjacent segments in link k that are best merged
+//
+//  Merging segments of volume v1 and v2 moves a mass of
+//  v1*v2/(v1+v2)*|c1-c2| from one end of the merged segment to the
+//  other, which is used as the error of the merger. Returns the index of
+//  the first segment of the pair with the least error (or -1 if the link
+//  has less than two segments) and the error in error.
+
+int LTDSolver::findMergePair(int k, double& error)
+{
+    int n = segPool.size(k);
+    Segment* seg = segPool.first(k);
+    int best = -1;
+    error = 0.0;
+    for (int i = 0; i < n - 1; i++)
+    {
+        double v = seg[i].v + seg[i+1].v;
+        double e = 0.0;
+        if ( v > 0.0 ) e = seg[i].v * seg[i+1].v / v * abs(seg[i].c - seg[i+1].c);
+        if ( best < 0 || e < error )
+        {
+            best = i;
+            error = e;
+        }
+    }
+    return best;
+}
+
+//-----------------------------------------------------------------------------
+
+//  Merge segments throughout the network, least error first, until the
+//  total segment count falls back under its limit
+//
+//  Only link segments are merged. The count is brought down to 90% of the
+//  limit so that merging isn't needed again on every time step.
+
+void LTDSolver::limitTotalSegments()
+{
+    typedef pair<double, int> MergePair;
+    priority_queue< MergePair, vector<MergePair>, greater<MergePair> > pairs;
+
+    // ... queue the best merger in each link
+    double error;
+    for (int k = 0; k < linkCount; k++)
+    {
+        if ( findMergePair(k, error) >= 0 ) pairs.push(MergePair(error, k));
+    }
+
+    // ... make the best merger left in the network and queue the next
+    //     best one in the same link
+    int target = totalSegLimit - totalSegLimit / 10;
+    while ( segPool.segCount() > target && !pairs.empty() )
+    {
+        int k = pairs.top().second;
+        pairs.pop();
+        segPool.merge(k, findMergePair(k, error));
+        mergeCount++;
+        if ( findMergePair(k, error) >= 0 ) pairs.push(MergePair(error, k));
+    }
 }
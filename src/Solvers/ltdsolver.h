@@ -13,12 +13,30 @@
 
 #include "Solvers/qualsolver.h"
 #include "Utilities/segpool.h"
+#include "Utilities/threadpool.h"
 #include <vector>
 
 class Network;
 
 //! \class LTDSolver
 //! \brief A water quality solver based on the Lagrangian Time Driven method.
+//!
+//! Along with the constituent of the network's quality model, each volume
+//! segment carries the values of any extra species defined by the network's
+//! SpeciesModel. These are transported with the segment, mixed at nodes
+//! (as if each tank were completely mixed) and reacted a whole pipe's
+//! segments at a time.
+//!
+//! When run with more than one thread, transport is carried out a level
+//! of the flow's topological order at a time. A node's level is one more
+//! than the highest level of the nodes that feed it (through links that
+//! don't close a flow cycle), so the nodes on a level neither feed nor
+//! are fed by one another. Each node pulls the water arriving from its
+//! inflow links, is mixed and releases its mixture into its outflow links,
+//! with the nodes on a level shared out among the threads. Only a node's
+//! own task adds to its volume and mass inflow, and each link is drained
+//! and filled by different levels, so the results are the same as with a
+//! single thread.
 
 class LTDSolver : public QualSolver
 {
@@ -29,7 +47,15 @@ class LTDSolver : public QualSolver
 
     void init();
     void reverseFlow(int k);
-    int  solve(int* sortedLinks, int timeStep);
+    int  solve(int* sortedLinks, int cyclicLinks, int timeStep);
+    void saveState(Checkpoint& cp);
+    void restoreState(Checkpoint& cp);
+    double getStatistic(int type);
+    bool   carriesSpecies() { return true; }
+    double getNodeSpecies(int i, int s);
+    double getLinkSpecies(int k, int s);
+    const double* getSpeciesValues()
+    { return speciesCount > 0 ? &nodeSpecies[0] : 0; }
 
   private:
 	int                    nodeCount;        // number of nodes
@@ -39,18 +65,56 @@ class LTDSolver : public QualSolver
 
 	std::vector<double>    volIn;            // volume inflow to each node
 	std::vector<double>    massIn;           // mass inflow to each node
-	std::vector<Segment *> firstSegment;     // ptr. to first segment in each link
-	std::vector<Segment *> lastSegment;      // ptr. to last segment in each link
-	SegPool                segPool;          // pool of pipe segment objects
+	std::vector<char>      nodeMixed;        // true if node quality updated
+	SegPool                segPool;          // segments in each link (by index) & tank
+	std::vector<int>       tanks;            // indexes of tank nodes
+	std::vector<double>    massReacted;      // mass reacted by each react task
+	ThreadPool             threadPool;       // threads that share reactions
+	int                    segLimit;         // max. segments per link (0 = none)
+	int                    totalSegLimit;    // max. segments overall (0 = none)
+	double                 mergeCount;       // number of segment merges made
+	int                    speciesCount;     // number of extra species
+	double                 xTol;             // species tolerance (user units)
+	std::vector<double>    nodeSpecies;      // species values at each node
+	std::vector<double>    massInSpecies;    // species mass inflow to each node
+
+	struct Tally             // mass added & segments merged by a task
+	{
+	    double massIn;
+	    double merges;
+	    Tally() : massIn(0.0), merges(0.0) { }
+	};
+
+	std::vector<int>       levelStart;       // start of each level in levelNodes
+	std::vector<int>       levelTanks;       // start of each level's tanks
+	std::vector<int>       levelNodes;       // nodes grouped by level
+	std::vector<int>       inStart;          // start of each node's inflow links
+	std::vector<int>       inLinks;          // flowing links into each node
+	std::vector<int>       outStart;         // start of each node's outflow links
+	std::vector<int>       outLinks;         // flowing acyclic links out of each node
+	std::vector<int>       levelLinks;       // sorted links the levels are for
+	std::vector<signed char> levelFlows;     // flow directions the levels are for
+	std::vector<Tally>     tallies;          // results of each level task
 
 	void   react();
-	void   release(int k);
+	double reactPipes(int first, int last);
+	void   solveLevels(int* sortedLinks, int cyclicLinks, Tally& tally);
+	bool   levelsChanged(int* sortedLinks);
+	void   findLevels(int* sortedLinks, int cyclicLinks);
+	void   updateNode(int i, Tally& tally);
+	void   release(int k, Tally& tally);
 	void   transport(int k);
-	void   updateNodeQuality();
+	void   mixNode(int i, Tally& tally);
+	void   mixSpecies(int i, double vStored);
+	bool   sameSpecies(int k, const double* x);
+	double* nodeValues(int i)
+	{ return speciesCount > 0 ? &nodeSpecies[i * speciesCount] : 0; }
 	void   updateLinkQuality();
 	double findStoredMass();
 	void   updateMassBalance();
-    void   addSegment(int k, double v, double c);
+	bool   addSegment(int k, double v, double c, const double* x = 0);
+	int    findMergePair(int k, double& error);
+	void   limitTotalSegments();
 
 };
 
@@ -9,6 +9,9 @@
 
 // Include headers for the different quality solvers here
 #include "ltdsolver.h"
+#include "efvsolver.h"
+#include "edmsolver.h"
+#include "steadysolver.h"
 
 using namespace std;
 
@@ -19,5 +22,8 @@ QualSolver::~QualSolver() {}
 QualSolver* QualSolver::factory(const string name, Network* nw)
 {
     if ( name == "LTD" ) return new LTDSolver(nw);
+    if ( name == "EFV" ) return new EFVSolver(nw);
+    if ( name == "EDM" ) return new EDMSolver(nw);
+    if ( name == "STEADY" ) return new SteadySolver(nw);
     return nullptr;
 }
@@ -16,6 +16,7 @@
 
 class Network;
 class Link;
+class Checkpoint;
 
 //! \class QualSolver
 //! \brief Abstract class from which a specific water quality solver is derived.
@@ -24,6 +25,17 @@ class QualSolver
 {
   public:
 
+    enum Statistic {
+        SEGMENT_COUNT,         //!< number of segments now in use
+        PEAK_SEGMENT_COUNT,    //!< largest number of segments in use
+        SEGMENT_MEMORY,        //!< bytes of memory held for segments
+        PEAK_SEGMENT_MEMORY,   //!< largest bytes of memory held for segments
+        MERGED_SEGMENTS,       //!< number of segment merges made
+        EQUILIBRIUM_TIME,      //!< time quality became periodic (sec, -1 if not)
+        CYCLE_CHANGE,          //!< largest quality change over the last input cycle
+        STATISTIC_COUNT
+    };
+
     // Constructor/Destructor
     QualSolver(Network* nw);
     virtual ~QualSolver();
@@ -34,7 +46,16 @@ class QualSolver
     // Public Methods
     virtual void   init() { }
     virtual void   reverseFlow(int linkIndex) { }
-    virtual int    solve(int* sortedLinks, int timeStep) = 0;
+    virtual int    solve(int* sortedLinks, int cyclicLinks, int timeStep) = 0;
+    virtual void   saveState(Checkpoint& cp) { }
+    virtual void   restoreState(Checkpoint& cp) { }
+    virtual double getStatistic(int type) { return 0.0; }
+    virtual bool   isEventDriven() { return false; }
+    virtual bool   isSteadyState() { return false; }
+    virtual bool   carriesSpecies() { return false; }
+    virtual double getNodeSpecies(int i, int s) { return 0.0; }
+    virtual double getLinkSpecies(int k, int s) { return 0.0; }
+    virtual const double* getSpeciesValues() { return 0; }
 
   protected:
     Network*     network;
@@ -0,0 +1,498 @@
+/* EPANET 3
+ *
+ * Copyright (c) 2016 Open Water Analytics
+ * Licensed under the terms of the MIT License (see the LICENSE file for details).
+ *
+ */
+
+ ////////////////////////////////////////////////////////////////////
+ //  Implementation of the steady state water quality solver.      //
+ ////////////////////////////////////////////////////////////////////
+
+#include "steadysolver.h"
+#include "Core/network.h"
+#include "Core/qualbalance.h"
+#include "Models/qualmodel.h"
+#include "Models/speciesmodel.h"
+#include "Elements/qualsource.h"
+#include "Elements/junction.h"
+#include "Elements/tank.h"
+#include "Elements/pipe.h"
+
+#include <cmath>
+#include <algorithm>
+
+using namespace std;
+
+//  Most sweeps made through a network whose flows form cycles
+static const int MAX_SWEEPS = 1000;
+
+//  Fraction of the quality tolerance allowed for the error left after
+//  the last sweep
+static const double SWEEP_ERROR = 0.1;
+
+//  Most Newton iterations used to balance a tank's inflow and reactions
+static const int MAX_NEWTON = 20;
+
+//  Interval over which reaction rates are sampled (sec)
+static const double RATE_STEP = 1.0;
+
+//-----------------------------------------------------------------------------
+
+//  Constructor
+
+SteadySolver::SteadySolver(Network* nw) : QualSolver(nw)
+{
+    nodeCount = network->count(Element::NODE);
+    linkCount = network->count(Element::LINK);
+    traceNode = network->option(Options::TRACE_NODE);
+    cTol = network->option(Options::QUAL_TOLERANCE) /
+           network->ucf(Units::CONCEN);
+    qualStep = network->option(Options::QUAL_STEP);
+    if ( qualStep <= 0.0 ) qualStep = 300.0;
+    change = 0.0;
+
+    volIn.resize(nodeCount, 0.0);
+    massIn.resize(nodeCount, 0.0);
+    nodeMixed.resize(nodeCount, 0);
+    linkIn.resize(linkCount, 0.0);
+    linkOut.resize(linkCount, 0.0);
+
+    speciesCount = network->speciesModel.count();
+    xTol = network->option(Options::QUAL_TOLERANCE);
+    massInSpecies.resize(nodeCount * speciesCount, 0.0);
+    linkInSpecies.resize(linkCount * speciesCount, 0.0);
+    linkOutSpecies.resize(linkCount * speciesCount, 0.0);
+    speciesPtrs.resize(speciesCount, 0);
+}
+
+//-----------------------------------------------------------------------------
+
+// Destructor
+
+SteadySolver::~SteadySolver()
+{
+}
+
+//-----------------------------------------------------------------------------
+
+//  Start each link off carrying the quality of its downstream node.
+
+void SteadySolver::init()
+{
+    network->speciesModel.initNodeValues(nodeSpecies, nodeCount);
+    for (int k = 0; k < linkCount; k++)
+    {
+        int j = network->link(k)->toNode->index;
+        linkIn[k] = network->node(j)->quality;
+        linkOut[k] = linkIn[k];
+        for (int s = 0; s < speciesCount; s++)
+        {
+            linkInSpecies[k*speciesCount + s] = nodeSpecies[j*speciesCount + s];
+            linkOutSpecies[k*speciesCount + s] = nodeSpecies[j*speciesCount + s];
+        }
+    }
+    updateLinkQuality();
+
+    // ... no mass is tracked over time
+    network->qualBalance.init(0.0);
+}
+
+//-----------------------------------------------------------------------------
+
+//  Find the steady state quality throughout the network for its current
+//  flows (the time step is not used).
+
+int SteadySolver::solve(int* sortedLinks, int cyclicLinks, int timeStep)
+{
+    // ... without flow cycles one sweep in topological order is exact
+    int maxSweeps = cyclicLinks > 0 ? MAX_SWEEPS : 1;
+    double lastChange = 0.0;
+    for (int n = 0; n < maxSweeps; n++)
+    {
+        sweep(sortedLinks, cyclicLinks);
+        if ( change == 0.0 ) break;
+
+        // ... changes shrinking by a ratio r leave an error of about
+        //     change * r / (1 - r) still to come
+        if ( n > 0 && change < lastChange )
+        {
+            double error = change * change / (lastChange - change);
+            if ( max(change, error) <= SWEEP_ERROR ) break;
+        }
+        lastChange = change;
+    }
+    updateLinkQuality();
+    return 0;
+}
+
+//-----------------------------------------------------------------------------
+
+//  Return the value (in user units) of species s at node i
+
+double SteadySolver::getNodeSpecies(int i, int s)
+{
+    return nodeSpecies[i * speciesCount + s];
+}
+
+//-----------------------------------------------------------------------------
+
+//  Return the average value (in user units) of species s in link k
+
+double SteadySolver::getLinkSpecies(int k, int s)
+{
+    if ( network->link(k)->flow != 0.0 )
+    {
+        return (linkInSpecies[k*speciesCount + s] +
+                linkOutSpecies[k*speciesCount + s]) / 2.0;
+    }
+    Link* link = network->link(k);
+    return (getNodeSpecies(link->fromNode->index, s) +
+            getNodeSpecies(link->toNode->index, s)) / 2.0;
+}
+
+//-----------------------------------------------------------------------------
+
+//  Make one pass through the network from its sources to its sinks.
+//
+//  Each node is mixed once all of the links that flow into it have
+//  delivered their outflow, after which its quality is released into the
+//  links it feeds. Links that close a flow cycle deliver the outflow found
+//  on the previous pass.
+
+void SteadySolver::sweep(int* sortedLinks, int cyclicLinks)
+{
+    fill(volIn.begin(), volIn.end(), 0.0);
+    fill(massIn.begin(), massIn.end(), 0.0);
+    fill(nodeMixed.begin(), nodeMixed.end(), 0);
+    fill(massInSpecies.begin(), massInSpecies.end(), 0.0);
+    change = 0.0;
+
+    for (int i = 0; i < cyclicLinks; i++) deliver(sortedLinks[i]);
+
+    for (int i = cyclicLinks; i < linkCount; i++)
+    {
+        int k = sortedLinks[i];
+        if ( network->link(k)->flow != 0.0 ) mixNode(upstreamNode(k));
+        release(k);
+        deliver(k);
+    }
+
+    // ... cycle-closing links receive their release last
+    for (int i = 0; i < cyclicLinks; i++)
+    {
+        int k = sortedLinks[i];
+        if ( network->link(k)->flow != 0.0 ) mixNode(upstreamNode(k));
+        release(k);
+    }
+
+    // ... update the nodes that have no outflow
+    for (int i = 0; i < nodeCount; i++) mixNode(i);
+}
+
+//-----------------------------------------------------------------------------
+
+//  Find the quality entering a flowing link from its upstream node and the
+//  quality leaving it after reacting over the link's travel time.
+
+void SteadySolver::release(int k)
+{
+    Link* link = network->link(k);
+    double q = abs(link->flow);
+    if ( q == 0.0 ) return;
+
+    int i = upstreamNode(k);
+    linkIn[k] = releaseQuality(network->node(i));
+    linkOut[k] = linkIn[k];
+
+    double t = link->getVolume() / q;
+    bool isPipe = link->type() == Link::PIPE;
+    if ( isPipe ) linkOut[k] = pipeReact(static_cast<Pipe*>(link), linkIn[k], t);
+
+    if ( speciesCount > 0 )
+    {
+        double* x = &linkOutSpecies[k * speciesCount];
+        for (int s = 0; s < speciesCount; s++)
+        {
+            linkInSpecies[k*speciesCount + s] = nodeSpecies[i*speciesCount + s];
+            x[s] = nodeSpecies[i*speciesCount + s];
+        }
+        if ( isPipe && network->speciesModel.isReactive() )
+        {
+            // ... integrate in sub-steps no longer than the quality step
+            //     (first order reactions are integrated exactly in one)
+            int n = 1;
+            if ( !network->speciesModel.isFirstOrder() ) n = (int)ceil(t / qualStep);
+            for (int j = 0; j < n; j++) speciesReact(x, t / n);
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+//  Add the flow and mass leaving a link to its downstream node.
+
+void SteadySolver::deliver(int k)
+{
+    double q = abs(network->link(k)->flow);
+    if ( q == 0.0 ) return;
+    int j = downstreamNode(k);
+    volIn[j] += q;
+    massIn[j] += q * linkOut[k];
+    for (int s = 0; s < speciesCount; s++)
+    {
+        massInSpecies[j*speciesCount + s] += q * linkOutSpecies[k*speciesCount + s];
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+//  Update a node with the mixture of its inflows (once per sweep).
+
+void SteadySolver::mixNode(int i)
+{
+    if ( nodeMixed[i] ) return;
+    nodeMixed[i] = 1;
+    Node* node = network->node(i);
+    double c = node->quality;
+
+    if ( i != traceNode )
+    {
+        if ( node->type() == Node::JUNCTION )
+        {
+            // ... account for dilution from any external negative demand
+            if ( node->outflow < 0.0 && node->qualSource == nullptr )
+            {
+                volIn[i] -= node->outflow;
+            }
+            if ( volIn[i] > 0.0 ) c = massIn[i] / volIn[i];
+        }
+
+        // ... a tank's residence time is its volume over its inflow
+        else if ( node->type() == Node::TANK && volIn[i] > 0.0 )
+        {
+            Tank* tank = static_cast<Tank *>(node);
+            c = tankReact(tank, massIn[i] / volIn[i], tank->volume / volIn[i]);
+        }
+    }
+
+    change = max(change, abs(c - node->quality) / cTol);
+    node->quality = c;
+    if ( speciesCount > 0 ) mixSpecies(i);
+}
+
+//-----------------------------------------------------------------------------
+
+//  Update a node's species values with the mixture of its inflows.
+//
+//  Reservoir values are fixed, as are trace species at a traced node, and
+//  species being injected at the node take on their injected value. A
+//  tank's values are balanced against their reactions over its residence
+//  time, directly when all reactions are first order and otherwise by
+//  Newton's method with a Jacobian found by finite differences.
+
+void SteadySolver::mixSpecies(int i)
+{
+    Node* node = network->node(i);
+    SpeciesModel& species = network->speciesModel;
+    int m = speciesCount;
+    double* x = &nodeSpecies[i * m];
+    if ( node->type() == Node::RESERVOIR || volIn[i] <= 0.0 )
+    {
+        if ( species.injectionCount() > 0 )
+        {
+            species.inject(i, x, node->type() == Node::RESERVOIR);
+        }
+        return;
+    }
+    bool traced = species.isTraced(i);
+
+    vector<double> xNew(m);
+    for (int s = 0; s < m; s++)
+    {
+        xNew[s] = massInSpecies[i*m + s] / volIn[i];
+        if ( traced && species.traceNode(s) >= 0 ) xNew[s] = x[s];
+    }
+
+    // ... a first order reaction k balances at x = xIn / (1 - t * k)
+    if ( node->type() == Node::TANK && species.isReactive() &&
+         species.isFirstOrder() )
+    {
+        double t = static_cast<Tank *>(node)->volume / volIn[i];
+        for (int s = 0; s < m; s++)
+        {
+            xNew[s] /= 1.0 - t * species.decayRate(s);
+        }
+    }
+
+    else if ( node->type() == Node::TANK && species.isReactive() )
+    {
+        double t = static_cast<Tank *>(node)->volume / volIn[i];
+        vector<double> xIn = xNew;
+        vector<double> f(m), r(m), jac(m * m), y(m);
+        for (int iter = 0; iter < MAX_NEWTON; iter++)
+        {
+            // ... residual f = x - xIn - t * r(x)
+            r = xNew;
+            speciesReact(&r[0], RATE_STEP);
+            for (int s = 0; s < m; s++)
+            {
+                r[s] = (r[s] - xNew[s]) / RATE_STEP;
+                f[s] = xNew[s] - xIn[s] - t * r[s];
+            }
+
+            // ... Jacobian of f, one column at a time
+            for (int c = 0; c < m; c++)
+            {
+                double h = max(1.0e-6 * abs(xNew[c]), 1.0e-9);
+                y = xNew;
+                y[c] += h;
+                speciesReact(&y[0], RATE_STEP);
+                for (int s = 0; s < m; s++)
+                {
+                    double rs = (y[s] - xNew[s] - (s == c ? h : 0.0)) / RATE_STEP;
+                    jac[s*m + c] = (s == c ? 1.0 : 0.0) - t * (rs - r[s]) / h;
+                }
+            }
+
+            // ... solve jac * dx = f by Gaussian elimination
+            for (int c = 0; c < m; c++)
+            {
+                int p = c;
+                for (int s = c + 1; s < m; s++)
+                {
+                    if ( abs(jac[s*m + c]) > abs(jac[p*m + c]) ) p = s;
+                }
+                if ( jac[p*m + c] == 0.0 ) return;
+                if ( p != c )
+                {
+                    for (int j = 0; j < m; j++) swap(jac[c*m + j], jac[p*m + j]);
+                    swap(f[c], f[p]);
+                }
+                for (int s = c + 1; s < m; s++)
+                {
+                    double a = jac[s*m + c] / jac[c*m + c];
+                    for (int j = c; j < m; j++) jac[s*m + j] -= a * jac[c*m + j];
+                    f[s] -= a * f[c];
+                }
+            }
+            double dxMax = 0.0;
+            for (int c = m - 1; c >= 0; c--)
+            {
+                for (int j = c + 1; j < m; j++) f[c] -= jac[c*m + j] * f[j];
+                f[c] /= jac[c*m + c];
+                xNew[c] = max(0.0, xNew[c] - f[c]);
+                dxMax = max(dxMax, abs(f[c]));
+            }
+            if ( dxMax <= xTol * 1.0e-3 ) break;
+        }
+    }
+
+    if ( species.injectionCount() > 0 ) species.inject(i, &xNew[0], false);
+    for (int s = 0; s < m; s++)
+    {
+        change = max(change, abs(xNew[s] - x[s]) / xTol);
+        x[s] = xNew[s];
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+//  React quality c in a pipe over a travel time of t seconds, in sub-steps
+//  no longer than the quality step.
+
+double SteadySolver::pipeReact(Pipe* pipe, double c, double t)
+{
+    QualModel* qualModel = network->qualModel;
+    if ( t <= 0.0 || !qualModel->isReactive() ) return c;
+    int n = (int)ceil(t / qualStep);
+    double dt = t / n;
+    qualModel->findReactFactors(pipe, dt);
+    for (int j = 0; j < n; j++) c = qualModel->pipeReact(pipe, c, dt);
+    return c;
+}
+
+//-----------------------------------------------------------------------------
+
+//  Find the quality c leaving a completely mixed tank, with a residence
+//  time of t seconds and inflow quality cIn, for which c = cIn + t * r(c).
+//  The reaction rate r and its slope are sampled from the quality model
+//  and the balance is solved by Newton's method (in one step when the
+//  rate is linear, as it is for water age and first order decay).
+
+double SteadySolver::tankReact(Tank* tank, double cIn, double t)
+{
+    QualModel* qualModel = network->qualModel;
+    if ( t <= 0.0 || !qualModel->isReactive() ) return cIn;
+    double c = cIn;
+    for (int iter = 0; iter < MAX_NEWTON; iter++)
+    {
+        double h = max(1.0e-6 * abs(c), 1.0e-9);
+        double r = (qualModel->tankReact(tank, c, RATE_STEP) - c) / RATE_STEP;
+        double r2 = (qualModel->tankReact(tank, c + h, RATE_STEP) - c - h) /
+                    RATE_STEP;
+        double f = c - cIn - t * r;
+        double df = 1.0 - t * (r2 - r) / h;
+        if ( df == 0.0 ) break;
+        double dc = f / df;
+        c = max(0.0, c - dc);
+        if ( abs(dc) <= cTol * 1.0e-3 ) break;
+    }
+    return c;
+}
+
+//-----------------------------------------------------------------------------
+
+//  React a single set of species values x over t seconds.
+
+void SteadySolver::speciesReact(double* x, double t)
+{
+    for (int s = 0; s < speciesCount; s++) speciesPtrs[s] = x + s;
+    network->speciesModel.react(&speciesPtrs[0], 1, t, work);
+}
+
+//-----------------------------------------------------------------------------
+
+//  Find the quality released from a node into its outflow links.
+
+double SteadySolver::releaseQuality(Node* node)
+{
+    if ( node->qualSource && network->qualModel->type == QualModel::CHEM )
+    {
+        return node->qualSource->getQuality(node);
+    }
+    return node->quality;
+}
+
+//-----------------------------------------------------------------------------
+
+int SteadySolver::upstreamNode(int k)
+{
+    Link* link = network->link(k);
+    if ( link->flow < 0.0 ) return link->toNode->index;
+    return link->fromNode->index;
+}
+
+//-----------------------------------------------------------------------------
+
+int SteadySolver::downstreamNode(int k)
+{
+    Link* link = network->link(k);
+    if ( link->flow < 0.0 ) return link->fromNode->index;
+    return link->toNode->index;
+}
+
+//-----------------------------------------------------------------------------
+
+//  Update the average quality in each link
+
+void SteadySolver::updateLinkQuality()
+{
+    for (int k = 0; k < linkCount; k++)
+    {
+        Link* link = network->link(k);
+        if ( link->flow != 0.0 ) link->quality = (linkIn[k] + linkOut[k]) / 2.0;
+        else link->quality = (link->fromNode->quality +
+                              link->toNode->quality) / 2.0;
+    }
+}
@@ -0,0 +1,101 @@
+/* EPANET 3
+ *
+ * Copyright (c) 2016 Open Water Analytics
+ * Licensed under the terms of the MIT License (see the LICENSE file for details).
+ *
+ */
+
+//! \file steadysolver.h
+//! \brief Describes the SteadySolver class.
+
+#ifndef STEADYSOLVER_H_
+#define STEADYSOLVER_H_
+
+#include "Solvers/qualsolver.h"
+#include <vector>
+
+class Network;
+class Node;
+class Pipe;
+class Tank;
+
+//! \class SteadySolver
+//! \brief A water quality solver that finds the equilibrium quality reached
+//!        under the current flows without any time stepping.
+//!
+//! If a network's flows were held fixed long enough, the quality leaving
+//! each link would be the quality entering it after reacting over the
+//! link's travel time (volume / flow), and the quality at each node would
+//! be the flow-weighted mixture of what its links deliver. A tank acts as
+//! a completely mixed reactor whose residence time is its volume divided
+//! by its inflow. For water age this gives the steady-state age directly,
+//! and for a trace the percentage of flow coming from the trace node.
+//!
+//! These balances form a linear system on the flow-directed network. The
+//! quality engine's topologically sorted links let it be solved in a single
+//! sweep from sources to sinks when the flow directions have no cycles.
+//! Otherwise sweeps are repeated, with each cyclic link delivering its
+//! previous sweep's outflow, until the error left (estimated from how fast
+//! the changes between sweeps are shrinking) is a small fraction of the
+//! quality tolerance. Any extra species are carried the same way.
+//!
+//! Reservoirs, trace nodes and tanks that receive no inflow keep their
+//! current quality. Results replace the network's quality each time the
+//! engine's solveSteadyState() is called, usually once per hydraulic
+//! period.
+
+class SteadySolver : public QualSolver
+{
+  public:
+
+    SteadySolver(Network* nw);
+    ~SteadySolver();
+
+    void   init();
+    int    solve(int* sortedLinks, int cyclicLinks, int timeStep);
+    bool   isSteadyState() { return true; }
+    bool   carriesSpecies() { return true; }
+    double getNodeSpecies(int i, int s);
+    double getLinkSpecies(int k, int s);
+    const double* getSpeciesValues()
+    { return speciesCount > 0 ? &nodeSpecies[0] : 0; }
+
+  private:
+
+	int                    nodeCount;        // number of nodes
+	int                    linkCount;        // number of links
+	int                    traceNode;        // index of trace node (or -1)
+	double                 cTol;             // quality tolerance (mass/ft3)
+	double                 qualStep;         // longest reaction sub-step (sec)
+	double                 change;           // largest change in a sweep (in tolerances)
+
+	std::vector<double>    volIn;            // flow into each node from links
+	std::vector<double>    massIn;           // mass flow into each node
+	std::vector<char>      nodeMixed;        // true if node quality updated
+	std::vector<double>    linkIn;           // quality entering each link
+	std::vector<double>    linkOut;          // quality leaving each link
+
+	int                    speciesCount;     // number of extra species
+	double                 xTol;             // species tolerance (user units)
+	std::vector<double>    nodeSpecies;      // species values at each node
+	std::vector<double>    massInSpecies;    // species mass flow into each node
+	std::vector<double>    linkInSpecies;    // species values entering each link
+	std::vector<double>    linkOutSpecies;   // species values leaving each link
+	std::vector<double*>   speciesPtrs;      // work space for reactions
+	std::vector<double>    work;             // work space for reactions
+
+	void   sweep(int* sortedLinks, int cyclicLinks);
+	void   release(int k);
+	void   deliver(int k);
+	void   mixNode(int i);
+	void   mixSpecies(int i);
+	double pipeReact(Pipe* pipe, double c, double t);
+	double tankReact(Tank* tank, double c, double t);
+	void   speciesReact(double* x, double t);
+	double releaseQuality(Node* node);
+	int    upstreamNode(int k);
+	int    downstreamNode(int k);
+	void   updateLinkQuality();
+};
+
+#endif
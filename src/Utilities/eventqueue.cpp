@@ -0,0 +1,145 @@
+/* EPANET 3
+ *
+ * Copyright (c) 2016 Open Water Analytics
+ * Licensed under the terms of the MIT License (see the LICENSE file for details).
+ *
+ */
+
+#include "eventqueue.h"
+
+using namespace std;
+
+//-----------------------------------------------------------------------------
+
+EventQueue::EventQueue()
+{}
+
+EventQueue::~EventQueue()
+{}
+
+//-----------------------------------------------------------------------------
+
+//  Size the queue for n event ids and remove any pending events.
+
+void EventQueue::init(int n)
+{
+    heap.clear();
+    heap.reserve(n);
+    position.assign(n, -1);
+    times.assign(n, 0);
+}
+
+//-----------------------------------------------------------------------------
+
+//  Remove all pending events.
+
+void EventQueue::clear()
+{
+    for (int id : heap) position[id] = -1;
+    heap.clear();
+}
+
+//-----------------------------------------------------------------------------
+
+//  Add an event to the queue or change the time of one already in it.
+
+void EventQueue::schedule(int id, int time)
+{
+    int i = position[id];
+    if ( i < 0 )
+    {
+        times[id] = time;
+        heap.push_back(id);
+        position[id] = heap.size() - 1;
+        moveUp(heap.size() - 1);
+        return;
+    }
+    int oldTime = times[id];
+    times[id] = time;
+    if ( time < oldTime ) moveUp(i);
+    else moveDown(i);
+}
+
+//-----------------------------------------------------------------------------
+
+//  Remove an event from the queue (its last scheduled time is retained).
+
+void EventQueue::cancel(int id)
+{
+    int i = position[id];
+    if ( i < 0 ) return;
+    position[id] = -1;
+    int last = heap.back();
+    heap.pop_back();
+    if ( i == (int)heap.size() ) return;
+    place(i, last);
+    moveUp(i);
+    moveDown(position[last]);
+}
+
+//-----------------------------------------------------------------------------
+
+//  Remove the earliest event from the queue.
+
+void EventQueue::pop()
+{
+    if ( heap.empty() ) return;
+    cancel(heap[0]);
+}
+
+//-----------------------------------------------------------------------------
+
+//  Check if event id1 should occur before event id2.
+
+bool EventQueue::precedes(int id1, int id2)
+{
+    if ( times[id1] != times[id2] ) return times[id1] < times[id2];
+    return id1 < id2;
+}
+
+//-----------------------------------------------------------------------------
+
+//  Put event id at position i of the heap.
+
+void EventQueue::place(int i, int id)
+{
+    heap[i] = id;
+    position[id] = i;
+}
+
+//-----------------------------------------------------------------------------
+
+//  Move the event at heap position i up towards the root.
+
+void EventQueue::moveUp(int i)
+{
+    int id = heap[i];
+    while ( i > 0 )
+    {
+        int parent = (i - 1) / 2;
+        if ( !precedes(id, heap[parent]) ) break;
+        place(i, heap[parent]);
+        i = parent;
+    }
+    place(i, id);
+}
+
+//-----------------------------------------------------------------------------
+
+//  Move the event at heap position i down towards the leaves.
+
+void EventQueue::moveDown(int i)
+{
+    int n = heap.size();
+    int id = heap[i];
+    for (;;)
+    {
+        int child = 2 * i + 1;
+        if ( child >= n ) break;
+        if ( child + 1 < n && precedes(heap[child+1], heap[child]) ) child++;
+        if ( !precedes(heap[child], id) ) break;
+        place(i, heap[child]);
+        i = child;
+    }
+    place(i, id);
+}
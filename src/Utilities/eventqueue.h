@@ -0,0 +1,57 @@
+/* EPANET 3
+ *
+ * Copyright (c) 2016 Open Water Analytics
+ * Licensed under the terms of the MIT License (see the LICENSE file for details).
+ *
+ */
+
+//! \file eventqueue.h
+//! \brief Describes the EventQueue class.
+
+#ifndef EVENTQUEUE_H_
+#define EVENTQUEUE_H_
+
+#include <vector>
+
+//! \class EventQueue
+//! \brief An indexed priority queue of timed events.
+//!
+//! Each event is identified by an integer id in [0, n) and has at most one
+//! pending occurrence time. The queue is a binary min-heap ordered by time
+//! and then by id, so events sharing the same time are always returned in
+//! order of increasing id. An event's time can be changed or cancelled in
+//! O(log n) without searching for it.
+
+class EventQueue
+{
+  public:
+
+    EventQueue();
+    ~EventQueue();
+
+    void init(int n);
+    void schedule(int id, int time);
+    void cancel(int id);
+    void pop();
+    void clear();
+
+    bool empty()             { return heap.empty(); }
+    int  size()              { return (int)heap.size(); }
+    int  topId()             { return heap[0]; }
+    int  topTime()           { return times[heap[0]]; }
+    int  timeOf(int id)      { return times[id]; }
+    bool isScheduled(int id) { return position[id] >= 0; }
+
+  private:
+
+    std::vector<int> heap;       //!< event ids arranged as a binary heap
+    std::vector<int> position;   //!< heap position of each id (-1 if none)
+    std::vector<int> times;      //!< occurrence time of each id
+
+    bool precedes(int id1, int id2);
+    void moveUp(int i);
+    void moveDown(int i);
+    void place(int i, int id);
+};
+
+#endif
@@ -15,12 +15,44 @@
 
 #include "graph.h"
 #include "Core/network.h"
+#include "Core/constants.h"
 #include "Elements/link.h"
 #include "Elements/node.h"
 
 #include <vector>
+#include <queue>
+#include <functional>
+#include <cmath>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
 using namespace std;
 
+//  Most query results cached for a set of flows
+
+static const size_t MAX_CACHED = 4096;
+
+//  Position of the lowest bit set in a non-zero word
+
+static inline int lowestBit(uint64_t bits)
+{
+#if defined(__GNUC__)
+    return __builtin_ctzll(bits);
+#elif defined(_MSC_VER)
+    unsigned long b;
+    _BitScanForward64(&b, bits);
+    return (int)b;
+#else
+    int b = 0;
+    while ( (bits & 1) == 0 )
+    {
+        bits >>= 1;
+        b++;
+    }
+    return b;
+#endif
+}
+
 //-----------------------------------------------------------------------------
 
 //  Constructor/Destructor
@@ -75,3 +107,212 @@ void Graph::createAdjLists(Network* nw)
         throw;
     }
 }
+
+//-----------------------------------------------------------------------------
+
+//  Discards the graph's adjacency lists and cached query results.
+
+void Graph::clear()
+{
+    adjLists.clear();
+    adjListBeg.clear();
+    linkNodes.clear();
+    linkFlows.clear();
+    outLinks.clear();
+    outBeg.clear();
+    inLinks.clear();
+    inBeg.clear();
+    travelTime.clear();
+    reachCache.clear();
+    timedCache.clear();
+}
+
+//-----------------------------------------------------------------------------
+
+//  Brings the flow-directed adjacency lists up to date with the network's
+//  current link flows, discarding query results the change invalidates.
+
+void Graph::updateFlows(Network* nw)
+{
+    int nodeCount = nw->count(Element::NODE);
+    int linkCount = nw->count(Element::LINK);
+
+    // ... build the nodal adjacency lists the first time through
+    if ( (int)adjListBeg.size() != nodeCount + 1 ||
+         (int)linkFlows.size() != linkCount )
+    {
+        clear();
+        createAdjLists(nw);
+        linkNodes.resize(2*linkCount);
+        for (int k = 0; k < linkCount; k++)
+        {
+            linkNodes[2*k] = nw->link(k)->fromNode->index;
+            linkNodes[2*k+1] = nw->link(k)->toNode->index;
+        }
+        linkFlows.assign(linkCount, 0.0);
+        travelTime.assign(linkCount, 0.0);
+        buildFlowLists();
+    }
+
+    // ... see if any flow has changed magnitude or direction
+    bool changed = false;
+    bool reversed = false;
+    for (int k = 0; k < linkCount; k++)
+    {
+        double q = nw->link(k)->flow;
+        double q0 = linkFlows[k];
+        if ( q == q0 ) continue;
+        changed = true;
+        if ( (q > ZERO_FLOW) != (q0 > ZERO_FLOW) ||
+             (q < -ZERO_FLOW) != (q0 < -ZERO_FLOW) ) reversed = true;
+        linkFlows[k] = q;
+        travelTime[k] = abs(q) > ZERO_FLOW ? nw->link(k)->getVolume() / abs(q) : 0.0;
+    }
+    if ( changed ) timedCache.clear();
+    if ( reversed )
+    {
+        reachCache.clear();
+        buildFlowLists();
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+//  Finds the nodes and links downstream (or upstream) of a node under the
+//  flows last passed to updateFlows(), limited to a travel time of maxTime
+//  seconds if maxTime > 0.
+
+const Graph::Reach& Graph::findReachable(int node, bool downstream, double maxTime)
+{
+    int nodeCount = (int)adjListBeg.size() - 1;
+    long long t = maxTime > 0.0 ? (long long)ceil(maxTime) : 0;
+    long long key = (t * 2 + (downstream ? 1 : 0)) * nodeCount + node;
+    auto& cache = t > 0 ? timedCache : reachCache;
+
+    auto it = cache.find(key);
+    if ( it != cache.end() ) return it->second;
+    if ( cache.size() >= MAX_CACHED ) cache.clear();
+
+    Reach& reach = cache[key];
+    if ( t > 0 ) searchTimed(node, downstream, (double)t, reach);
+    else searchAll(node, downstream, reach);
+    return reach;
+}
+
+//-----------------------------------------------------------------------------
+
+//  Sorts the links attached to each node into those with flow leaving and
+//  flow entering it.
+
+void Graph::buildFlowLists()
+{
+    int nodeCount = (int)adjListBeg.size() - 1;
+    outBeg.assign(nodeCount + 1, 0);
+    inBeg.assign(nodeCount + 1, 0);
+    outLinks.clear();
+    inLinks.clear();
+    for (int i = 0; i < nodeCount; i++)
+    {
+        for (int m = adjListBeg[i]; m < adjListBeg[i+1]; m++)
+        {
+            int k = adjLists[m];
+            double q = linkFlows[k];
+            if ( abs(q) <= ZERO_FLOW ) continue;
+            bool leaving = (linkNodes[2*k] == i) == (q > 0.0);
+            if ( leaving ) outLinks.push_back(k);
+            else inLinks.push_back(k);
+        }
+        outBeg[i+1] = (int)outLinks.size();
+        inBeg[i+1] = (int)inLinks.size();
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+//  Finds all nodes and links that can be reached from a node by following
+//  the flow (or going against it), one pass over the frontier of newly
+//  reached nodes at a time.
+
+void Graph::searchAll(int node, bool downstream, Reach& reach)
+{
+    int nodeCount = (int)adjListBeg.size() - 1;
+    size_t words = (nodeCount + 63) / 64;
+    const vector<int>& beg = downstream ? outBeg : inBeg;
+    const vector<int>& list = downstream ? outLinks : inLinks;
+
+    visited.assign(words, 0);
+    frontier.assign(words, 0);
+    visited[node / 64] |= (uint64_t)1 << (node % 64);
+    frontier[node / 64] = visited[node / 64];
+    reach.nodes.push_back(node);
+
+    bool more = true;
+    while ( more )
+    {
+        more = false;
+        nextFrontier.assign(words, 0);
+        for (size_t w = 0; w < words; w++)
+        {
+            uint64_t bits = frontier[w];
+            while ( bits )
+            {
+                int i = (int)(w * 64) + lowestBit(bits);
+                bits &= bits - 1;
+                for (int m = beg[i]; m < beg[i+1]; m++)
+                {
+                    int k = list[m];
+                    reach.links.push_back(k);
+                    int j = linkNodes[2*k] == i ? linkNodes[2*k+1] : linkNodes[2*k];
+                    uint64_t bit = (uint64_t)1 << (j % 64);
+                    if ( visited[j / 64] & bit ) continue;
+                    visited[j / 64] |= bit;
+                    nextFrontier[j / 64] |= bit;
+                    reach.nodes.push_back(j);
+                    more = true;
+                }
+            }
+        }
+        frontier.swap(nextFrontier);
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+//  Finds the nodes that can be reached from a node within maxTime seconds
+//  of travel along (or against) the flow and the links that leave (or
+//  enter) them.
+
+void Graph::searchTimed(int node, bool downstream, double maxTime, Reach& reach)
+{
+    int nodeCount = (int)adjListBeg.size() - 1;
+    const vector<int>& beg = downstream ? outBeg : inBeg;
+    const vector<int>& list = downstream ? outLinks : inLinks;
+
+    typedef pair<double, int> Item;
+    priority_queue<Item, vector<Item>, greater<Item> > pending;
+    arrival.assign(nodeCount, -1.0);
+    arrival[node] = 0.0;
+    pending.push(Item(0.0, node));
+
+    while ( !pending.empty() )
+    {
+        Item item = pending.top();
+        pending.pop();
+        int i = item.second;
+        if ( item.first > arrival[i] ) continue;
+        reach.nodes.push_back(i);
+        for (int m = beg[i]; m < beg[i+1]; m++)
+        {
+            int k = list[m];
+            reach.links.push_back(k);
+            int j = linkNodes[2*k] == i ? linkNodes[2*k+1] : linkNodes[2*k];
+            double t = item.first + travelTime[k];
+            if ( t > maxTime ) continue;
+            if ( arrival[j] < 0.0 || t < arrival[j] )
+            {
+                arrival[j] = t;
+                pending.push(Item(t, j));
+            }
+        }
+    }
+}
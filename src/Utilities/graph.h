@@ -17,8 +17,20 @@
 //! A Graph object contains data structures (e.g., adjacency lists) and
 //! algorithms (e.g., spanning tree) for describing the connectivity of
 //! a pipe network.
+//!
+//! For reachability queries the nodal adjacency lists are split, each
+//! time the network's flows change, into the links carrying flow out of
+//! and into each node along with each link's travel time (volume / flow).
+//! A query finds the nodes and links downstream (or upstream) of a node
+//! under the current flows, optionally limited to those reached within a
+//! given travel time. The start node is always among the nodes reached.
+//! Results are kept until the flows change again (or, for unbounded
+//! queries, until any flow changes direction), so repeated queries within
+//! a hydraulic period cost nothing.
 
 #include <vector>
+#include <unordered_map>
+#include <cstdint>
 
 class Network;
 
@@ -26,14 +38,45 @@ class Graph
 {
   public:
 
+    // Nodes and links found by a reachability query
+    struct Reach
+    {
+        std::vector<int> nodes;       //!< indexes of nodes reached
+        std::vector<int> links;       //!< indexes of links reached
+    };
+
     Graph();
     ~Graph();
 
     void    createAdjLists(Network* nw);
+    void    clear();
+    void    updateFlows(Network* nw);
+    const Reach& findReachable(int node, bool downstream, double maxTime);
 
   private:
     std::vector<int> adjLists;        // packed nodal adjacency lists
     std::vector<int> adjListBeg;      // starting index of each node's list
+
+    // Flow-directed adjacency for the current flows
+    std::vector<int>     linkNodes;   // start & end node of each link
+    std::vector<double>  linkFlows;   // flows the adjacency was built for
+    std::vector<int>     outLinks;    // packed lists of links leaving each node
+    std::vector<int>     outBeg;      // starting index of each node's out list
+    std::vector<int>     inLinks;     // packed lists of links entering each node
+    std::vector<int>     inBeg;       // starting index of each node's in list
+    std::vector<double>  travelTime;  // travel time through each link (sec)
+
+    // Results cached for the current flows
+    std::unordered_map<long long, Reach> reachCache;  // unbounded query results
+    std::unordered_map<long long, Reach> timedCache;  // time bounded query results
+    std::vector<uint64_t>   visited;       // bitset of nodes reached
+    std::vector<uint64_t>   frontier;      // bitset of nodes reached last pass
+    std::vector<uint64_t>   nextFrontier;  // bitset of nodes reached this pass
+    std::vector<double>     arrival;       // quickest travel time to each node
+
+    void    buildFlowLists();
+    void    searchAll(int node, bool downstream, Reach& reach);
+    void    searchTimed(int node, bool downstream, double maxTime, Reach& reach);
 };
 
 #endif // GRAPH_H_
@@ -0,0 +1,116 @@
+/* EPANET 3
+ *
+ * Copyright (c) 2016 Open Water Analytics
+ * Licensed under the terms of the MIT License (see the LICENSE file for details).
+ *
+ */
+
+#include "ringbuffer.h"
+
+#include <cstring>
+#include <algorithm>
+using namespace std;
+
+//-----------------------------------------------------------------------------
+
+RingBuffer::RingBuffer() :
+    capacity(0),
+    size(0),
+    published(0)
+{}
+
+RingBuffer::~RingBuffer()
+{}
+
+//-----------------------------------------------------------------------------
+
+//  Allocate room for a given number of frames of frameSize values each.
+//  (Must not be called while consumers are reading from the buffer.)
+
+void RingBuffer::open(int capacity_, int frameSize)
+{
+    close();
+    if ( capacity_ <= 0 || frameSize <= 0 ) return;
+    capacity = capacity_;
+    size = frameSize;
+    values.assign(capacity * size, 0.0);
+    times.assign(capacity, 0);
+    vector< atomic<long> >(capacity).swap(stamps);
+    for (atomic<long>& stamp : stamps) stamp.store(0);
+    published.store(0);
+}
+
+//-----------------------------------------------------------------------------
+
+void RingBuffer::close()
+{
+    capacity = 0;
+    size = 0;
+    values.clear();
+    times.clear();
+    vector< atomic<long> >().swap(stamps);
+    published.store(0);
+}
+
+//-----------------------------------------------------------------------------
+
+//  Claim the slot for the next frame and return where its values go.
+
+double* RingBuffer::beginFrame()
+{
+    long frame = published.load(memory_order_relaxed) + 1;
+    int slot = frame % capacity;
+
+    // ... mark the slot as being written before any value is changed
+    stamps[slot].store(0, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    return &values[slot * size];
+}
+
+//-----------------------------------------------------------------------------
+
+//  Make the frame begun by beginFrame() visible to consumers.
+
+void RingBuffer::publish(int time)
+{
+    long frame = published.load(memory_order_relaxed) + 1;
+    int slot = frame % capacity;
+    times[slot] = time;
+    stamps[slot].store(frame, memory_order_release);
+    published.store(frame, memory_order_release);
+}
+
+//-----------------------------------------------------------------------------
+
+//  Copy the earliest frame still held that was published after frame
+//  afterFrame. Returns the number of the frame copied or 0 if there is
+//  no newer frame.
+
+long RingBuffer::read(long afterFrame, int* time, double* frameValues)
+{
+    if ( capacity == 0 ) return 0;
+    for (;;)
+    {
+        long last = published.load(memory_order_acquire);
+        long frame = max(afterFrame + 1, last - capacity + 1);
+        if ( frame > last ) return 0;
+
+        int slot = frame % capacity;
+        if ( stamps[slot].load(memory_order_acquire) == frame )
+        {
+            int t = times[slot];
+            memcpy(frameValues, &values[slot * size], size * sizeof(double));
+            atomic_thread_fence(memory_order_acquire);
+
+            // ... accept the copy only if the producer didn't touch the slot
+            if ( stamps[slot].load(memory_order_relaxed) == frame )
+            {
+                *time = t;
+                return frame;
+            }
+        }
+
+        // ... the frame was overwritten so try again with a newer one
+        afterFrame = frame;
+    }
+}
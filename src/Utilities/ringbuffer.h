@@ -0,0 +1,57 @@
+/* EPANET 3
+ *
+ * Copyright (c) 2016 Open Water Analytics
+ * Licensed under the terms of the MIT License (see the LICENSE file for details).
+ *
+ */
+
+//! \file ringbuffer.h
+//! \brief Describes the RingBuffer class.
+
+#ifndef RINGBUFFER_H_
+#define RINGBUFFER_H_
+
+#include <vector>
+#include <atomic>
+
+//! \class RingBuffer
+//! \brief A fixed-capacity ring of time-stamped frames of result values.
+//!
+//! Frames are written by a single producer and can be read concurrently
+//! by any number of consumers without either side waiting on a lock. The
+//! producer never blocks: once the ring is full each new frame overwrites
+//! the oldest one. Every slot carries the sequence number of the frame it
+//! holds (zero while being written) so a reader can detect a frame that
+//! was overwritten during its copy and move on to a newer one.
+
+class RingBuffer
+{
+  public:
+
+    RingBuffer();
+    ~RingBuffer();
+
+    void    open(int capacity, int frameSize);
+    void    close();
+    bool    isOpen()    { return capacity > 0; }
+    int     frameSize() { return size; }
+
+    // Producer functions
+    double* beginFrame();
+    void    publish(int time);
+
+    // Consumer functions
+    long    lastFrame() { return published.load(std::memory_order_acquire); }
+    long    read(long afterFrame, int* time, double* values);
+
+  private:
+
+    int                             capacity;  //!< number of frames held
+    int                             size;      //!< values per frame
+    std::vector<double>             values;    //!< frame values by slot
+    std::vector<int>                times;     //!< frame time by slot
+    std::vector< std::atomic<long> > stamps;   //!< frame number held by slot
+    std::atomic<long>               published; //!< number of last frame published
+};
+
+#endif
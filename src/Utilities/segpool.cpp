@@ -6,72 +6,366 @@
  */
 
 #include "segpool.h"
-#include "Utilities/mempool.h"
 
-#include <iostream>
+#include <algorithm>
+#include <new>
 
 using namespace std;
 
+//  Number of segments in the block first given to a list
+static const int INIT_CAPACITY = 4;
+
+//-----------------------------------------------------------------------------
+
+SegPool::SegPool() :
+    unused(0),
+    liveCount(0),
+    peakCount(0),
+    peakMemory(0),
+    counting(true)
+{}
+
+//-----------------------------------------------------------------------------
+
+SegPool::~SegPool()
+{}
+
 //-----------------------------------------------------------------------------
 
-SegPool::SegPool()
+//  Remove all segment lists (keeping the memory they used) and set the
+//  number of species values each segment carries.
+
+void SegPool::init(int nSpecies)
 {
-    memPool = new MemPool();
-    freeSeg = nullptr;
-    segCount = 0;
+    arena.clear();
+    lists.clear();
+    species.resize(nSpecies);
+    for (vector<double>& values : species) values.clear();
+    unused = 0;
+    liveCount = 0;
+    peakCount = 0;
+    peakMemory = memoryUsed();
+    counting = true;
 }
 
 //-----------------------------------------------------------------------------
 
-SegPool::~SegPool()
+//  Create a new empty segment list and return its index.
+
+int SegPool::newList()
+{
+    SegList list;
+    list.base = (int)arena.size();
+    list.capacity = INIT_CAPACITY;
+    list.head = 0;
+    list.tail = 0;
+    resizeArena(list.base + INIT_CAPACITY);
+    lists.push_back(list);
+    peakMemory = max(peakMemory, memoryUsed());
+    return (int)lists.size() - 1;
+}
+
+//-----------------------------------------------------------------------------
+
+//  Add a segment after the last one in a list, with species values x
+//  (or zeros if x is null). Returns false if there's not enough memory.
+
+bool SegPool::pushBack(int list, double v, double c, const double* x)
 {
-//    cout << "\n segCount = " << segCount << "\n";
+    if ( lists[list].tail == lists[list].capacity && !makeRoom(list, false) )
+        return false;
+    SegList& s = lists[list];
+    Segment& seg = arena[s.base + s.tail];
+    seg.v = v;
+    seg.c = c;
+    setValues(s.base + s.tail, x);
+    s.tail++;
+    addCount(1);
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+
+//  Add a segment ahead of the first one in a list, with species values x
+//  (or zeros if x is null). Returns false if there's not enough memory.
 
-    delete memPool;
+bool SegPool::pushFront(int list, double v, double c, const double* x)
+{
+    if ( lists[list].head == 0 && !makeRoom(list, true) ) return false;
+    SegList& s = lists[list];
+    s.head--;
+    Segment& seg = arena[s.base + s.head];
+    seg.v = v;
+    seg.c = c;
+    setValues(s.base + s.head, x);
+    addCount(1);
+    return true;
 }
 
 //-----------------------------------------------------------------------------
 
-void SegPool::init()
+//  Remove the first n segments from a list.
+
+void SegPool::popFront(int list, int n)
 {
-    segCount = 0;
-    memPool->reset();
-    freeSeg = nullptr;
+    SegList& s = lists[list];
+    n = min(n, s.tail - s.head);
+    addCount(-n);
+    s.head += n;
+    if ( s.head == s.tail ) s.head = s.tail = 0;
 }
 
 //-----------------------------------------------------------------------------
 
-Segment* SegPool::getSegment(double v, double c)
+void SegPool::clear(int list)
 {
-    // ... if there's a free segment available then use it
-    Segment* seg;
-    if ( freeSeg )
+    addCount(-size(list));
+    lists[list].head = 0;
+    lists[list].tail = 0;
+}
+
+//-----------------------------------------------------------------------------
+
+//  Reverse the order of the segments in a list.
+
+void SegPool::reverse(int list)
+{
+    SegList& s = lists[list];
+    std::reverse(arena.begin() + s.base + s.head, arena.begin() + s.base + s.tail);
+    for (vector<double>& values : species)
     {
-       seg = freeSeg;
-       freeSeg = seg->next;
+        std::reverse(values.begin() + s.base + s.head, values.begin() + s.base + s.tail);
     }
+}
 
-    // ... otherwise create a new one from the memory pool
-    else
+//-----------------------------------------------------------------------------
+
+//  Merge the i-th segment of a list with the one behind it, giving the
+//  combined segment the mixture of their concentrations (and species
+//  values) so that no mass is gained or lost.
+
+void SegPool::merge(int list, int i)
+{
+    SegList& s = lists[list];
+    int slot = s.base + s.head + i;
+    Segment& a = arena[slot];
+    Segment& b = arena[slot + 1];
+    double v = a.v + b.v;
+    for (vector<double>& values : species)
+    {
+        double& xa = values[slot];
+        double  xb = values[slot + 1];
+        if ( v > 0.0 ) xa = (xa * a.v + xb * b.v) / v;
+        else xa = (xa + xb) / 2.0;
+    }
+    if ( v > 0.0 ) a.c = (a.c * a.v + b.c * b.v) / v;
+    else a.c = (a.c + b.c) / 2.0;
+    a.v = v;
+    moveSlots(slot + 2, s.base + s.tail, slot + 1);
+    s.tail--;
+    addCount(-1);
+}
+
+//-----------------------------------------------------------------------------
+
+//  Return the number of bytes of memory held by the pool.
+
+size_t SegPool::memoryUsed()
+{
+    size_t bytes = arena.capacity() * sizeof(Segment) +
+                   lists.capacity() * sizeof(SegList);
+    for (vector<double>& values : species)
+    {
+        bytes += values.capacity() * sizeof(double);
+    }
+    return bytes;
+}
+
+//-----------------------------------------------------------------------------
+
+//  Add n segments to the live segment count (unless counting is paused).
+
+void SegPool::addCount(int n)
+{
+    if ( !counting ) return;
+    liveCount += n;
+    peakCount = max(peakCount, liveCount);
+}
+
+//-----------------------------------------------------------------------------
+
+//  Make sure a segment can be added to the end of a list without the list
+//  having to be moved. Returns false if there's not enough memory.
+
+bool SegPool::reserveBack(int list)
+{
+    if ( lists[list].tail < lists[list].capacity ) return true;
+    return makeRoom(list, false);
+}
+
+//-----------------------------------------------------------------------------
+
+//  Stop keeping count of live segments.
+//
+//  Different lists can be updated from different threads while counting
+//  is paused, provided no list has to be moved (see reserveBack()).
+
+void SegPool::pauseCount()
+{
+    counting = false;
+}
+
+//-----------------------------------------------------------------------------
+
+//  Resume keeping count of live segments, counting those now in use (the
+//  peak count only takes in the count at this point).
+
+void SegPool::resumeCount()
+{
+    liveCount = 0;
+    for (SegList& s : lists) liveCount += s.tail - s.head;
+    peakCount = max(peakCount, liveCount);
+    counting = true;
+}
+
+//-----------------------------------------------------------------------------
+
+//  Set the peak segment count and memory used (such as those saved with a
+//  checkpoint), keeping each at least as large as its current value.
+
+void SegPool::setPeaks(int count, size_t memory)
+{
+    peakCount = max(count, liveCount);
+    peakMemory = max(memory, memoryUsed());
+}
+
+//-----------------------------------------------------------------------------
+
+//  Make room for a new segment at the front or back of a list, either by
+//  shifting its segments within its block if that's no more than half
+//  full, or else by moving them to a block twice as large. Returns false
+//  if there's not enough memory.
+
+bool SegPool::makeRoom(int list, bool atFront)
+{
+    SegList& s = lists[list];
+    int count = s.tail - s.head;
+
+    // ... shift the segments to the other end of their block
+
+    if ( 2 * count <= s.capacity )
     {
-        seg = (Segment *) memPool->alloc(sizeof(Segment));
-        segCount++;
+        int head = atFront ? s.capacity - count : 0;
+        moveSlots(s.base + s.head, s.base + s.tail, s.base + head);
+        s.head = head;
+        s.tail = head + count;
+        return true;
     }
 
-    // ... assign segment's volume and quality
-    if ( seg )
+    // ... move them to a new block at the end of the arena (leaving
+    //     the extra room at the end they are being added to)
+
+    int capacity = 2 * s.capacity;
+    int base = (int)arena.size();
+    try
+    {
+        resizeArena(base + capacity);
+    }
+    catch (bad_alloc&)
     {
-        seg->v = v;
-        seg->c = c;
-        seg->next = nullptr;
+        return false;
     }
-    return seg;
+    SegList& t = lists[list];
+    int head = atFront ? capacity - count : 0;
+    moveSlots(t.base + t.head, t.base + t.tail, base + head);
+    unused += t.capacity;
+    t.base = base;
+    t.capacity = capacity;
+    t.head = head;
+    t.tail = head + count;
+
+    peakMemory = max(peakMemory, memoryUsed());
+    if ( 2 * unused > (int)arena.size() ) compact();
+    return true;
 }
 
 //-----------------------------------------------------------------------------
 
-void SegPool::freeSegment(Segment* seg)
+//  Squeeze the blocks abandoned by lists that have moved out of the arena.
+
+void SegPool::compact()
 {
-    seg->next = freeSeg;
-    freeSeg = seg;
+    // ... visit the lists in the order their blocks appear in the arena
+
+    vector<int> order(lists.size());
+    for (size_t i = 0; i < order.size(); i++) order[i] = (int)i;
+    sort(order.begin(), order.end(),
+         [this](int a, int b) { return lists[a].base < lists[b].base; });
+
+    // ... slide each block down to the end of the one before it
+
+    int base = 0;
+    for (int i : order)
+    {
+        SegList& s = lists[i];
+        if ( s.base != base )
+        {
+            moveSlots(s.base, s.base + s.capacity, base);
+            s.base = base;
+        }
+        base += s.capacity;
+    }
+    resizeArena(base);
+    unused = 0;
+}
+
+//-----------------------------------------------------------------------------
+
+//  Resize the segment array, and the species arrays alongside it, to hold
+//  size segments.
+
+void SegPool::resizeArena(int size)
+{
+    arena.resize(size);
+    for (vector<double>& values : species) values.resize(size);
+}
+
+//-----------------------------------------------------------------------------
+
+//  Move the segments (and their species values) in slots first to last-1
+//  of the arena to the slots starting at dest, which may overlap them.
+
+void SegPool::moveSlots(int first, int last, int dest)
+{
+    if ( dest == first ) return;
+    if ( dest < first )
+    {
+        copy(arena.begin() + first, arena.begin() + last, arena.begin() + dest);
+        for (vector<double>& values : species)
+        {
+            copy(values.begin() + first, values.begin() + last, values.begin() + dest);
+        }
+    }
+    else
+    {
+        int end = dest + last - first;
+        copy_backward(arena.begin() + first, arena.begin() + last, arena.begin() + end);
+        for (vector<double>& values : species)
+        {
+            copy_backward(values.begin() + first, values.begin() + last,
+                          values.begin() + end);
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+//  Assign species values x (or zeros if x is null) to an arena slot.
+
+void SegPool::setValues(int slot, const double* x)
+{
+    for (size_t s = 0; s < species.size(); s++)
+    {
+        species[s][slot] = x ? x[s] : 0.0;
+    }
 }
@@ -11,28 +11,99 @@
 #ifndef SEGPOOL_H_
 #define SEGPOOL_H_
 
-class MemPool;
+#include <vector>
+#include <cstddef>
 
 struct  Segment              //!< Volume segment
 {
    double  v;                //!< volume (ft3)
    double  c;                //!< constituent concentration (mass/ft3)
-   struct  Segment* next;    //!< next upstream volume segment
 };
 
+//! \class SegPool
+//! \brief Stores the lists of volume segments held in pipes and tanks.
+//!
+//! Each list is a double-ended queue whose segments sit next to one
+//! another in a single shared array, ordered from the first (oldest or
+//! downstream) segment to the last (newest or upstream) one, so that
+//! walking a list is a linear scan. A list occupies a fixed block of the
+//! array, with its segments drifting through the block as they are added
+//! at one end and removed from the other; they are shifted back when they
+//! reach the edge of the block, and a list that fills its block is moved
+//! to a block twice as large at the end of the array. Once the abandoned
+//! blocks take up half of the array it is compacted.
+//!
+//! Segment pointers remain valid only until the next segment is added.
+//!
+//! Segments can also carry the values of any number of extra species.
+//! These are kept in one array per species that runs parallel to the
+//! segment array, so that a list's values of a given species are next to
+//! one another too.
+//!
+//! The pool also keeps count of its live segments and of the memory its
+//! array takes up, along with the peak values of both since init().
+//!
+//! Different lists may be updated by different threads at the same time
+//! as long as each has first had room reserved for what will be added to
+//! it (so that none has to be moved) and segment counting is paused.
+
 class SegPool
 {
   public:
     SegPool();
     ~SegPool();
-    void init();
-    Segment* getSegment(double v, double c);
-    void     freeSegment(Segment* seg);
+
+    void     init(int nSpecies = 0);
+    int      newList();
+    int      speciesCount() { return (int)species.size(); }
+
+    int      size(int list)  { return lists[list].tail - lists[list].head; }
+    Segment* first(int list) { return &arena[lists[list].base + lists[list].head]; }
+    Segment* last(int list)  { return &arena[lists[list].base + lists[list].tail - 1]; }
+    double*  values(int list, int s)
+             { return &species[s][lists[list].base + lists[list].head]; }
+
+    bool     pushBack(int list, double v, double c, const double* x = 0);
+    bool     pushFront(int list, double v, double c, const double* x = 0);
+    void     popFront(int list, int n);
+    void     clear(int list);
+    void     reverse(int list);
+    void     merge(int list, int i);
+    bool     reserveBack(int list);
+    void     pauseCount();
+    void     resumeCount();
+
+    int      segCount()     { return liveCount; }
+    int      peakSegCount() { return peakCount; }
+    size_t   memoryUsed();
+    size_t   peakMemoryUsed() { return peakMemory; }
+    void     setPeaks(int count, size_t memory);
 
   private:
-	int        segCount;     // number of volume segments allocated
-	Segment*   freeSeg;      // first unused segment
-	MemPool*   memPool;      // memory pool for volume segments
+
+    struct SegList
+    {
+        int  base;           //!< start of the list's block in arena
+        int  capacity;       //!< size of the list's block
+        int  head;           //!< offset of first segment in block
+        int  tail;           //!< offset past last segment in block
+    };
+
+    std::vector<Segment>  arena;     //!< segments of all lists
+    std::vector<SegList>  lists;     //!< location of each list in arena
+    std::vector< std::vector<double> > species; //!< species values parallel to arena
+    int                   unused;    //!< size of abandoned blocks in arena
+    int                   liveCount; //!< number of segments in all lists
+    int                   peakCount; //!< largest value of liveCount
+    size_t                peakMemory;//!< largest value of memoryUsed()
+    bool                  counting;  //!< false while counting is paused
+
+    void     addCount(int n);
+    void     resizeArena(int size);
+    void     moveSlots(int first, int last, int dest);
+    void     setValues(int slot, const double* x);
+    bool     makeRoom(int list, bool atFront);
+    void     compact();
 };
 
 #endif // SEGPOOL_H_
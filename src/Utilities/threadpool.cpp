@@ -0,0 +1,126 @@
+/* EPANET 3
+ *
+ * Copyright (c) 2016 Open Water Analytics
+ * Licensed under the terms of the MIT License (see the LICENSE file for details).
+ *
+ */
+
+#include "threadpool.h"
+
+using namespace std;
+
+//-----------------------------------------------------------------------------
+
+ThreadPool::ThreadPool() :
+    job(nullptr),
+    taskCount(0),
+    nextTask(0),
+    busy(0),
+    loop(0),
+    stopping(false)
+{}
+
+ThreadPool::~ThreadPool()
+{
+    close();
+}
+
+//-----------------------------------------------------------------------------
+
+//  Start the worker threads. A threadCount of 0 uses one thread per
+//  processor.
+
+void ThreadPool::open(int threadCount)
+{
+    close();
+    if ( threadCount <= 0 ) threadCount = thread::hardware_concurrency();
+    stopping = false;
+    for (int i = 1; i < threadCount; i++)
+    {
+        workers.push_back(thread(&ThreadPool::work, this, loop));
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+//  Stop the worker threads.
+
+void ThreadPool::close()
+{
+    if ( workers.empty() ) return;
+    {
+        lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    started.notify_all();
+    for (thread& worker : workers) worker.join();
+    workers.clear();
+}
+
+//-----------------------------------------------------------------------------
+
+//  Carry out tasks 0 to taskCount-1 using all of the pool's threads.
+
+void ThreadPool::run(int taskCount_, const function<void(int)>& task)
+{
+    if ( workers.empty() || taskCount_ <= 1 )
+    {
+        for (int i = 0; i < taskCount_; i++) task(i);
+        return;
+    }
+
+    {
+        lock_guard<std::mutex> lock(mutex);
+        job = &task;
+        taskCount = taskCount_;
+        nextTask.store(0);
+        busy = (int)workers.size();
+        loop++;
+    }
+    started.notify_all();
+
+    // ... the calling thread shares the work and then waits for the
+    //     workers to finish their last tasks
+
+    runTasks();
+    unique_lock<std::mutex> lock(mutex);
+    finished.wait(lock, [this] { return busy == 0; });
+    job = nullptr;
+}
+
+//-----------------------------------------------------------------------------
+
+//  The loop run by each worker thread (lastLoop is the number of loops
+//  started before the thread was created).
+
+void ThreadPool::work(long lastLoop)
+{
+    for (;;)
+    {
+        {
+            unique_lock<std::mutex> lock(mutex);
+            started.wait(lock, [&] { return stopping || loop != lastLoop; });
+            if ( stopping ) return;
+            lastLoop = loop;
+        }
+        runTasks();
+        {
+            lock_guard<std::mutex> lock(mutex);
+            if ( --busy == 0 ) finished.notify_one();
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+//  Carry out tasks until there are none left to hand out.
+
+void ThreadPool::runTasks()
+{
+    for (;;)
+    {
+        int i = nextTask++;
+        if ( i >= taskCount ) return;
+        (*job)(i);
+    }
+}
@@ -0,0 +1,62 @@
+/* EPANET 3
+ *
+ * Copyright (c) 2016 Open Water Analytics
+ * Licensed under the terms of the MIT License (see the LICENSE file for details).
+ *
+ */
+
+//! \file threadpool.h
+//! \brief Describes the ThreadPool class.
+
+#ifndef THREADPOOL_H_
+#define THREADPOOL_H_
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+//! \class ThreadPool
+//! \brief A set of worker threads that share the tasks of a parallel loop.
+//!
+//! The threads are created once, when the pool is opened, and sleep
+//! between loops. A call to run() hands out the loop's tasks, numbered
+//! 0 to taskCount-1, to the workers and to the calling thread on a first
+//! come basis and returns when all of them have been carried out. Tasks
+//! should write their results into slots indexed by task number so that
+//! combining them afterwards doesn't depend on which thread ran which
+//! task. A pool opened with a single thread runs every task on the
+//! calling thread.
+
+class ThreadPool
+{
+  public:
+
+    ThreadPool();
+    ~ThreadPool();
+
+    void open(int threadCount);
+    void close();
+    int  size() { return (int)workers.size() + 1; }
+    void run(int taskCount, const std::function<void(int)>& task);
+
+  private:
+
+    std::vector<std::thread>        workers;    //!< threads besides the caller's
+    std::mutex                      mutex;      //!< guards the loop's state
+    std::condition_variable         started;    //!< signals a new loop
+    std::condition_variable         finished;   //!< signals the loop is done
+    const std::function<void(int)>* job;        //!< task being looped over
+    int                             taskCount;  //!< number of tasks in loop
+    std::atomic<int>                nextTask;   //!< next task to hand out
+    int                             busy;       //!< workers still in the loop
+    long                            loop;       //!< number of loops started
+    bool                            stopping;   //!< true when pool is closing
+
+    void work(long lastLoop);
+    void runTasks();
+};
+
+#endif
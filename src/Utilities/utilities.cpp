@@ -75,27 +75,21 @@ string Utilities::getFileName(const std::string s)
 
 void Utilities::split(vector<string>& tokens, const string& str)
 {
-    string token;
-    for (int i = 0; i < str.length(); i++)
+    const char* s = str.c_str();
+    size_t n = str.length();
+    size_t i = 0;
+    while (i < n)
     {
-        if (str[i] == ' ' || str[i] == '\t')
+        // ... skip blanks, then copy out the token that follows them
+        if (s[i] == ' ' || s[i] == '\t')
         {
-            if (!token.empty())
-            {
-                tokens.push_back(token);
-                token.clear();
-            }
+            i++;
             continue;
         }
-        else {
-            token += str[i];
-        }
-    }
-
-    if (!token.empty())
-    {
-        tokens.push_back(token);
-        token.clear();
+        size_t j = i;
+        while (j < n && s[j] != ' ' && s[j] != '\t') j++;
+        tokens.push_back(string(s + i, j - i));
+        i = j;
     }
 }
 
@@ -88,7 +88,8 @@ enum ElementCounts {
     EN_CURVECOUNT,   //4
     EN_CONTROLCOUNT, //5
     EN_RULECOUNT,    //6
-    EN_RESVCOUNT};   //7
+    EN_RESVCOUNT,    //7
+    EN_SPECIESCOUNT};//8
 
 enum NodeTypes {
     EN_JUNCTION,     //0
@@ -165,6 +166,31 @@ enum InitFlowTypes {
     EN_NOINITFLOW,   //0
     EN_INITFLOW};    //1
 
+enum BoundaryTypes {
+    EN_BC_TANKLEVEL, //0
+    EN_BC_DEMAND,    //1
+    EN_BC_STATUS,    //2
+    EN_BC_SETTING};  //3
+
+enum ReachDirections {
+    EN_DOWNSTREAM,   //0
+    EN_UPSTREAM};    //1
+
+enum QualStatistics {
+    EN_SEGCOUNT,     //0
+    EN_PEAKSEGCOUNT, //1
+    EN_SEGMEMORY,    //2
+    EN_PEAKSEGMEMORY,//3
+    EN_SEGMERGES,    //4
+    EN_EQUILTIME,    //5
+    EN_CYCLECHANGE}; //6
+
+enum ImpactTypes {
+    EN_MASSCONSUMED, //0
+    EN_NODESEXPOSED, //1
+    EN_FIRSTEXPOSURE,//2
+    EN_PEAKVALUE};   //3
+
 
 #ifdef __cplusplus
 extern "C" {
@@ -186,6 +212,37 @@ int        EN_initSolver(int initFlows, EN_Project p);
 int        EN_runSolver(int* t, EN_Project p);
 int        EN_advanceSolver(int* dt, EN_Project p);
 
+int        EN_saveCheckpoint(EN_Project p);
+int        EN_restoreCheckpoint(EN_Project p);
+int        EN_forkProject(EN_Project pFork, EN_Project pSource);
+int        EN_openStream(int capacity, EN_Project p);
+int        EN_setBoundary(int type, int index, double value, EN_Project p);
+int        EN_clearBoundaries(EN_Project p);
+int        EN_solveStream(int t, EN_Project p);
+int        EN_runStream(const char* feedFile, EN_Project p);
+long       EN_readStream(long afterFrame, int* t, double* nodeHead,
+                         double* nodeDemand, double* linkFlow, EN_Project p);
+
+int        EN_openFlowHistory(EN_Project p);
+int        EN_trackSources(int node, int t, int maxAge, int* count, EN_Project p);
+int        EN_getTrackedSource(int index, int* node, double* fraction,
+                               double* meanAge, EN_Project p);
+int        EN_getTrackedArrivals(int index, int binWidth, int binCount,
+                                 double* fractions, EN_Project p);
+int        EN_getTrackedPath(int index, int size, int* links, int* count,
+                             EN_Project p);
+
+int        EN_findReachable(int node, int direction, int maxTime, int* nodeCount,
+                            int* linkCount, EN_Project p);
+int        EN_getReachedNodes(int* nodes, EN_Project p);
+int        EN_getReachedLinks(int* links, EN_Project p);
+
+int        EN_getQualStatistic(int type, double* value, EN_Project p);
+int        EN_getSpeciesIndex(char* name, int* index, EN_Project p);
+int        EN_getNodeSpecies(int node, int species, double* value, EN_Project p);
+int        EN_getLinkSpecies(int link, int species, double* value, EN_Project p);
+int        EN_getInjectionImpact(int species, int type, double* value, EN_Project p);
+
 int        EN_openOutputFile(const char* fname, EN_Project p);
 int        EN_saveOutput(EN_Project p);
 
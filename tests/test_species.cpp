@@ -0,0 +1,107 @@
+/* EPANET 3
+ *
+ * Copyright (c) 2016 Open Water Analytics
+ * Licensed under the terms of the MIT License (see the LICENSE file for details).
+ *
+ */
+
+//! \file test_species.cpp
+//! \brief Tests that a node can be the source of several injection
+//!        scenarios and be traced as well.
+
+#include "epanet3.h"
+
+#include <cstdio>
+#include <cstring>
+
+// A reservoir feeding junction 11 through junction 10, with two injection
+// scenarios (one conservative, one decaying) and a trace at node 10
+static const char* inpText =
+    "[JUNCTIONS]\n"
+    " 10  700  0\n"
+    " 11  700  100\n"
+    "[RESERVOIRS]\n"
+    " 9   800\n"
+    "[PIPES]\n"
+    " 1   9   10  1000  12  100\n"
+    " 2   10  11  1000  12  100\n"
+    "[SPECIES]\n"
+    " INJECT 10 1 0\n"
+    " INJECT 10 1 -0.5\n"
+    " TRACE  10\n"
+    "[OPTIONS]\n"
+    " Quality Age\n"
+    "[TIMES]\n"
+    " Duration           12:00\n"
+    " Hydraulic Timestep 1:00\n"
+    "[END]\n";
+
+static int failures = 0;
+
+static void check(bool condition, const char* what)
+{
+    if ( !condition )
+    {
+        printf("FAILED: %s\n", what);
+        failures++;
+    }
+}
+
+int main()
+{
+    const char* inpFile = "test_species.inp";
+    FILE* f = fopen(inpFile, "w");
+    if ( !f ) return 1;
+    fputs(inpText, f);
+    fclose(f);
+
+    EN_Project p = EN_createProject();
+    check(EN_loadProject(inpFile, p) == 0, "two injections and a trace at one node load");
+
+    // ... each injection gets its own species, named apart from the trace
+    int inject1 = -1, inject2 = -1, trace = -1;
+    char name1[] = "10#1", name2[] = "10#2", name3[] = "10";
+    check(EN_getSpeciesIndex(name1, &inject1, p) == 0, "first injection is named 10#1");
+    check(EN_getSpeciesIndex(name2, &inject2, p) == 0, "second injection is named 10#2");
+    check(EN_getSpeciesIndex(name3, &trace, p) == 0, "trace is named after its node");
+    check(inject1 != inject2 && inject1 != trace && inject2 != trace,
+          "species indexes are distinct");
+
+    // ... run the simulation and compare the scenarios at junction 11
+    int node = -1;
+    char nodeName[] = "11";
+    EN_getNodeIndex(nodeName, &node, p);
+    int t = 0, dt = 0;
+    int err = EN_initSolver(0, p);
+    do
+    {
+        if ( !err ) err = EN_runSolver(&t, p);
+        if ( !err ) err = EN_advanceSolver(&dt, p);
+    } while ( !err && dt > 0 );
+    check(err == 0, "simulation runs");
+
+    double c1 = 0.0, c2 = 0.0, c3 = 0.0;
+    EN_getNodeSpecies(node, inject1, &c1, p);
+    EN_getNodeSpecies(node, inject2, &c2, p);
+    EN_getNodeSpecies(node, trace, &c3, p);
+    check(c1 > 0.99 && c1 < 1.01, "conservative injection reaches node 11 intact");
+    check(c2 > 0.0 && c2 < c1, "decaying injection reaches node 11 reduced");
+    check(c3 > 99.0, "all flow at node 11 is traced to node 10");
+
+    EN_deleteProject(p);
+
+    // ... a solver that can't carry species must say so
+    f = fopen(inpFile, "w");
+    if ( !f ) return 1;
+    fputs(inpText, f);
+    fputs("[OPTIONS]\n QUALITY_SOLVER EFV\n", f);
+    fclose(f);
+    p = EN_createProject();
+    check(EN_loadProject(inpFile, p) == 0, "species with the EFV solver load");
+    check(EN_initSolver(0, p) == 209, "EFV solver rejects species");
+    EN_deleteProject(p);
+
+    remove(inpFile);
+    if ( failures == 0 ) printf("All species tests passed.\n");
+    return failures > 0;
+}